@@ -0,0 +1,368 @@
+#include "decal.h"
+#include "frame_snapshot.h"
+#include "light_culling.h"
+#include "ray_scene.h"
+#include "shader_permutation_flags.h"
+#include <gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Microbenchmarks of the CPU hot paths at several scales. A human readable table goes to stdout, --json <path> also writes the
+// results in a form other tools can compare across commits.
+//
+//   DeferredDecalsBench [--json <path>] [--filter <substring>] [--min-time <ms>]
+
+struct BenchmarkResult
+{
+    std::string name;
+    uint32_t    scale      = 0; // Decals, instances or lights in the scene.
+    uint32_t    items      = 0; // Work items per iteration, e.g. rays cast.
+    uint32_t    iterations = 0;
+    double      mean_ms    = 0.0;
+    double      median_ms  = 0.0;
+    double      min_ms     = 0.0;
+};
+
+struct BenchmarkSettings
+{
+    const char* filter      = nullptr;
+    const char* json_path   = nullptr;
+    double      min_time_ms = 250.0;
+};
+
+static BenchmarkSettings            g_settings;
+static std::vector<BenchmarkResult> g_results;
+
+// Keeps results alive so the optimizer can't drop the work that produced them.
+static volatile float g_sink = 0.0f;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Runs fn once to warm caches, then repeatedly until at least min_time_ms and 5 iterations have passed.
+static void run_benchmark(const std::string& name, uint32_t scale, uint32_t items, std::function<void()> fn)
+{
+    if (g_settings.filter && name.find(g_settings.filter) == std::string::npos)
+        return;
+
+    fn();
+
+    std::vector<double> times;
+    double              start = now_ms();
+
+    while (times.size() < 5 || now_ms() - start < g_settings.min_time_ms)
+    {
+        double iteration_start = now_ms();
+        fn();
+        times.push_back(now_ms() - iteration_start);
+    }
+
+    std::sort(times.begin(), times.end());
+
+    BenchmarkResult result;
+
+    result.name       = name;
+    result.scale      = scale;
+    result.items      = items;
+    result.iterations = uint32_t(times.size());
+    result.median_ms  = times[times.size() / 2];
+    result.min_ms     = times.front();
+
+    for (double time : times)
+        result.mean_ms += time;
+
+    result.mean_ms /= double(times.size());
+
+    printf("%-24s %8u %9u %10.4f %10.4f %10.4f %10.2f\n", name.c_str(), scale, items, result.mean_ms, result.median_ms, result.min_ms, result.median_ms * 1e6 / double(std::max(items, 1u)));
+
+    g_results.push_back(result);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Decals scattered over a square of the ground plane, as if placed by clicking around the scene.
+static std::vector<DecalInstance> make_decals(uint32_t count, float extent)
+{
+    std::mt19937                          generator(1337);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<DecalInstance> instances(count);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        glm::vec3      hit_pos   = glm::vec3(unit(generator), 0.0f, unit(generator)) * extent;
+        DecalProjector projector = build_decal_projector(hit_pos, glm::vec3(0.0f, 1.0f, 0.0f), unit(generator) * 180.0f, 10.0f, 10.0f, 10.0f);
+
+        instances[i].m_hit_pos             = hit_pos;
+        instances[i].m_hit_normal          = glm::vec3(0.0f, 1.0f, 0.0f);
+        instances[i].m_projector_pos       = projector.position;
+        instances[i].m_projector_dir       = projector.direction;
+        instances[i].m_projector_view      = projector.view;
+        instances[i].m_projector_proj      = projector.proj;
+        instances[i].m_projector_view_proj = projector.view_proj;
+        instances[i].m_decal_overlay_color = glm::vec4(1.0f);
+        instances[i].m_aspect_ratio        = glm::vec2(1.0f);
+        instances[i].m_selected_decal      = int32_t(i % 2);
+    }
+
+    return instances;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void benchmark_ray_casts()
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t>  indices;
+
+    generate_sphere(32, 64, positions, indices);
+
+    const uint32_t ray_count = 65536;
+
+    for (uint32_t instance_count : { 16u, 256u, 4096u })
+    {
+        std::mt19937                          generator(1337);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        RayScene scene;
+        uint32_t mesh = scene.add_mesh(positions.data(), uint32_t(positions.size()), indices.data(), uint32_t(indices.size() / 3));
+
+        for (uint32_t i = 0; i < instance_count; i++)
+            scene.add_instance(mesh, glm::translate(glm::mat4(1.0f), glm::vec3(unit(generator), unit(generator), unit(generator)) * 100.0f));
+
+        scene.commit();
+
+        // Rays from a sphere around the instances towards random points inside it, like picking from an orbiting camera.
+        std::vector<glm::vec3> origins(ray_count);
+        std::vector<glm::vec3> directions(ray_count);
+
+        for (uint32_t i = 0; i < ray_count; i++)
+        {
+            origins[i]    = glm::normalize(glm::vec3(unit(generator), unit(generator), unit(generator))) * 300.0f;
+            directions[i] = glm::normalize(glm::vec3(unit(generator), unit(generator), unit(generator)) * 100.0f - origins[i]);
+        }
+
+        run_benchmark("ray_cast", instance_count, ray_count, [&]() {
+            float distance = 0.0f;
+
+            for (uint32_t i = 0; i < ray_count; i++)
+            {
+                RayHit hit;
+
+                if (scene.intersect(origins[i], directions[i], hit))
+                    distance += hit.distance;
+            }
+
+            g_sink = distance;
+        });
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void benchmark_projector_build()
+{
+    for (uint32_t count : { 1000u, 10000u, 100000u })
+    {
+        std::mt19937                          generator(1337);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        std::vector<glm::vec3> hit_positions(count);
+        std::vector<glm::vec3> hit_normals(count);
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            hit_positions[i] = glm::vec3(unit(generator), unit(generator), unit(generator)) * 1000.0f;
+            hit_normals[i]   = glm::normalize(glm::vec3(unit(generator), unit(generator), unit(generator)));
+        }
+
+        run_benchmark("projector_build", count, count, [&]() {
+            float sum = 0.0f;
+
+            for (uint32_t i = 0; i < count; i++)
+                sum += build_decal_projector(hit_positions[i], hit_normals[i], float(i % 360), 10.0f, 10.0f, 10.0f).view_proj[3][3];
+
+            g_sink = sum;
+        });
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void benchmark_decal_draws()
+{
+    std::vector<uint32_t> type_permutations = { PERMUTATION_NORMAL_MAP | PERMUTATION_ALPHA_TEST, PERMUTATION_ALPHA_TEST };
+
+    glm::vec3 camera    = glm::vec3(0.0f, 300.0f, 1500.0f);
+    glm::mat4 view      = glm::lookAt(camera, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 proj      = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 1.0f, 10000.0f);
+    glm::mat4 view_proj = proj * view;
+
+    SimulationInput input;
+
+    input.width            = 1920;
+    input.height           = 1080;
+    input.decal_key_mask   = PERMUTATION_NORMAL_MAP | PERMUTATION_ALPHA_TEST;
+    input.ready_decal_keys = ~uint64_t(0);
+
+    // An occluder across the middle of the screen, half way to the decals, for the Hi-Z variant.
+    std::shared_ptr<OcclusionSnapshot> occlusion = std::make_shared<OcclusionSnapshot>();
+    std::vector<float>                 depth(input.width * input.height, 1.0f);
+    glm::vec4                          wall = view_proj * glm::vec4(0.0f, 0.0f, 750.0f, 1.0f);
+
+    for (uint32_t y = input.height / 4; y < input.height * 3 / 4; y++)
+        std::fill(depth.begin() + y * input.width, depth.begin() + (y + 1) * input.width, (wall.z / wall.w) * 0.5f + 0.5f);
+
+    occlusion->pyramid.build(depth.data(), input.width, input.height);
+    occlusion->view_proj = view_proj;
+
+    for (uint32_t count : { 1000u, 10000u, 100000u })
+    {
+        std::vector<DecalInstance> instances = make_decals(count, 2000.0f);
+
+        FrameSnapshot snapshot;
+
+        // Iteration, frustum culling and the permutation sort alone.
+        input.culling.hiz_culling = false;
+        input.culling.lod         = false;
+        input.occlusion           = nullptr;
+
+        run_benchmark("decal_draws", count, count, [&]() {
+            build_decal_draws(instances, type_permutations, input, view_proj, snapshot);
+            g_sink = float(snapshot.draws.size());
+        });
+
+        input.culling.lod = true;
+
+        run_benchmark("decal_draws_lod", count, count, [&]() {
+            build_decal_draws(instances, type_permutations, input, view_proj, snapshot);
+            g_sink = float(snapshot.draws.size());
+        });
+
+        input.culling.hiz_culling = true;
+        input.occlusion           = occlusion;
+
+        run_benchmark("decal_draws_hiz_lod", count, count, [&]() {
+            build_decal_draws(instances, type_permutations, input, view_proj, snapshot);
+            g_sink = float(snapshot.draws.size());
+        });
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void benchmark_light_culling()
+{
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 300.0f, 1500.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 1.0f, 10000.0f);
+
+    for (uint32_t count : { 64u, 512u, 4096u })
+    {
+        std::mt19937                          generator(1337);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        std::vector<Light> lights(count);
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            lights[i].position_range  = glm::vec4(unit(generator) * 1000.0f, unit(generator) * 100.0f + 100.0f, unit(generator) * 1000.0f, 50.0f + unit(generator) * 25.0f);
+            lights[i].color_intensity = glm::vec4(1.0f);
+            lights[i].direction_type  = glm::vec4(0.0f, -1.0f, 0.0f, float(LIGHT_TYPE_POINT));
+            lights[i].spot_angles     = glm::vec4(0.0f);
+        }
+
+        LightGrid grid;
+
+        run_benchmark("light_grid", count, count, [&]() {
+            build_light_grid(lights.data(), count, view, proj, 1920, 1080, nullptr, grid);
+            g_sink = float(grid.indices.size());
+        });
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool write_json(FILE* file)
+{
+    fprintf(file, "{\n    \"benchmarks\": [\n");
+
+    for (size_t i = 0; i < g_results.size(); i++)
+    {
+        const BenchmarkResult& result = g_results[i];
+
+        fprintf(file,
+                "        { \"name\": \"%s\", \"scale\": %u, \"items\": %u, \"iterations\": %u, \"mean_ms\": %.6f, \"median_ms\": %.6f, \"min_ms\": %.6f, \"ns_per_item\": %.3f }%s\n",
+                result.name.c_str(),
+                result.scale,
+                result.items,
+                result.iterations,
+                result.mean_ms,
+                result.median_ms,
+                result.min_ms,
+                result.median_ms * 1e6 / double(std::max(result.items, 1u)),
+                i + 1 < g_results.size() ? "," : "");
+    }
+
+    fprintf(file, "    ]\n}\n");
+
+    return ferror(file) == 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            g_settings.json_path = argv[++i];
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            g_settings.filter = argv[++i];
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+            g_settings.min_time_ms = atof(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Usage: %s [--json <path>] [--filter <substring>] [--min-time <ms>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("%-24s %8s %9s %10s %10s %10s %10s\n", "benchmark", "scale", "items", "mean ms", "median ms", "min ms", "ns/item");
+
+    benchmark_ray_casts();
+    benchmark_projector_build();
+    benchmark_decal_draws();
+    benchmark_light_culling();
+
+    if (!g_settings.json_path)
+        return 0;
+
+    FILE* file = fopen(g_settings.json_path, "w");
+
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s\n", g_settings.json_path);
+        return 1;
+    }
+
+    bool ok = write_json(file);
+
+    fclose(file);
+
+    return ok ? 0 : 1;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
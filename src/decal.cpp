@@ -0,0 +1,125 @@
+#include "decal.h"
+#include <gtc/matrix_transform.hpp>
+#include <algorithm>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+DecalProjector build_decal_projector(const glm::vec3& hit_pos, const glm::vec3& hit_normal, float rotation, float size, float outer_depth, float inner_depth)
+{
+    DecalProjector projector;
+
+    projector.position  = hit_pos + hit_normal * outer_depth;
+    projector.direction = -hit_normal;
+
+    glm::mat4 rotate = glm::mat4(1.0f);
+
+    rotate = glm::rotate(rotate, glm::radians(rotation), projector.direction);
+
+    glm::vec3 default_up = glm::vec3(0.0f, 0.0f, 1.0f);
+
+    if (hit_normal.x > hit_normal.y && hit_normal.x > hit_normal.z)
+        default_up = glm::vec3(0.0f, -1.0f, 0.0f);
+    else if (hit_normal.z > hit_normal.y && hit_normal.z > hit_normal.x)
+        default_up = glm::vec3(0.0f, -1.0f, 0.0f);
+
+    glm::vec4 rotated_axis = rotate * glm::vec4(default_up, 0.0f);
+
+    projector.view      = glm::lookAt(projector.position, hit_pos, glm::normalize(glm::vec3(rotated_axis) + glm::vec3(0.001f, 0.0f, 0.0f)));
+    projector.proj      = glm::ortho(-size, size, -size, size, 0.1f, outer_depth + inner_depth);
+    projector.view_proj = projector.proj * projector.view;
+
+    return projector;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void decal_box_corners(const glm::mat4& projector_view_proj, glm::vec3 corners[8])
+{
+    glm::mat4 inv_view_proj = glm::inverse(projector_view_proj);
+
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec4 corner = inv_view_proj * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 1.0f);
+        corners[i]       = glm::vec3(corner) / corner.w;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool decal_screen_rect(const glm::mat4& view_proj, const glm::vec3 corners[8], glm::vec4& rect)
+{
+    glm::vec2 rect_min = glm::vec2(1.0f);
+    glm::vec2 rect_max = glm::vec2(-1.0f);
+
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec4 clip = view_proj * glm::vec4(corners[i], 1.0f);
+
+        if (clip.w <= 0.0f)
+        {
+            rect = glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f);
+            return false;
+        }
+
+        glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+
+        rect_min = glm::min(rect_min, ndc);
+        rect_max = glm::max(rect_max, ndc);
+    }
+
+    rect_min = glm::clamp(rect_min, glm::vec2(-1.0f), glm::vec2(1.0f));
+    rect_max = glm::clamp(rect_max, glm::vec2(-1.0f), glm::vec2(1.0f));
+
+    rect = glm::vec4(rect_min, rect_max);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+float decal_screen_area(const glm::mat4& view_proj, const glm::vec3 corners[8], uint32_t width, uint32_t height)
+{
+    glm::vec4 rect;
+
+    if (!decal_screen_rect(view_proj, corners, rect))
+        return float(width) * float(height);
+
+    glm::vec2 extent = glm::max(glm::vec2(rect.z, rect.w) - glm::vec2(rect.x, rect.y), glm::vec2(0.0f)) * 0.5f * glm::vec2(float(width), float(height));
+
+    return extent.x * extent.y;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+DecalLOD select_decal_lod(float screen_area, float drop_area, float albedo_area)
+{
+    if (screen_area < drop_area)
+        return DECAL_LOD_DROPPED;
+    else if (screen_area < albedo_area)
+        return DECAL_LOD_ALBEDO;
+    else
+        return DECAL_LOD_FULL;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool decal_draws_appended(const std::vector<std::pair<uint32_t, int>>& previous, const std::vector<std::pair<uint32_t, int>>& current, int previous_instance_count)
+{
+    // The sort is stable, so removing the new draws from current must give back previous exactly.
+    size_t matched = 0;
+
+    for (auto& draw : current)
+    {
+        if (draw.second >= previous_instance_count)
+            continue;
+
+        if (matched == previous.size() || previous[matched] != draw)
+            return false;
+
+        matched++;
+    }
+
+    return matched == previous.size();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm.hpp>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+enum DecalLOD
+{
+    DECAL_LOD_DROPPED = 0,
+    DECAL_LOD_ALBEDO,
+    DECAL_LOD_FULL,
+    DECAL_LOD_COUNT
+};
+
+struct DecalInstance
+{
+    // Last hit
+    glm::vec3 m_hit_pos;
+    glm::vec3 m_hit_normal;
+    float     m_hit_distance = INFINITY;
+
+    // Projector
+    glm::vec3 m_projector_pos;
+    glm::vec3 m_projector_dir;
+    glm::mat4 m_projector_view;
+    glm::mat4 m_projector_view_proj;
+    glm::mat4 m_projector_proj;
+    glm::vec4 m_decal_overlay_color;
+    glm::vec2 m_aspect_ratio;
+
+    // Debug
+    int32_t m_selected_decal = 0;
+};
+
+struct DecalProjector
+{
+    glm::vec3 position;
+    glm::vec3 direction;
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::mat4 view_proj;
+};
+
+// Orthographic projector placed outer_depth above a surface hit and looking down its normal, rotated by rotation degrees around it.
+// The volume is 2 * size wide and reaches inner_depth below the surface.
+DecalProjector build_decal_projector(const glm::vec3& hit_pos, const glm::vec3& hit_normal, float rotation, float size, float outer_depth, float inner_depth);
+
+// World space corners of the volume a projector covers, i.e. the cube rasterized by render_decals().
+void decal_box_corners(const glm::mat4& projector_view_proj, glm::vec3 corners[8]);
+
+// NDC rectangle (min xy, max xy) bounding a projected volume, clamped to the screen. Returns false when the volume crosses the near
+// plane, in which case the rectangle covers the whole screen.
+bool decal_screen_rect(const glm::mat4& view_proj, const glm::vec3 corners[8], glm::vec4& rect);
+
+// Pixel area of the screen rectangle bounding a projected volume, clamped to the screen. Volumes crossing the near plane count as
+// covering the whole screen.
+float decal_screen_area(const glm::mat4& view_proj, const glm::vec3 corners[8], uint32_t width, uint32_t height);
+
+// Decals smaller than drop_area pixels are not drawn, those smaller than albedo_area skip the normal map and TBN reconstruction.
+DecalLOD select_decal_lod(float screen_area, float drop_area, float albedo_area);
+
+// True when current only differs from previous by draws of instances at or past previous_instance_count, i.e. decals were placed
+// but none were removed, culled or changed LOD. Both lists hold (permutation key, instance index) pairs in draw order.
+bool decal_draws_appended(const std::vector<std::pair<uint32_t, int>>& previous, const std::vector<std::pair<uint32_t, int>>& current, int previous_instance_count);
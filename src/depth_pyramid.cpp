@@ -0,0 +1,226 @@
+#include "depth_pyramid.h"
+#include <algorithm>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void downsample_min_max(const DepthPyramidLevel& src, DepthPyramidLevel& dst)
+{
+    // Level sizes round down like GL mip levels, so the last texel of a row or column also covers the odd texel left over.
+    dst.width  = std::max(src.width / 2, 1u);
+    dst.height = std::max(src.height / 2, 1u);
+    dst.texels.resize(dst.width * dst.height);
+
+    for (uint32_t y = 0; y < dst.height; y++)
+    {
+        uint32_t y_count = (y == dst.height - 1 && (src.height & 1)) ? 3 : 2;
+
+        for (uint32_t x = 0; x < dst.width; x++)
+        {
+            uint32_t  x_count = (x == dst.width - 1 && (src.width & 1)) ? 3 : 2;
+            glm::vec2 result  = glm::vec2(1.0f, 0.0f);
+
+            for (uint32_t j = 0; j < y_count; j++)
+            {
+                for (uint32_t i = 0; i < x_count; i++)
+                {
+                    uint32_t         sx = std::min(x * 2 + i, src.width - 1);
+                    uint32_t         sy = std::min(y * 2 + j, src.height - 1);
+                    const glm::vec2& v  = src.texels[sy * src.width + sx];
+
+                    result.x = std::min(result.x, v.x);
+                    result.y = std::max(result.y, v.y);
+                }
+            }
+
+            dst.texels[y * dst.width + x] = result;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool outside_frustum(const glm::mat4& view_proj, const glm::vec3 corners[8])
+{
+    // Bit per clip plane, cleared as soon as one corner is inside it.
+    uint32_t outside = 0x3F;
+
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec4 clip = view_proj * glm::vec4(corners[i], 1.0f);
+        uint32_t  mask = 0;
+
+        mask |= clip.x < -clip.w ? 1 : 0;
+        mask |= clip.x > clip.w ? 2 : 0;
+        mask |= clip.y < -clip.w ? 4 : 0;
+        mask |= clip.y > clip.w ? 8 : 0;
+        mask |= clip.z < -clip.w ? 16 : 0;
+        mask |= clip.z > clip.w ? 32 : 0;
+
+        outside &= mask;
+    }
+
+    return outside != 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void DepthPyramid::build(const float* depth, uint32_t width, uint32_t height)
+{
+    DepthPyramidLevel source;
+
+    source.width  = width;
+    source.height = height;
+    source.texels.resize(width * height);
+
+    for (uint32_t i = 0; i < width * height; i++)
+        source.texels[i] = glm::vec2(depth[i]);
+
+    m_levels.resize(1);
+    downsample_min_max(source, m_levels[0]);
+
+    m_texel_size    = 2;
+    m_screen_width  = width;
+    m_screen_height = height;
+
+    build_mips();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void DepthPyramid::build_from_level(const glm::vec2* texels, uint32_t width, uint32_t height, uint32_t level, uint32_t screen_width, uint32_t screen_height)
+{
+    m_levels.resize(1);
+
+    m_levels[0].width  = width;
+    m_levels[0].height = height;
+    m_levels[0].texels.assign(texels, texels + width * height);
+
+    m_texel_size    = 2u << level;
+    m_screen_width  = screen_width;
+    m_screen_height = screen_height;
+
+    build_mips();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool DepthPyramid::is_occluded(const glm::mat4& view_proj, const glm::vec3 corners[8]) const
+{
+    if (m_levels.empty())
+        return false;
+
+    glm::vec2 rect_min  = glm::vec2(INFINITY);
+    glm::vec2 rect_max  = glm::vec2(-INFINITY);
+    float     min_depth = 1.0f;
+
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec4 clip = view_proj * glm::vec4(corners[i], 1.0f);
+
+        // Part of the volume is behind the camera, the projected bounds are meaningless.
+        if (clip.w <= 0.0f)
+            return false;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+
+        if (ndc.z < -1.0f)
+            return false;
+
+        rect_min  = glm::min(rect_min, glm::vec2(ndc.x, ndc.y));
+        rect_max  = glm::max(rect_max, glm::vec2(ndc.x, ndc.y));
+        min_depth = std::min(min_depth, ndc.z * 0.5f + 0.5f);
+    }
+
+    // Off screen for the pyramid's view, there is nothing to test against.
+    if (rect_max.x < -1.0f || rect_min.x > 1.0f || rect_max.y < -1.0f || rect_min.y > 1.0f || min_depth > 1.0f)
+        return false;
+
+    // Window space pixel bounds of the volume.
+    rect_min = (glm::clamp(rect_min, glm::vec2(-1.0f), glm::vec2(1.0f)) * 0.5f + 0.5f) * glm::vec2(float(m_screen_width), float(m_screen_height));
+    rect_max = (glm::clamp(rect_max, glm::vec2(-1.0f), glm::vec2(1.0f)) * 0.5f + 0.5f) * glm::vec2(float(m_screen_width), float(m_screen_height));
+
+    // Pick the level at which the bounds span at most 2x2 texels.
+    float    extent = std::max(rect_max.x - rect_min.x, rect_max.y - rect_min.y) / float(m_texel_size);
+    uint32_t level  = extent > 1.0f ? uint32_t(std::ceil(std::log2(extent))) : 0;
+
+    level = std::min(level, uint32_t(m_levels.size()) - 1);
+
+    const DepthPyramidLevel& pyramid_level = m_levels[level];
+    float                    texel_size    = float(m_texel_size << level);
+
+    uint32_t x0 = std::min(uint32_t(rect_min.x / texel_size), pyramid_level.width - 1);
+    uint32_t y0 = std::min(uint32_t(rect_min.y / texel_size), pyramid_level.height - 1);
+    uint32_t x1 = std::min(uint32_t(rect_max.x / texel_size), pyramid_level.width - 1);
+    uint32_t y1 = std::min(uint32_t(rect_max.y / texel_size), pyramid_level.height - 1);
+
+    float max_depth = 0.0f;
+
+    for (uint32_t y = y0; y <= y1; y++)
+    {
+        for (uint32_t x = x0; x <= x1; x++)
+            max_depth = std::max(max_depth, pyramid_level.texels[y * pyramid_level.width + x].y);
+    }
+
+    // Occluded when even the nearest point of the volume is behind the farthest occluder it overlaps.
+    return min_depth > max_depth;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void DepthPyramid::tile_depth_bounds(uint32_t tile_size, std::vector<glm::vec2>& bounds) const
+{
+    uint32_t tiles_x = (m_screen_width + tile_size - 1) / tile_size;
+    uint32_t tiles_y = (m_screen_height + tile_size - 1) / tile_size;
+
+    bounds.resize(tiles_x * tiles_y);
+
+    if (m_levels.empty())
+    {
+        std::fill(bounds.begin(), bounds.end(), glm::vec2(0.0f, 1.0f));
+        return;
+    }
+
+    // The last texel of a row or column also covers the pixels left over when the level size was rounded down, hence the clamps.
+    const DepthPyramidLevel& level = m_levels[0];
+
+    for (uint32_t ty = 0; ty < tiles_y; ty++)
+    {
+        uint32_t y0 = std::min(ty * tile_size / m_texel_size, level.height - 1);
+        uint32_t y1 = std::min((std::min((ty + 1) * tile_size, m_screen_height) - 1) / m_texel_size, level.height - 1);
+
+        for (uint32_t tx = 0; tx < tiles_x; tx++)
+        {
+            uint32_t x0 = std::min(tx * tile_size / m_texel_size, level.width - 1);
+            uint32_t x1 = std::min((std::min((tx + 1) * tile_size, m_screen_width) - 1) / m_texel_size, level.width - 1);
+
+            glm::vec2 result = glm::vec2(1.0f, 0.0f);
+
+            for (uint32_t y = y0; y <= y1; y++)
+            {
+                for (uint32_t x = x0; x <= x1; x++)
+                {
+                    const glm::vec2& v = level.texels[y * level.width + x];
+
+                    result.x = std::min(result.x, v.x);
+                    result.y = std::max(result.y, v.y);
+                }
+            }
+
+            bounds[ty * tiles_x + tx] = result;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void DepthPyramid::build_mips()
+{
+    while (m_levels.back().width > 1 || m_levels.back().height > 1)
+    {
+        DepthPyramidLevel next;
+        downsample_min_max(m_levels.back(), next);
+        m_levels.push_back(std::move(next));
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
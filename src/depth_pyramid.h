@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glm.hpp>
+#include <vector>
+#include <stdint.h>
+
+struct DepthPyramidLevel
+{
+    uint32_t               width  = 0;
+    uint32_t               height = 0;
+    std::vector<glm::vec2> texels; // (min, max) window space depth
+};
+
+// CPU side min/max depth pyramid, either built from a full resolution depth buffer or from a level read back from the GPU pyramid
+// that hiz_downsample_fs.glsl builds.
+class DepthPyramid
+{
+public:
+    // CPU reference of the GPU build: level 0 is half resolution and every texel holds the (min, max) of the 2x2 texels below it.
+    void build(const float* depth, uint32_t width, uint32_t height);
+
+    // Builds from GPU pyramid level 'level', whose texels each cover 2^(level + 1) pixels of a screen_width x screen_height target.
+    void build_from_level(const glm::vec2* texels, uint32_t width, uint32_t height, uint32_t level, uint32_t screen_width, uint32_t screen_height);
+
+    // Tests a convex volume given by its 8 world space corners against the view the pyramid was built from. Volumes that cross the
+    // near plane or leave the screen are never reported as occluded.
+    bool is_occluded(const glm::mat4& view_proj, const glm::vec3 corners[8]) const;
+
+    // Conservative (min, max) depth of every tile_size x tile_size pixel tile of the screen, row major from the bottom-left tile
+    // like LightGrid. Level 0 texels that cover several tiles give each of them the texel's full range.
+    void tile_depth_bounds(uint32_t tile_size, std::vector<glm::vec2>& bounds) const;
+
+    inline bool                     empty() const { return m_levels.empty(); }
+    inline uint32_t                 level_count() const { return uint32_t(m_levels.size()); }
+    inline const DepthPyramidLevel& level(uint32_t i) const { return m_levels[i]; }
+    inline uint32_t                 screen_width() const { return m_screen_width; }
+    inline uint32_t                 screen_height() const { return m_screen_height; }
+
+private:
+    void build_mips();
+
+private:
+    std::vector<DepthPyramidLevel> m_levels;
+    uint32_t                       m_texel_size    = 2; // Screen pixels covered by a level 0 texel.
+    uint32_t                       m_screen_width  = 0;
+    uint32_t                       m_screen_height = 0;
+};
+
+void downsample_min_max(const DepthPyramidLevel& src, DepthPyramidLevel& dst);
+
+// True when all 8 corners lie outside the same clip plane.
+bool outside_frustum(const glm::mat4& view_proj, const glm::vec3 corners[8]);
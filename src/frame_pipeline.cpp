@@ -0,0 +1,213 @@
+#include "frame_pipeline.h"
+#include "frame_snapshot.h"
+#include "triple_buffer.h"
+#include "shader_permutation_flags.h"
+#include <gtc/matrix_transform.hpp>
+#include <random>
+#include <chrono>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+FrameWorker::FrameWorker(std::function<void()> step) :
+    m_step(step), m_thread(&FrameWorker::run, this)
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+FrameWorker::~FrameWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FrameWorker::kick()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending = true;
+    }
+
+    m_wake.notify_one();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FrameWorker::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return !m_pending && !m_running; });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FrameWorker::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_wake.wait(lock, [this]() { return m_pending || m_quit; });
+
+        if (m_quit)
+            break;
+
+        m_pending = false;
+        m_running = true;
+
+        // The mutex only guards the wake up state, the step itself exchanges data through lock-free buffers.
+        lock.unlock();
+        m_step();
+        lock.lock();
+
+        m_running = false;
+
+        if (!m_pending)
+            m_idle.notify_all();
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void spin_for(double ms)
+{
+    double end = now_ms() + ms;
+
+    while (now_ms() < end)
+        ;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+FramePipelineStats benchmark_frame_pipeline(bool threaded, uint32_t decal_count, double render_ms, uint32_t frames)
+{
+    std::mt19937                          generator(1337);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<DecalInstance> instances(decal_count);
+    std::vector<uint32_t>      type_permutations = { PERMUTATION_NORMAL_MAP | PERMUTATION_ALPHA_TEST, PERMUTATION_ALPHA_TEST };
+
+    for (uint32_t i = 0; i < decal_count; i++)
+    {
+        glm::vec3 position = glm::vec3(unit(generator), unit(generator), unit(generator)) * 1000.0f;
+
+        instances[i].m_projector_view      = glm::lookAt(position, position + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        instances[i].m_projector_proj      = glm::ortho(-20.0f, 20.0f, -20.0f, 20.0f, 0.1f, 60.0f);
+        instances[i].m_projector_view_proj = instances[i].m_projector_proj * instances[i].m_projector_view;
+        instances[i].m_selected_decal      = int32_t(i % type_permutations.size());
+    }
+
+    TripleBuffer<SimulationInput> input_buffer;
+    TripleBuffer<FrameSnapshot>   snapshot_buffer;
+
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 10000.0f);
+
+    auto simulate = [&]() {
+        if (!input_buffer.update())
+            return;
+
+        const SimulationInput& input    = input_buffer.read();
+        FrameSnapshot&         snapshot = snapshot_buffer.write();
+
+        double start = now_ms();
+
+        float     angle  = float(input.frame) * 0.01f;
+        glm::vec3 camera = glm::vec3(cosf(angle), 0.2f, sinf(angle)) * 1500.0f;
+
+        snapshot.frame         = input.frame;
+        snapshot.input_time_ms = input.time_ms;
+        snapshot.view          = glm::lookAt(camera, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        snapshot.projection    = projection;
+        snapshot.view_proj     = projection * snapshot.view;
+        snapshot.inv_view_proj = glm::inverse(snapshot.view_proj);
+        snapshot.camera_pos    = camera;
+
+        build_decal_draws(instances, type_permutations, input, snapshot.view_proj, snapshot);
+
+        snapshot.simulate_ms = now_ms() - start;
+
+        snapshot_buffer.publish();
+    };
+
+    std::unique_ptr<FrameWorker> worker;
+
+    if (threaded)
+        worker = std::make_unique<FrameWorker>(simulate);
+
+    FramePipelineStats stats;
+
+    double   start         = now_ms();
+    uint64_t rendered_from = 0;
+
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        SimulationInput& input = input_buffer.write();
+
+        input.frame            = i + 1;
+        input.time_ms          = now_ms();
+        input.width            = 1920;
+        input.height           = 1080;
+        input.decal_key_mask   = PERMUTATION_NORMAL_MAP | PERMUTATION_ALPHA_TEST;
+        input.ready_decal_keys = ~uint64_t(0);
+
+        input_buffer.publish();
+
+        if (worker)
+            worker->kick();
+        else
+            simulate();
+
+        snapshot_buffer.update();
+
+        const FrameSnapshot& snapshot = snapshot_buffer.read();
+
+        // The first threaded frames have nothing to draw yet, they still count towards throughput.
+        if (snapshot.frame > 0)
+        {
+            stats.latency_ms += now_ms() - snapshot.input_time_ms;
+            stats.latency_frames += double(input.frame - snapshot.frame);
+            stats.simulate_ms += snapshot.simulate_ms;
+            rendered_from++;
+        }
+
+        double render_start = now_ms();
+
+        spin_for(render_ms);
+
+        stats.render_ms += now_ms() - render_start;
+    }
+
+    if (worker)
+        worker->wait_idle();
+
+    stats.frames   = frames;
+    stats.frame_ms = frames > 0 ? (now_ms() - start) / frames : 0.0;
+
+    if (rendered_from > 0)
+    {
+        stats.latency_ms /= double(rendered_from);
+        stats.latency_frames /= double(rendered_from);
+        stats.simulate_ms /= double(rendered_from);
+    }
+
+    if (frames > 0)
+        stats.render_ms /= frames;
+
+    return stats;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+// Runs a step function on its own thread, once per kick(). Kicks that arrive while a step is running collapse into one more step,
+// which suits a producer that only ever publishes its newest result.
+class FrameWorker
+{
+public:
+    FrameWorker(std::function<void()> step);
+    ~FrameWorker();
+
+    void kick();
+
+    // Blocks until no step is running or pending, e.g. before the caller runs steps itself.
+    void wait_idle();
+
+private:
+    void run();
+
+private:
+    std::function<void()>   m_step;
+    std::mutex              m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    bool                    m_pending = false;
+    bool                    m_running = false;
+    bool                    m_quit    = false;
+    std::thread             m_thread;
+};
+
+struct FramePipelineStats
+{
+    uint32_t frames         = 0;
+    double   frame_ms       = 0.0; // Average time between frames on the render thread.
+    double   latency_ms     = 0.0; // Average age of the input a rendered frame was simulated from.
+    double   latency_frames = 0.0;
+    double   simulate_ms    = 0.0;
+    double   render_ms      = 0.0;
+};
+
+// Headless model of DeferredDecals::update(). The simulation step culls, LODs and sorts decal_count generated decals under an
+// orbiting camera with build_decal_draws(), the render step stands in for GL submission by spinning for render_ms. With threaded
+// set the two overlap through triple buffers, otherwise they run back to back like the single threaded loop.
+FramePipelineStats benchmark_frame_pipeline(bool threaded, uint32_t decal_count, double render_ms, uint32_t frames);
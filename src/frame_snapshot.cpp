@@ -0,0 +1,110 @@
+#include "frame_snapshot.h"
+#include "shader_permutation_flags.h"
+#include <algorithm>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void accumulate_camera_motion(CameraMotion& total, float heading_speed, float sideways_speed, float mouse_delta_x, float mouse_delta_y, float sensitivity, bool mouse_look, float delta)
+{
+    total.forward += heading_speed * delta;
+    total.right += sideways_speed * delta;
+
+    if (mouse_look)
+    {
+        total.pitch += mouse_delta_y * sensitivity;
+        total.yaw += mouse_delta_x * sensitivity;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+CameraMotion camera_motion_delta(const CameraMotion& from, const CameraMotion& to)
+{
+    CameraMotion motion;
+
+    motion.forward = to.forward - from.forward;
+    motion.right   = to.right - from.right;
+    motion.pitch   = to.pitch - from.pitch;
+    motion.yaw     = to.yaw - from.yaw;
+
+    return motion;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void build_decal_draws(const std::vector<DecalInstance>& instances, const std::vector<uint32_t>& type_permutations, const SimulationInput& input, const glm::mat4& view_proj, FrameSnapshot& snapshot)
+{
+    snapshot.draw_order.clear();
+    snapshot.draws.clear();
+
+    snapshot.decal_count             = uint32_t(instances.size());
+    snapshot.decals_frustum_culled   = 0;
+    snapshot.decals_occlusion_culled = 0;
+
+    for (int i = 0; i < DECAL_LOD_COUNT; i++)
+        snapshot.lod_counts[i] = 0;
+
+    const DecalCullSettings& culling = input.culling;
+
+    for (int i = 0; i < instances.size(); i++)
+    {
+        glm::vec3 corners[8];
+        decal_box_corners(instances[i].m_projector_view_proj, corners);
+
+        if (outside_frustum(view_proj, corners))
+        {
+            snapshot.decals_frustum_culled++;
+            continue;
+        }
+
+        // The pyramid is from a previous frame, so the box is tested from the camera that frame was rendered with.
+        if (culling.hiz_culling && input.occlusion && input.occlusion->pyramid.is_occluded(input.occlusion->view_proj, corners))
+        {
+            snapshot.decals_occlusion_culled++;
+            continue;
+        }
+
+        DecalLOD lod = DECAL_LOD_FULL;
+
+        if (culling.lod)
+            lod = select_decal_lod(decal_screen_area(view_proj, corners, input.width, input.height), culling.drop_area, culling.albedo_area);
+
+        snapshot.lod_counts[lod]++;
+
+        if (lod == DECAL_LOD_DROPPED)
+            continue;
+
+        uint32_t permutation = type_permutations[instances[i].m_selected_decal] | input.global_permutation;
+
+        // Small decals only write albedo, which also skips the TBN reads.
+        if (lod == DECAL_LOD_ALBEDO)
+            permutation &= ~PERMUTATION_NORMAL_MAP;
+
+        uint32_t key = permutation & input.decal_key_mask;
+
+        // Skip variants until the background compile has finished. Listing them once they are ready marks the decals dirty.
+        if ((input.ready_decal_keys & (uint64_t(1) << key)) == 0)
+            continue;
+
+        snapshot.draw_order.push_back({ key, i });
+    }
+
+    std::stable_sort(snapshot.draw_order.begin(), snapshot.draw_order.end(), [](const std::pair<uint32_t, int>& a, const std::pair<uint32_t, int>& b) { return a.first < b.first; });
+
+    snapshot.draws.resize(snapshot.draw_order.size());
+
+    for (int i = 0; i < snapshot.draw_order.size(); i++)
+    {
+        const DecalInstance& instance = instances[snapshot.draw_order[i].second];
+        DecalDraw&           draw     = snapshot.draws[i];
+
+        draw.view_proj     = instance.m_projector_view_proj;
+        draw.inv_view_proj = glm::inverse(instance.m_projector_view_proj);
+        draw.model         = glm::inverse(instance.m_projector_view);
+        draw.overlay_color = instance.m_decal_overlay_color;
+        draw.aspect_ratio  = instance.m_aspect_ratio;
+        draw.type          = instance.m_selected_decal;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <glm.hpp>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <stdint.h>
+#include "decal.h"
+#include "depth_pyramid.h"
+#include "picking.h"
+
+// Depth pyramid read back on the render thread together with the view-projection it was rendered with. Shared read-only with the
+// simulation thread.
+struct OcclusionSnapshot
+{
+    DepthPyramid pyramid;
+    glm::mat4    view_proj;
+};
+
+struct DecalCullSettings
+{
+    bool  hiz_culling = true;
+    bool  lod         = true;
+    float drop_area   = 4.0f;
+    float albedo_area = 4096.0f;
+};
+
+// Camera movement and mouse-look as running totals. The simulation applies the change since the last input it simulated, so motion
+// from inputs it skips is still applied. Doubles, since the totals only ever grow over a session.
+struct CameraMotion
+{
+    double forward = 0.0; // Distance moved along the view direction.
+    double right   = 0.0;
+    double pitch   = 0.0; // Mouse-look rotation, already scaled by the sensitivity.
+    double yaw     = 0.0;
+};
+
+// Everything the simulation reads from the render thread for one frame: input, UI settings and results only the GPU produces.
+// Requests are running counters, so the simulation never misses one even when it skips inputs.
+struct SimulationInput
+{
+    uint64_t frame   = 0;
+    double   time_ms = 0.0; // Capture time, used to measure input to render latency.
+    float    delta   = 0.0f;
+    uint32_t width   = 0;
+    uint32_t height  = 0;
+
+    // Camera controls.
+    CameraMotion camera_motion;
+
+    // Picking and placement.
+    bool       picking      = false;
+    glm::vec2  cursor_ndc   = glm::vec2(0.0f);
+    bool       gpu_picking  = false;
+    bool       gpu_pick_hit = false;
+    PickResult gpu_pick;
+    uint32_t   place_requests = 0;
+    uint32_t   clear_requests = 0;
+
+    // Projector.
+    float     projector_rotation    = 0.0f;
+    float     projector_size        = 0.0f;
+    float     projector_outer_depth = 0.0f;
+    float     projector_inner_depth = 0.0f;
+    int32_t   selected_decal        = 0;
+    glm::vec4 decal_overlay_color   = glm::vec4(1.0f);
+
+    // Culling.
+    DecalCullSettings                        culling;
+    uint32_t                                 global_permutation = 0;
+    uint32_t                                 decal_key_mask     = 0;
+    uint64_t                                 ready_decal_keys   = 0; // Bit per permutation key whose program has finished linking.
+    std::shared_ptr<const OcclusionSnapshot> occlusion;
+    bool                                     visualize_projectors = false;
+};
+
+// Per draw state for render_decals(), with the inverses already taken on the simulation thread.
+struct DecalDraw
+{
+    glm::mat4 view_proj;
+    glm::mat4 inv_view_proj;
+    glm::mat4 model;
+    glm::vec4 overlay_color;
+    glm::vec2 aspect_ratio;
+    int32_t   type;
+};
+
+// Immutable result of one simulation step. The render thread draws a frame from this alone.
+struct FrameSnapshot
+{
+    uint64_t frame         = 0;
+    double   input_time_ms = 0.0;
+    double   simulate_ms   = 0.0;
+
+    // Camera.
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 view_proj;
+    glm::mat4 inv_view_proj;
+    glm::vec3 camera_pos;
+
+    // Placement preview.
+    bool                   is_hit = false;
+    glm::mat4              projector_view_proj;
+    std::vector<glm::mat4> projectors; // Every placed projector, only filled while visualizing them.
+
+    // Decals, draw_order holds (permutation key, instance index) pairs sorted by key and draws is parallel to it.
+    std::vector<std::pair<uint32_t, int>> draw_order;
+    std::vector<DecalDraw>                draws;
+    uint32_t                              decal_count                 = 0;
+    uint32_t                              decals_frustum_culled       = 0;
+    uint32_t                              decals_occlusion_culled     = 0;
+    uint32_t                              lod_counts[DECAL_LOD_COUNT] = { 0 };
+};
+
+// Adds one frame of camera input to the running totals. Mouse movement only rotates the camera while mouse-look is held.
+void accumulate_camera_motion(CameraMotion& total, float heading_speed, float sideways_speed, float mouse_delta_x, float mouse_delta_y, float sensitivity, bool mouse_look, float delta);
+
+// Motion between two running totals.
+CameraMotion camera_motion_delta(const CameraMotion& from, const CameraMotion& to);
+
+// Frustum, occlusion and LOD culling followed by a stable sort by permutation. type_permutations holds the permutation flags of
+// each decal type.
+void build_decal_draws(const std::vector<DecalInstance>& instances, const std::vector<uint32_t>& type_permutations, const SimulationInput& input, const glm::mat4& view_proj, FrameSnapshot& snapshot);
@@ -0,0 +1,103 @@
+#include "frame_timer.h"
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+FrameTimer::FrameTimer()
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+FrameTimer::~FrameTimer()
+{
+    for (auto& frame : m_frames)
+    {
+        if (frame.query_pool.size() > 0)
+            glDeleteQueries(GLsizei(frame.query_pool.size()), frame.query_pool.data());
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FrameTimer::begin_frame()
+{
+    m_frame_index = (m_frame_index + 1) % FRAME_TIMER_LATENCY;
+    m_open_scopes.clear();
+
+    Frame& frame = m_frames[m_frame_index];
+
+    // This slot was last written FRAME_TIMER_LATENCY frames ago. If the GPU still hasn't finished it, keep the previous results.
+    if (frame.scopes.size() > 0)
+    {
+        GLint available = GL_TRUE;
+
+        for (int i = 0; i < frame.scopes.size() && available == GL_TRUE; i++)
+            glGetQueryObjectiv(frame.scopes[i].end, GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (available == GL_TRUE)
+        {
+            m_results.clear();
+
+            for (auto& scope : frame.scopes)
+            {
+                GLuint64 start = 0;
+                GLuint64 end   = 0;
+
+                glGetQueryObjectui64v(scope.start, GL_QUERY_RESULT, &start);
+                glGetQueryObjectui64v(scope.end, GL_QUERY_RESULT, &end);
+
+                m_results.push_back({ scope.name, double(end - start) / 1000000.0 });
+            }
+        }
+    }
+
+    frame.scopes.clear();
+    frame.queries_used = 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FrameTimer::begin(const std::string& name)
+{
+    Frame& frame = m_frames[m_frame_index];
+
+    Scope scope;
+
+    scope.name  = name;
+    scope.start = allocate_query(frame);
+    scope.end   = allocate_query(frame);
+
+    glQueryCounter(scope.start, GL_TIMESTAMP);
+
+    m_open_scopes.push_back(uint32_t(frame.scopes.size()));
+    frame.scopes.push_back(scope);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FrameTimer::end()
+{
+    if (m_open_scopes.empty())
+        return;
+
+    Frame& frame = m_frames[m_frame_index];
+
+    glQueryCounter(frame.scopes[m_open_scopes.back()].end, GL_TIMESTAMP);
+    m_open_scopes.pop_back();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+GLuint FrameTimer::allocate_query(Frame& frame)
+{
+    if (frame.queries_used == frame.query_pool.size())
+    {
+        GLuint query;
+        glGenQueries(1, &query);
+        frame.query_pool.push_back(query);
+    }
+
+    return frame.query_pool[frame.queries_used++];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
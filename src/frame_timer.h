@@ -0,0 +1,51 @@
+#pragma once
+
+#include <ogl.h>
+#include <string>
+#include <vector>
+
+#define FRAME_TIMER_LATENCY 3
+
+struct FrameTimerResult
+{
+    std::string name;
+    double      time_ms;
+};
+
+// GPU timings from GL_TIMESTAMP query pairs. Results are read back FRAME_TIMER_LATENCY frames later so the CPU never waits on the
+// GPU, and scopes may be nested since each one records its own pair of timestamps.
+class FrameTimer
+{
+public:
+    FrameTimer();
+    ~FrameTimer();
+
+    void begin_frame();
+    void begin(const std::string& name);
+    void end();
+
+    inline const std::vector<FrameTimerResult>& results() { return m_results; }
+
+private:
+    struct Scope
+    {
+        std::string name;
+        GLuint      start;
+        GLuint      end;
+    };
+
+    struct Frame
+    {
+        std::vector<Scope>  scopes;
+        std::vector<GLuint> query_pool;
+        uint32_t            queries_used = 0;
+    };
+
+    GLuint allocate_query(Frame& frame);
+
+private:
+    Frame                         m_frames[FRAME_TIMER_LATENCY];
+    uint32_t                      m_frame_index = 0;
+    std::vector<uint32_t>         m_open_scopes;
+    std::vector<FrameTimerResult> m_results;
+};
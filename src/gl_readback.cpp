@@ -0,0 +1,64 @@
+#include "gl_readback.h"
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+GLReadbackBackend::Buffer GLReadbackBackend::create_buffer(size_t size)
+{
+    GLuint buffer = 0;
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return buffer;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLReadbackBackend::destroy_buffer(Buffer buffer)
+{
+    glDeleteBuffers(1, &buffer);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+GLReadbackBackend::Fence GLReadbackBackend::insert_fence()
+{
+    return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool GLReadbackBackend::is_signaled(Fence fence)
+{
+    // A zero timeout only polls, it never blocks.
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLReadbackBackend::destroy_fence(Fence fence)
+{
+    glDeleteSync(fence);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+const void* GLReadbackBackend::map(Buffer buffer, size_t size)
+{
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    return glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLReadbackBackend::unmap(Buffer buffer)
+{
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
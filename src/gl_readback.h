@@ -0,0 +1,18 @@
+#pragma once
+
+#include <ogl.h>
+
+// ReadbackRing backend on top of pixel pack buffers and sync objects.
+struct GLReadbackBackend
+{
+    typedef GLuint Buffer;
+    typedef GLsync Fence;
+
+    Buffer      create_buffer(size_t size);
+    void        destroy_buffer(Buffer buffer);
+    Fence       insert_fence();
+    bool        is_signaled(Fence fence);
+    void        destroy_fence(Fence fence);
+    const void* map(Buffer buffer, size_t size);
+    void        unmap(Buffer buffer);
+};
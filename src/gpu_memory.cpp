@@ -0,0 +1,214 @@
+#include "gpu_memory.h"
+#include <algorithm>
+#include <cstdio>
+
+const char* kGpuMemoryCategoryNames[GPU_MEMORY_CATEGORY_COUNT] = { "Render Targets", "Decal Textures", "Material Textures", "Buffers" };
+
+struct TextureFormatInfo
+{
+    uint32_t internal_format;
+    uint32_t bytes;
+    bool     compressed;
+};
+
+// Three channel formats are counted padded to four, which is how desktop drivers store them.
+static const TextureFormatInfo kTextureFormats[] = {
+    { 0x8229, 1, false },  // GL_R8
+    { 0x822B, 2, false },  // GL_RG8
+    { 0x8051, 4, false },  // GL_RGB8
+    { 0x8058, 4, false },  // GL_RGBA8
+    { 0x8C41, 4, false },  // GL_SRGB8
+    { 0x8C43, 4, false },  // GL_SRGB8_ALPHA8
+    { 0x8059, 4, false },  // GL_RGB10_A2
+    { 0x8C3A, 4, false },  // GL_R11F_G11F_B10F
+    { 0x822D, 2, false },  // GL_R16F
+    { 0x822F, 4, false },  // GL_RG16F
+    { 0x881B, 8, false },  // GL_RGB16F
+    { 0x881A, 8, false },  // GL_RGBA16F
+    { 0x822E, 4, false },  // GL_R32F
+    { 0x8230, 8, false },  // GL_RG32F
+    { 0x8815, 16, false }, // GL_RGB32F
+    { 0x8814, 16, false }, // GL_RGBA32F
+    { 0x8236, 4, false },  // GL_R32UI
+    { 0x823C, 8, false },  // GL_RG32UI
+    { 0x8D70, 16, false }, // GL_RGBA32UI
+    { 0x81A5, 2, false },  // GL_DEPTH_COMPONENT16
+    { 0x81A6, 4, false },  // GL_DEPTH_COMPONENT24
+    { 0x8CAC, 4, false },  // GL_DEPTH_COMPONENT32F
+    { 0x88F0, 4, false },  // GL_DEPTH24_STENCIL8
+    { 0x8CAD, 8, false },  // GL_DEPTH32F_STENCIL8
+    { 0x83F0, 8, true },   // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    { 0x83F1, 8, true },   // GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+    { 0x83F3, 16, true },  // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    { 0x8C4D, 8, true },   // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+    { 0x8DBD, 16, true },  // GL_COMPRESSED_RG_RGTC2
+    { 0x8E8C, 16, true },  // GL_COMPRESSED_RGBA_BPTC_UNORM
+    { 0x8E8D, 16, true }   // GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t texture_format_bytes(uint32_t internal_format, bool* compressed)
+{
+    for (auto& format : kTextureFormats)
+    {
+        if (format.internal_format == internal_format)
+        {
+            if (compressed)
+                *compressed = format.compressed;
+
+            return format.bytes;
+        }
+    }
+
+    if (compressed)
+        *compressed = false;
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t texture_level_bytes(const TextureDesc& desc, uint32_t level)
+{
+    bool     compressed = false;
+    uint64_t unit_bytes = texture_format_bytes(desc.internal_format, &compressed);
+    uint64_t width      = std::max(desc.width >> level, 1u);
+    uint64_t height     = std::max(desc.height >> level, 1u);
+
+    // Compressed levels are stored in whole blocks, so the 2x2 and 1x1 levels still take up a full 4x4 block.
+    if (compressed)
+        return ((width + 3) / 4) * ((height + 3) / 4) * unit_bytes * desc.array_size;
+    else
+        return width * height * unit_bytes * desc.array_size;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t texture_bytes(const TextureDesc& desc, uint32_t base_level)
+{
+    uint64_t bytes = 0;
+
+    for (uint32_t i = base_level; i < desc.mip_levels; i++)
+        bytes += texture_level_bytes(desc, i);
+
+    return bytes;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t select_mip_bias(const std::vector<TextureDesc>& textures, uint64_t fixed_bytes, uint64_t budget, uint32_t max_bias)
+{
+    if (budget == 0)
+        return 0;
+
+    for (uint32_t bias = 0; bias < max_bias; bias++)
+    {
+        uint64_t bytes = fixed_bytes;
+
+        // Textures always keep their last level, however large the bias.
+        for (auto& desc : textures)
+            bytes += texture_bytes(desc, std::min(bias, desc.mip_levels - 1));
+
+        if (bytes <= budget)
+            return bias;
+    }
+
+    return max_bias;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::string format_bytes(uint64_t bytes)
+{
+    char buffer[32];
+
+    if (bytes >= 1024 * 1024)
+        snprintf(buffer, sizeof(buffer), "%.2f MB", double(bytes) / (1024.0 * 1024.0));
+    else if (bytes >= 1024)
+        snprintf(buffer, sizeof(buffer), "%.2f KB", double(bytes) / 1024.0);
+    else
+        snprintf(buffer, sizeof(buffer), "%u B", uint32_t(bytes));
+
+    return buffer;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GpuMemoryRegistry::track(const std::string& name, GpuMemoryCategory category, uint64_t bytes)
+{
+    untrack(name);
+
+    m_allocations[name] = { category, bytes };
+    m_category_bytes[category] += bytes;
+    m_peak_bytes = std::max(m_peak_bytes, total_bytes());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GpuMemoryRegistry::track_texture(const std::string& name, GpuMemoryCategory category, const TextureDesc& desc, uint32_t base_level)
+{
+    track(name, category, texture_bytes(desc, base_level));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GpuMemoryRegistry::untrack(const std::string& name)
+{
+    auto it = m_allocations.find(name);
+
+    if (it == m_allocations.end())
+        return;
+
+    m_category_bytes[it->second.category] -= it->second.bytes;
+    m_allocations.erase(it);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t GpuMemoryRegistry::category_bytes(GpuMemoryCategory category) const
+{
+    return m_category_bytes[category];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t GpuMemoryRegistry::total_bytes() const
+{
+    uint64_t total = 0;
+
+    for (int i = 0; i < GPU_MEMORY_CATEGORY_COUNT; i++)
+        total += m_category_bytes[i];
+
+    return total;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::string GpuMemoryRegistry::report() const
+{
+    std::string report = "GPU memory: " + format_bytes(total_bytes()) + " in " + std::to_string(m_allocations.size()) + " allocations (peak " + format_bytes(m_peak_bytes) + ")\n";
+
+    for (int i = 0; i < GPU_MEMORY_CATEGORY_COUNT; i++)
+    {
+        report += std::string("  ") + kGpuMemoryCategoryNames[i] + ": " + format_bytes(m_category_bytes[i]) + "\n";
+
+        // Largest allocations first, since those are the ones worth cutting.
+        std::vector<std::pair<uint64_t, std::string>> allocations;
+
+        for (auto& allocation : m_allocations)
+        {
+            if (allocation.second.category == i)
+                allocations.push_back({ allocation.second.bytes, allocation.first });
+        }
+
+        std::sort(allocations.begin(), allocations.end(), [](const std::pair<uint64_t, std::string>& a, const std::pair<uint64_t, std::string>& b) { return a.first > b.first; });
+
+        for (auto& allocation : allocations)
+            report += "    " + allocation.second + ": " + format_bytes(allocation.first) + "\n";
+    }
+
+    return report;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
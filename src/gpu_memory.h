@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+enum GpuMemoryCategory
+{
+    GPU_MEMORY_RENDER_TARGETS = 0,
+    GPU_MEMORY_DECAL_TEXTURES,
+    GPU_MEMORY_MATERIAL_TEXTURES,
+    GPU_MEMORY_BUFFERS,
+    GPU_MEMORY_CATEGORY_COUNT
+};
+
+extern const char* kGpuMemoryCategoryNames[GPU_MEMORY_CATEGORY_COUNT];
+
+// Size of a texture as the driver would allocate it. internal_format is the numeric GL enum, looked up in a table of its own so
+// accounting doesn't need a context.
+struct TextureDesc
+{
+    uint32_t internal_format = 0;
+    uint32_t width           = 0;
+    uint32_t height          = 0;
+    uint32_t array_size      = 1;
+    uint32_t mip_levels      = 1;
+};
+
+// Bytes per texel, or per 4x4 block for compressed formats. Returns 0 for formats missing from the table.
+uint32_t texture_format_bytes(uint32_t internal_format, bool* compressed = nullptr);
+
+// Bytes of a single mip level, over every array layer.
+uint64_t texture_level_bytes(const TextureDesc& desc, uint32_t level);
+
+// Bytes of the mip chain starting at base_level, so dropping the top levels of a texture can be costed before it happens.
+uint64_t texture_bytes(const TextureDesc& desc, uint32_t base_level = 0);
+
+// Smallest number of top mip levels to drop from every texture so that fixed_bytes plus the textures fit in budget. Returns
+// max_bias when even that doesn't fit. A budget of 0 means unlimited.
+uint32_t select_mip_bias(const std::vector<TextureDesc>& textures, uint64_t fixed_bytes, uint64_t budget, uint32_t max_bias);
+
+std::string format_bytes(uint64_t bytes);
+
+// Records the size of every live GPU allocation by name. Tracking a name again replaces its previous size, so resources that are
+// recreated on resize or settings changes are never counted twice.
+class GpuMemoryRegistry
+{
+public:
+    void track(const std::string& name, GpuMemoryCategory category, uint64_t bytes);
+    void track_texture(const std::string& name, GpuMemoryCategory category, const TextureDesc& desc, uint32_t base_level = 0);
+    void untrack(const std::string& name);
+
+    uint64_t    category_bytes(GpuMemoryCategory category) const;
+    uint64_t    total_bytes() const;
+    std::string report() const;
+
+    inline uint64_t peak_bytes() const { return m_peak_bytes; }
+    inline uint32_t allocation_count() const { return uint32_t(m_allocations.size()); }
+
+private:
+    struct Allocation
+    {
+        GpuMemoryCategory category;
+        uint64_t          bytes;
+    };
+
+    std::map<std::string, Allocation> m_allocations;
+    uint64_t                          m_category_bytes[GPU_MEMORY_CATEGORY_COUNT] = { 0 };
+    uint64_t                          m_peak_bytes                                = 0;
+};
@@ -0,0 +1,172 @@
+#include "light_culling.h"
+#include <algorithm>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t light_tile_count(uint32_t pixels)
+{
+    return (pixels + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool sphere_screen_rect(const glm::vec3& center, float radius, const glm::mat4& proj, glm::vec4& rect)
+{
+    // Near plane distance of a standard OpenGL perspective projection.
+    float near_plane = proj[3][2] / (proj[2][2] - 1.0f);
+
+    if (center.z - radius > -near_plane)
+        return false;
+
+    // Spheres crossing the near plane can project anywhere on screen.
+    if (center.z + radius > -near_plane)
+    {
+        rect = glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f);
+        return true;
+    }
+
+    // Seeded outside the screen, so a sphere that is off screen ends up outside it too.
+    rect = glm::vec4(INFINITY, INFINITY, -INFINITY, -INFINITY);
+
+    // The projection of the bounding box encloses the projection of the sphere.
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner = center + glm::vec3((i & 1) ? radius : -radius, (i & 2) ? radius : -radius, (i & 4) ? radius : -radius);
+        glm::vec4 clip   = proj * glm::vec4(corner, 1.0f);
+        glm::vec2 ndc    = glm::vec2(clip.x, clip.y) / clip.w;
+
+        rect.x = std::min(rect.x, ndc.x);
+        rect.y = std::min(rect.y, ndc.y);
+        rect.z = std::max(rect.z, ndc.x);
+        rect.w = std::max(rect.w, ndc.y);
+    }
+
+    if (rect.z < -1.0f || rect.x > 1.0f || rect.w < -1.0f || rect.y > 1.0f)
+        return false;
+
+    rect = glm::clamp(rect, glm::vec4(-1.0f), glm::vec4(1.0f));
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+float linear_depth(float depth, const glm::mat4& inv_proj)
+{
+    glm::vec4 p = inv_proj * glm::vec4(0.0f, 0.0f, depth * 2.0f - 1.0f, 1.0f);
+    return -p.z / p.w;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void build_light_grid(const Light* lights, uint32_t light_count, const glm::mat4& view, const glm::mat4& proj, uint32_t width, uint32_t height, const glm::vec2* tile_depth_bounds, LightGrid& grid)
+{
+    grid.tiles_x = light_tile_count(width);
+    grid.tiles_y = light_tile_count(height);
+
+    uint32_t tile_count = grid.tiles_x * grid.tiles_y;
+
+    grid.tiles.assign(tile_count, glm::uvec2(0));
+    grid.indices.clear();
+
+    glm::mat4 inv_proj = glm::inverse(proj);
+
+    std::vector<glm::vec2> tile_ranges;
+
+    if (tile_depth_bounds)
+    {
+        tile_ranges.resize(tile_count);
+
+        for (uint32_t i = 0; i < tile_count; i++)
+            tile_ranges[i] = glm::vec2(linear_depth(tile_depth_bounds[i].x, inv_proj), linear_depth(tile_depth_bounds[i].y, inv_proj));
+    }
+
+    // First pass counts lights per tile and remembers each light's tile rectangle for the second pass.
+    std::vector<glm::uvec4> light_tiles(light_count);
+    std::vector<bool>       light_visible(light_count, false);
+
+    for (uint32_t i = 0; i < light_count; i++)
+    {
+        glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(lights[i].position_range), 1.0f));
+        float     radius = lights[i].position_range.w;
+
+        glm::vec4 rect;
+
+        if (!sphere_screen_rect(center, radius, proj, rect))
+            continue;
+
+        glm::uvec4 tiles;
+
+        tiles.x = std::min(uint32_t((rect.x * 0.5f + 0.5f) * width) / LIGHT_TILE_SIZE, grid.tiles_x - 1);
+        tiles.y = std::min(uint32_t((rect.y * 0.5f + 0.5f) * height) / LIGHT_TILE_SIZE, grid.tiles_y - 1);
+        tiles.z = std::min(uint32_t((rect.z * 0.5f + 0.5f) * width) / LIGHT_TILE_SIZE, grid.tiles_x - 1);
+        tiles.w = std::min(uint32_t((rect.w * 0.5f + 0.5f) * height) / LIGHT_TILE_SIZE, grid.tiles_y - 1);
+
+        light_tiles[i]   = tiles;
+        light_visible[i] = true;
+
+        float distance = -center.z;
+
+        for (uint32_t y = tiles.y; y <= tiles.w; y++)
+        {
+            for (uint32_t x = tiles.x; x <= tiles.z; x++)
+            {
+                uint32_t tile = y * grid.tiles_x + x;
+
+                if (tile_depth_bounds && (distance + radius < tile_ranges[tile].x || distance - radius > tile_ranges[tile].y))
+                    continue;
+
+                grid.tiles[tile].y++;
+            }
+        }
+    }
+
+    uint32_t offset = 0;
+
+    grid.overflow_tiles = 0;
+
+    for (auto& tile : grid.tiles)
+    {
+        if (tile.y > MAX_LIGHTS_PER_TILE)
+        {
+            tile.y = MAX_LIGHTS_PER_TILE;
+            grid.overflow_tiles++;
+        }
+
+        tile.x = offset;
+        offset += tile.y;
+        tile.y = 0;
+    }
+
+    grid.indices.resize(offset);
+
+    // Second pass writes indices in light order, so each tile's list is sorted.
+    for (uint32_t i = 0; i < light_count; i++)
+    {
+        if (!light_visible[i])
+            continue;
+
+        const glm::uvec4& tiles    = light_tiles[i];
+        float             distance = -(view * glm::vec4(glm::vec3(lights[i].position_range), 1.0f)).z;
+        float             radius   = lights[i].position_range.w;
+
+        for (uint32_t y = tiles.y; y <= tiles.w; y++)
+        {
+            for (uint32_t x = tiles.x; x <= tiles.z; x++)
+            {
+                uint32_t tile = y * grid.tiles_x + x;
+
+                if (tile_depth_bounds && (distance + radius < tile_ranges[tile].x || distance - radius > tile_ranges[tile].y))
+                    continue;
+
+                // An overflowing tile keeps the lights that came first.
+                if (grid.tiles[tile].y == MAX_LIGHTS_PER_TILE)
+                    continue;
+
+                grid.indices[grid.tiles[tile].x + grid.tiles[tile].y++] = i;
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glm.hpp>
+#include <vector>
+#include <stdint.h>
+
+// Must match light_culling_cs.glsl and deferred_shading_fs.glsl.
+#define LIGHT_TILE_SIZE 16
+#define MAX_LIGHTS_PER_TILE 256
+
+enum LightType
+{
+    LIGHT_TYPE_POINT = 0,
+    LIGHT_TYPE_SPOT  = 1
+};
+
+// std430 layout, four vec4 texels per light when read through a buffer texture.
+struct Light
+{
+    glm::vec4 position_range;  // xyz: world position, w: range
+    glm::vec4 color_intensity; // rgb: color, a: intensity
+    glm::vec4 direction_type;  // xyz: spot direction, w: LightType
+    glm::vec4 spot_angles;     // x: cos inner angle, y: cos outer angle
+};
+
+// Per tile (offset, count) pairs into a flat list of light indices, row major starting at the bottom-left tile.
+struct LightGrid
+{
+    uint32_t                tiles_x        = 0;
+    uint32_t                tiles_y        = 0;
+    uint32_t                overflow_tiles = 0; // Tiles that touched more than MAX_LIGHTS_PER_TILE lights and dropped the rest.
+    std::vector<glm::uvec2> tiles;
+    std::vector<uint32_t>   indices;
+};
+
+uint32_t light_tile_count(uint32_t pixels);
+
+// Conservative NDC rectangle (min xy, max xy) covered by a view space sphere. Returns false when the sphere is behind the near
+// plane or off screen.
+bool sphere_screen_rect(const glm::vec3& center, float radius, const glm::mat4& proj, glm::vec4& rect);
+
+// Converts a [0, 1] window space depth into a positive view space distance.
+float linear_depth(float depth, const glm::mat4& inv_proj);
+
+// CPU reference for light_culling_cs.glsl. tile_depth_bounds holds a (min, max) window space depth per tile, or is null to
+// test against the full depth range. Like the shader, a tile keeps at most MAX_LIGHTS_PER_TILE lights, here the first ones in
+// light order.
+void build_light_grid(const Light* lights, uint32_t light_count, const glm::mat4& view, const glm::mat4& proj, uint32_t width, uint32_t height, const glm::vec2* tile_depth_bounds, LightGrid& grid);
@@ -8,19 +8,51 @@
 #include <stack>
 #include <random>
 #include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cstddef>
+#include <mutex>
+#include <set>
 #include <random>
-#include <rtccore.h>
-#include <rtcore_geometry.h>
-#include <rtcore_common.h>
-#include <rtcore_ray.h>
-#include <rtcore_device.h>
-#include <rtcore_scene.h>
 #include <assimp/scene.h>
+#include "shader_cache.h"
+#include "shader_permutation.h"
+#include "frame_timer.h"
+#include "light_culling.h"
+#include "decal.h"
+#include "depth_pyramid.h"
+#include "ray_scene.h"
+#include "readback_ring.h"
+#include "gl_readback.h"
+#include "picking.h"
+#include "triple_buffer.h"
+#include "frame_snapshot.h"
+#include "frame_pipeline.h"
+#include "gpu_memory.h"
+#include "texture_compression.h"
+#include "texture_container.h"
+#include "visibility_buffer.h"
+#include "render_graph.h"
+#include "task_graph.h"
 
 #define CAMERA_FAR_PLANE 10000.0f
 #define PROJECTOR_BACK_OFF_DISTANCE 10.0f
 #define ALBEDO_TEXTURE_SIZE 4096
 #define DEPTH_TEXTURE_SIZE 512
+#define LIGHT_TILE_BUFFER_BINDING 1
+#define LIGHT_INDEX_BUFFER_BINDING 2
+#define HIZ_READBACK_FRAMES 3
+#define HIZ_READBACK_WIDTH 160
+#define PICK_READBACK_FRAMES 3
+#define INSTANCE_BENCHMARK_COUNT 1000
+#define INSTANCE_BENCHMARK_ITERATIONS 10
+#define PIPELINE_BENCHMARK_DECALS 10000
+#define PIPELINE_BENCHMARK_RENDER_MS 8.0
+#define PIPELINE_BENCHMARK_FRAMES 300
+#define GPU_MEMORY_BUDGET_MB 0 // 0 is unlimited.
+#define DECAL_CACHE_EXTENSION ".ddtex"
+#define G_BUFFER_TRAFFIC_FRAMES 3
 
 struct GlobalUniforms
 {
@@ -32,24 +64,124 @@ struct GlobalUniforms
     glm::vec4 cam_pos;
 };
 
-struct DecalInstance
+struct SceneObject
 {
-    // Last hit
-    glm::vec3 m_hit_pos;
-    glm::vec3 m_hit_normal;
-    float     m_hit_distance = INFINITY;
+    const char* mesh;
+    glm::vec3   position;
+    float       scale;
+    bool        optional; // Skipped with a warning when the mesh is missing.
+};
 
-    // Projector
-    glm::vec3 m_projector_pos;
-    glm::vec3 m_projector_dir;
-    glm::mat4 m_projector_view;
-    glm::mat4 m_projector_view_proj;
-    glm::mat4 m_projector_proj;
-    glm::vec4 m_decal_overlay_color;
-    glm::vec2 m_aspect_ratio;
+// Objects sharing a mesh are drawn with one instanced draw per submesh and share one bottom-level Embree scene. The teapots along
+// the nave keep several meshes and instances in the scene.
+static const SceneObject kSceneObjects[] = {
+    { "mesh/sponza.obj", glm::vec3(0.0f), 1.0f, false },
+    { "mesh/teapot.obj", glm::vec3(-1000.0f, 0.0f, 0.0f), 30.0f, true },
+    { "mesh/teapot.obj", glm::vec3(-500.0f, 0.0f, 0.0f), 30.0f, true },
+    { "mesh/teapot.obj", glm::vec3(0.0f, 0.0f, 0.0f), 30.0f, true },
+    { "mesh/teapot.obj", glm::vec3(500.0f, 0.0f, 0.0f), 30.0f, true },
+    { "mesh/teapot.obj", glm::vec3(1000.0f, 0.0f, 0.0f), 30.0f, true },
+    { "mesh/teapot.obj", glm::vec3(-1000.0f, 0.0f, 400.0f), 20.0f, true },
+    { "mesh/teapot.obj", glm::vec3(1000.0f, 0.0f, -400.0f), 20.0f, true }
+};
 
-    // Debug
-    int32_t m_selected_decal = 0;
+struct SceneMesh
+{
+    const char*           path;
+    dw::Mesh*             mesh;
+    uint32_t              ray_mesh;
+    std::vector<uint32_t> submesh_permutations;
+    std::vector<uint32_t> submesh_draw_order;
+    std::vector<uint32_t> instances;              // Indices into m_instances.
+    uint32_t              base_instance = 0;      // First transform of this mesh in the instance buffer.
+    uint32_t              base_draw     = 0;      // Visibility buffer draw of the first submesh.
+    std::vector<uint32_t> submesh_base_triangles; // First triangle of each submesh in VisibilityGeometry.
+    glm::vec3             min_extents;
+    glm::vec3             max_extents;
+};
+
+struct SceneInstance
+{
+    uint32_t  mesh;
+    glm::vec3 position;
+    float     scale;
+    uint32_t  ray_instance;
+};
+
+// Everything needed to turn a read back Hi-Z level into a pyramid, as it was when the copy was issued. A resize recreates the
+// pyramid, so the current sizes may no longer describe the texels.
+struct HiZReadback
+{
+    glm::mat4 view_proj;
+    uint32_t  level;
+    uint32_t  width;
+    uint32_t  height;
+    uint32_t  screen_width;
+    uint32_t  screen_height;
+    uint64_t  scene_version;
+};
+
+struct DecalType
+{
+    const char* albedo;
+    const char* normal; // Optional, decals without one only write albedo.
+    bool        alpha_test;
+};
+
+enum FrameStage
+{
+    FRAME_STAGE_G_BUFFER = 0,
+    FRAME_STAGE_HIZ,
+    FRAME_STAGE_DECALS,
+    FRAME_STAGE_LIGHT_CULLING,
+    FRAME_STAGE_SHADING,
+    FRAME_STAGE_COUNT
+};
+
+enum FrameStageStatus
+{
+    FRAME_STAGE_SKIPPED = 0,
+    FRAME_STAGE_PARTIAL,
+    FRAME_STAGE_FULL
+};
+
+// Passes that write the surface data decals and shading read. The forward G-buffer only has a raster pass.
+enum GBufferTrafficPass
+{
+    G_BUFFER_TRAFFIC_RASTER = 0,
+    G_BUFFER_TRAFFIC_CLASSIFY,
+    G_BUFFER_TRAFFIC_RESOLVE,
+    G_BUFFER_TRAFFIC_PASS_COUNT
+};
+
+// GL_SAMPLES_PASSED per pass, so overdraw that survives the depth test is counted and fragments rejected by it are not.
+struct GBufferTrafficFrame
+{
+    GLuint   queries[G_BUFFER_TRAFFIC_PASS_COUNT];
+    uint32_t fragment_bytes[G_BUFFER_TRAFFIC_PASS_COUNT]; // Zero for passes the frame didn't run.
+    bool     visibility_buffer = false;
+    bool     pending           = false;
+};
+
+struct GBufferTraffic
+{
+    uint64_t bytes            = 0;
+    uint64_t raster_fragments = 0;
+};
+
+static const char* kFrameStageNames[]       = { "G-Buffer", "Hi-Z", "Decals", "Light Culling", "Shading" };
+static const char* kFrameStageStatusNames[] = { "Skipped", "Partial", "Full" };
+static const char* kRenderPathNames[]       = { "G-Buffer", "Visibility Buffer" };
+
+static const DecalType kDecalTypes[] = {
+    { "texture/Decal_00_Albedo.tga", "texture/Decal_00_Normal.png", true },
+    { "texture/Decal_01_Albedo.tga", "texture/Decal_01_Normal.png", true },
+    { "texture/Decal_02_Albedo.tga", "texture/Decal_02_Normal.png", true },
+    { "texture/Decal_03_Albedo.tga", "texture/Decal_03_Normal.png", true },
+    { "texture/Decal_04_Albedo.tga", "texture/Decal_04_Normal.png", true },
+    { "texture/Decal_05_Albedo.tga", "texture/Decal_05_Normal.png", true },
+    { "texture/Decal_06_Albedo.tga", "texture/Decal_06_Normal.png", true },
+    { "texture/Decal_07_Albedo.tga", "texture/Decal_07_Normal.png", true }
 };
 
 class DeferredDecals : public dw::Application
@@ -59,32 +191,15 @@ protected:
 
     bool init(int argc, const char* argv[]) override
     {
-        // Create GPU resources.
-        if (!create_shaders())
-            return false;
-
-        if (!create_uniform_buffer())
-            return false;
-
-        // Load scene.
-        if (!load_scene())
-            return false;
-
-        if (!load_decals())
+        if (!run_startup_tasks())
             return false;
 
-        if (!initialize_embree())
-            return false;
-
-        create_cube();
-        create_textures();
-        create_framebuffers();
+        // Publish a first snapshot inline so the render thread never draws an empty one.
+        gather_simulation_input();
+        simulation_step();
+        m_snapshot_buffer.update();
 
-        // Create camera.
-        create_camera();
-
-        m_transform = glm::mat4(1.0f);
-        m_transform = glm::scale(m_transform, glm::vec3(1.0f));
+        m_simulation_worker = std::make_unique<FrameWorker>([this]() { simulation_step(); });
 
         return true;
     }
@@ -93,31 +208,54 @@ protected:
 
     void update(double delta) override
     {
-        // Update camera.
-        update_camera();
+        m_frame_timer->begin_frame();
+
+        if (m_debug_gui)
+            ui();
 
-        hit_scene();
+        update_instances();
+
+        gather_simulation_input();
+
+        // Threaded, the worker simulates this input while the frame below renders the newest finished snapshot, which is usually
+        // the previous frame's. Otherwise the step runs inline and the frame renders its own input.
+        if (m_threaded_simulation)
+            m_simulation_worker->kick();
+        else
+            simulation_step();
+
+        m_snapshot_buffer.update();
+
+        const FrameSnapshot& snapshot = m_snapshot_buffer.read();
+
+        m_global_uniforms.view_proj     = snapshot.view_proj;
+        m_global_uniforms.inv_view_proj = snapshot.inv_view_proj;
+        m_global_uniforms.cam_pos       = glm::vec4(snapshot.camera_pos, 0.0f);
 
         update_global_uniforms(m_global_uniforms);
 
-        if (m_debug_gui)
-            ui();
+        m_input_latency_ms     = steady_time_ms() - snapshot.input_time_ms;
+        m_input_latency_frames = uint32_t(m_frame_index - snapshot.frame);
 
-        render_g_buffer();
-        render_decals();
-        render_deferred_shading();
+        m_frame_timer->begin("Frame");
+
+        update_frame_stages();
+
+        if (build_render_graph())
+            m_render_graph.execute();
+
+        glDisable(GL_SCISSOR_TEST);
+
+        m_frame_timer->end();
 
         if (m_debug_gui)
         {
-            if (m_is_hit)
-                m_debug_draw.frustum(m_projector_view_proj, glm::vec3(1.0f, 0.0f, 0.0f));
+            if (snapshot.is_hit)
+                m_debug_draw.frustum(snapshot.projector_view_proj, glm::vec3(1.0f, 0.0f, 0.0f));
         }
 
-        if (m_visualize_projectors)
-        {
-            for (int i = 0; i < m_decal_instances.size(); i++)
-                m_debug_draw.frustum(m_decal_instances[i].m_projector_view_proj, glm::vec3(0.0f, 1.0f, 0.0f));
-        }
+        for (auto& projector : snapshot.projectors)
+            m_debug_draw.frustum(projector, glm::vec3(0.0f, 1.0f, 0.0f));
 
         m_debug_draw.render(nullptr, m_width, m_height, m_global_uniforms.view_proj);
     }
@@ -126,19 +264,56 @@ protected:
 
     void shutdown() override
     {
-        rtcReleaseGeometry(m_embree_triangle_mesh);
-        rtcReleaseScene(m_embree_scene);
-        rtcReleaseDevice(m_embree_device);
+        // Joins the simulation thread before anything it reads is destroyed.
+        m_simulation_worker.reset();
+
+        DW_LOG_INFO(m_gpu_memory.report());
+
+        GLuint light_textures[] = { m_light_texture, m_light_tile_texture, m_light_index_texture };
+        GLuint light_buffers[]  = { m_light_buffer, m_light_tile_buffer, m_light_index_buffer };
+
+        glDeleteTextures(3, light_textures);
+        glDeleteBuffers(3, light_buffers);
+
+        m_hiz_readback.reset();
+        m_pick_readback.reset();
+
+        glDeleteFramebuffers(GLsizei(m_hiz_fbos.size()), m_hiz_fbos.data());
+
+        glDeleteTextures(1, &m_instance_texture);
+        glDeleteBuffers(1, &m_instance_buffer);
+
+        GLuint visibility_textures[] = { m_visibility_vertex_texture, m_visibility_index_texture, m_triangle_draw_texture };
+        GLuint visibility_buffers[]  = { m_visibility_vertex_buffer, m_visibility_index_buffer, m_triangle_draw_buffer };
+
+        glDeleteTextures(3, visibility_textures);
+        glDeleteBuffers(3, visibility_buffers);
+
+        for (auto& traffic : m_g_buffer_traffic)
+            glDeleteQueries(G_BUFFER_TRAFFIC_PASS_COUNT, traffic.queries);
 
-        dw::Mesh::unload(m_mesh);
+        m_ray_scene.reset();
+
+        for (auto& mesh : m_scene_meshes)
+            dw::Mesh::unload(mesh.mesh);
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
     void window_resized(int width, int height) override
     {
-        // Override window resized method to update camera projection.
-        m_main_camera->update_projection(60.0f, 0.1f, CAMERA_FAR_PLANE, float(m_width) / float(m_height));
+        // A minimized window reports a zero size, keep the old targets until it comes back.
+        if (width <= 0 || height <= 0)
+            return;
+
+        // Everything sized from the window. The simulation thread owns the camera and updates its projection when the size in its
+        // input changes.
+        create_textures();
+        create_framebuffers();
+        allocate_light_tile_buffers();
+        create_hiz_resources();
+
+        enforce_memory_budget();
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
@@ -184,24 +359,9 @@ protected:
 
     void mouse_pressed(int code) override
     {
-        if (code == GLFW_MOUSE_BUTTON_RIGHT && m_is_hit && m_debug_gui)
-        {
-            DecalInstance instance;
-
-            instance.m_hit_pos             = m_hit_pos;
-            instance.m_hit_normal          = m_hit_normal;
-            instance.m_hit_distance        = m_hit_distance;
-            instance.m_projector_pos       = m_projector_pos;
-            instance.m_projector_dir       = m_projector_dir;
-            instance.m_projector_view      = m_projector_view;
-            instance.m_projector_proj      = m_projector_proj;
-            instance.m_projector_view_proj = m_projector_view_proj;
-            instance.m_selected_decal      = m_selected_decal;
-            instance.m_decal_overlay_color = m_decal_overlay_color;
-            instance.m_aspect_ratio        = m_projector_aspect_ratio;
-
-            m_decal_instances.push_back(instance);
-        }
+        // Placed on the simulation thread, which owns the last hit and the decal instances.
+        if (code == GLFW_MOUSE_BUTTON_RIGHT && m_debug_gui)
+            m_place_decal_requests++;
 
         // Enable mouse look.
         if (code == GLFW_MOUSE_BUTTON_LEFT)
@@ -242,202 +402,1281 @@ protected:
 private:
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void hit_scene()
+    void gather_simulation_input()
+    {
+        // Results only the GPU produces are polled here, the simulation thread never touches GL.
+        poll_hiz_readback();
+
+        if (m_gpu_picking)
+            poll_gpu_pick();
+
+        poll_g_buffer_traffic();
+
+        SimulationInput& input = m_input_buffer.write();
+
+        input.frame   = ++m_frame_index;
+        input.time_ms = steady_time_ms();
+        input.delta   = float(m_delta);
+        input.width   = m_width;
+        input.height  = m_height;
+
+        accumulate_camera_motion(m_camera_motion, m_heading_speed, m_sideways_speed, float(m_mouse_delta_x), float(m_mouse_delta_y), m_camera_sensitivity, m_mouse_look, float(m_delta));
+
+        input.camera_motion = m_camera_motion;
+
+        input.picking        = m_debug_gui;
+        input.cursor_ndc     = cursor_ndc();
+        input.gpu_picking    = m_gpu_picking;
+        input.gpu_pick_hit   = m_gpu_pick_hit;
+        input.gpu_pick       = m_gpu_pick;
+        input.place_requests = m_place_decal_requests;
+        input.clear_requests = m_clear_decal_requests;
+
+        input.projector_rotation    = m_projector_rotation;
+        input.projector_size        = m_projector_size;
+        input.projector_outer_depth = m_projector_outer_depth;
+        input.projector_inner_depth = m_projector_inner_depth;
+        input.selected_decal        = m_selected_decal;
+        input.decal_overlay_color   = m_decal_overlay_color;
+
+        input.culling.hiz_culling = m_hiz_culling;
+        input.culling.lod         = m_decal_lod;
+        input.culling.drop_area   = m_decal_lod_drop_area;
+        input.culling.albedo_area = m_decal_lod_albedo_area;
+        input.global_permutation  = global_permutation();
+        input.decal_key_mask      = m_decals_programs->key(UINT32_MAX);
+        input.ready_decal_keys    = 0;
+
+        // Program readiness can only be queried with the context current, so it is sent over as a bit per key.
+        for (auto flags : m_decal_permutations)
+        {
+            uint32_t variants[] = { flags | input.global_permutation, (flags & ~PERMUTATION_NORMAL_MAP) | input.global_permutation };
+
+            for (auto variant : variants)
+            {
+                uint32_t       key     = m_decals_programs->key(variant);
+                ShaderProgram* program = m_decals_programs->get(key);
+
+                if (program && program->is_ready())
+                    input.ready_decal_keys |= uint64_t(1) << key;
+            }
+        }
+
+        input.occlusion            = m_occlusion;
+        input.visualize_projectors = m_visualize_projectors;
+
+        m_input_buffer.publish();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void simulation_step()
     {
-        if (!m_debug_gui)
+        // Inputs published while the previous step was running are skipped, only the newest one is simulated. Camera motion and
+        // requests are running totals, so nothing the skipped inputs carried is lost.
+        if (!m_input_buffer.update())
             return;
 
-        double xpos, ypos;
-        glfwGetCursorPos(m_window, &xpos, &ypos);
+        FrameSnapshot& snapshot = m_snapshot_buffer.write();
+
+        simulate(m_input_buffer.read(), snapshot);
+
+        m_snapshot_buffer.publish();
+    }
 
-        glm::vec4 ndc_pos      = glm::vec4((2.0f * float(xpos)) / float(m_width) - 1.0f, 1.0 - (2.0f * float(ypos)) / float(m_height), -1.0f, 1.0f);
-        glm::vec4 view_coords  = glm::inverse(m_main_camera->m_projection) * ndc_pos;
-        glm::vec4 world_coords = glm::inverse(m_main_camera->m_view) * glm::vec4(view_coords.x, view_coords.y, -1.0f, 0.0f);
+    // -----------------------------------------------------------------------------------------------------------------------------------
 
-        glm::vec3 ray_dir = glm::normalize(glm::vec3(world_coords));
+    void simulate(const SimulationInput& input, FrameSnapshot& snapshot)
+    {
+        double start = steady_time_ms();
 
-        RTCRayHit rayhit;
+        snapshot.frame         = input.frame;
+        snapshot.input_time_ms = input.time_ms;
 
-        rayhit.ray.dir_x = ray_dir.x;
-        rayhit.ray.dir_y = ray_dir.y;
-        rayhit.ray.dir_z = ray_dir.z;
+        update_camera(input);
 
-        rayhit.ray.org_x = m_main_camera->m_position.x;
-        rayhit.ray.org_y = m_main_camera->m_position.y;
-        rayhit.ray.org_z = m_main_camera->m_position.z;
+        snapshot.view          = m_main_camera->m_view;
+        snapshot.projection    = m_main_camera->m_projection;
+        snapshot.view_proj     = m_main_camera->m_projection * m_main_camera->m_view;
+        snapshot.inv_view_proj = glm::inverse(snapshot.view_proj);
+        snapshot.camera_pos    = m_main_camera->m_position;
 
-        rayhit.ray.tnear     = 0;
-        rayhit.ray.tfar      = INFINITY;
-        rayhit.ray.mask      = 0;
-        rayhit.ray.flags     = 0;
-        rayhit.hit.geomID    = RTC_INVALID_GEOMETRY_ID;
-        rayhit.hit.instID[0] = RTC_INVALID_GEOMETRY_ID;
+        hit_scene(input, snapshot);
 
-        rtcIntersect1(m_embree_scene, &m_embree_intersect_context, &rayhit);
+        if (input.clear_requests != m_sim_clear_requests)
+        {
+            m_decal_instances.clear();
+            m_sim_clear_requests = input.clear_requests;
+        }
 
-        if (rayhit.ray.tfar != INFINITY)
+        if (input.place_requests != m_sim_place_requests)
         {
-            m_hit_pos      = m_main_camera->m_position + ray_dir * rayhit.ray.tfar;
-            m_hit_normal   = glm::normalize(glm::vec3(rayhit.hit.Ng_x, rayhit.hit.Ng_y, rayhit.hit.Ng_z));
-            m_hit_distance = rayhit.ray.tfar;
+            if (m_is_hit && input.picking)
+                place_decal(input);
 
-            m_projector_pos = m_hit_pos + m_hit_normal * m_projector_outer_depth;
-            m_projector_dir = -m_hit_normal;
+            m_sim_place_requests = input.place_requests;
+        }
 
-            glm::mat4 rotate = glm::mat4(1.0f);
+        snapshot.is_hit              = m_is_hit && input.picking;
+        snapshot.projector_view_proj = m_projector_view_proj;
 
-            rotate = glm::rotate(rotate, glm::radians(m_projector_rotation), m_projector_dir);
+        snapshot.projectors.clear();
 
-            glm::vec3 default_up = glm::vec3(0.0f, 0.0f, 1.0f);
+        if (input.visualize_projectors)
+        {
+            for (auto& instance : m_decal_instances)
+                snapshot.projectors.push_back(instance.m_projector_view_proj);
+        }
 
-            if (m_hit_normal.x > m_hit_normal.y && m_hit_normal.x > m_hit_normal.z)
-                default_up = glm::vec3(0.0f, -1.0f, 0.0f);
-            else if (m_hit_normal.z > m_hit_normal.y && m_hit_normal.z > m_hit_normal.x)
-                default_up = glm::vec3(0.0f, -1.0f, 0.0f);
+        // Sort by permutation so each variant is bound once. The sort is stable to keep placement order within a variant.
+        build_decal_draws(m_decal_instances, m_decal_permutations, input, snapshot.view_proj, snapshot);
 
-            glm::vec4 rotated_axis = rotate * glm::vec4(default_up, 0.0f);
+        snapshot.simulate_ms = steady_time_ms() - start;
+    }
 
-            if (m_decal_textures[m_selected_decal]->width() > m_decal_textures[m_selected_decal]->height())
-            {
-                m_projector_aspect_ratio.x = 1.0f;
-                m_projector_aspect_ratio.y = float(m_decal_textures[m_selected_decal]->width()) / float(m_decal_textures[m_selected_decal]->height());
-            }
-            else
-            {
-                m_projector_aspect_ratio.x = float(m_decal_textures[m_selected_decal]->height()) / float(m_decal_textures[m_selected_decal]->width());
-                m_projector_aspect_ratio.y = 1.0f;
-            }
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void hit_scene(const SimulationInput& input, const FrameSnapshot& snapshot)
+    {
+        if (!input.picking)
+            return;
 
-            m_projector_view      = glm::lookAt(m_projector_pos, m_hit_pos, glm::normalize(glm::vec3(rotated_axis) + glm::vec3(0.001f, 0.0f, 0.0f)));
-            m_projector_proj      = glm::ortho(-m_projector_size, m_projector_size, -m_projector_size, m_projector_size, 0.1f, m_projector_outer_depth + m_projector_inner_depth);
-            m_projector_view_proj = m_projector_proj * m_projector_view;
+        // GPU picks land a few frames after they are issued, in between the last hit is kept.
+        if (input.gpu_picking)
+        {
+            m_is_hit = input.gpu_pick_hit;
 
-            m_is_hit = true;
+            if (m_is_hit)
+            {
+                m_hit_pos      = input.gpu_pick.position;
+                m_hit_normal   = input.gpu_pick.normal;
+                m_hit_distance = input.gpu_pick.distance;
+            }
         }
         else
-            m_is_hit = false;
+            trace_cursor(input.cursor_ndc, snapshot);
+
+        if (m_is_hit)
+            update_projector(input);
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void render_g_buffer()
+    glm::vec2 cursor_ndc()
     {
-        render_scene(m_g_buffer_fbo.get(), m_g_buffer_program, 0, 0, m_width, m_height, GL_BACK);
+        double xpos, ypos;
+        glfwGetCursorPos(m_window, &xpos, &ypos);
+
+        return glm::vec2((2.0f * float(xpos)) / float(m_width) - 1.0f, 1.0f - (2.0f * float(ypos)) / float(m_height));
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void render_decals()
+    void trace_cursor(const glm::vec2& ndc, const FrameSnapshot& snapshot)
     {
-        glEnable(GL_DEPTH_TEST);
-        glDisable(GL_BLEND);
-        glDepthMask(GL_FALSE);
-        glDisable(GL_CULL_FACE);
+        // Unproject a point on the far plane with the matrix simulate() already inverted.
+        glm::vec4 far_pos = snapshot.inv_view_proj * glm::vec4(ndc, 1.0f, 1.0f);
+        glm::vec3 ray_dir = glm::normalize(glm::vec3(far_pos) / far_pos.w - snapshot.camera_pos);
 
-        m_decal_fbo->bind();
+        RayHit hit;
 
-        glViewport(0, 0, m_width, m_height);
+        {
+            std::lock_guard<std::mutex> lock(m_ray_scene_mutex);
+            m_is_hit = m_ray_scene->intersect(snapshot.camera_pos, ray_dir, hit);
+        }
 
-        // Bind shader program.
-        m_decals_program->use();
-        m_cube_vao->bind();
+        if (m_is_hit)
+        {
+            m_hit_pos      = snapshot.camera_pos + ray_dir * hit.distance;
+            m_hit_normal   = hit.normal;
+            m_hit_distance = hit.distance;
+        }
+    }
 
-        // Bind uniform buffers.
-        m_global_ubo->bind_base(0);
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void issue_gpu_pick()
+    {
+        glm::vec2 ndc = cursor_ndc();
+
+        if (ndc.x < -1.0f || ndc.x >= 1.0f || ndc.y < -1.0f || ndc.y >= 1.0f)
+            return;
+
+        GLuint pbo = 0;
+
+        if (!m_pick_readback->begin_write(pbo))
+            return;
+
+        m_frame_timer->begin("Picking");
 
-        for (int i = 0; i < m_decal_instances.size(); i++)
+        GLint x = GLint((ndc.x * 0.5f + 0.5f) * m_width);
+        GLint y = GLint((ndc.y * 0.5f + 0.5f) * m_height);
+
+        m_g_buffer_fbo->bind();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+
+        // Depth and the undecorated source normal, so a pick is never affected by decals already placed there. The visibility buffer
+        // has no normal to read, so its id is read instead and the normal rebuilt when the pick lands.
+        glReadPixels(x, y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, (void*)offsetof(PickTexel, depth));
+
+        if (m_visibility_buffer)
+            glReadPixels(x, y, 1, 1, GL_RG_INTEGER, GL_UNSIGNED_INT, (void*)offsetof(PickTexel, id));
+        else
         {
-            m_decals_program->set_uniform("u_InvDecalVP", glm::inverse(m_decal_instances[i].m_projector_view_proj));
-            m_decals_program->set_uniform("u_DecalVP", m_decal_instances[i].m_projector_view_proj);
-            m_decals_program->set_uniform("u_DecalModel", glm::inverse(m_decal_instances[i].m_projector_view));
-            m_decals_program->set_uniform("u_DecalOverlayColor", m_decal_instances[i].m_decal_overlay_color);
-            m_decals_program->set_uniform("u_AspectRatio", m_decal_instances[i].m_aspect_ratio);
+            glReadBuffer(GL_COLOR_ATTACHMENT2);
+            glReadPixels(x, y, 1, 1, m_packed_g_buffer ? GL_RG : GL_RGB, GL_FLOAT, (void*)offsetof(PickTexel, normal));
+            glReadBuffer(GL_COLOR_ATTACHMENT0);
+        }
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // Unprojected with the camera the G-buffer was rendered from, which may lag the simulation by a frame.
+        PickRequest request;
 
-            if (m_decals_program->set_uniform("s_Decal", 0))
-                m_decal_textures[m_decal_instances[i].m_selected_decal]->bind(0);
+        request.ndc           = ndc;
+        request.inv_view_proj = m_global_uniforms.inv_view_proj;
+        request.camera_pos    = glm::vec3(m_global_uniforms.cam_pos);
+        request.packed_normal = m_packed_g_buffer;
+        request.visibility_id = m_visibility_buffer;
 
-            if (m_decals_program->set_uniform("s_DecalNormal", 1))
-                m_decal_normal_textures[m_decal_instances[i].m_selected_decal]->bind(1);
+        m_pick_readback->end_write(request);
 
-            if (m_decals_program->set_uniform("s_Depth", 2))
-                m_depth_rt->bind(2);
+        m_frame_timer->end();
+    }
 
-            if (m_decals_program->set_uniform("s_SourceNormal", 3))
-                m_g_buffer_2_rt->bind(3);
+    // -----------------------------------------------------------------------------------------------------------------------------------
 
-            if (m_decals_program->set_uniform("s_Tangent", 4))
-                m_g_buffer_3_rt->bind(4);
+    void poll_gpu_pick()
+    {
+        m_pick_readback->consume_latest([this](const void* data, const PickRequest& request) {
+            const PickTexel& texel = *(const PickTexel*)data;
 
-            if (m_decals_program->set_uniform("s_Bitangent", 5))
-                m_g_buffer_4_rt->bind(5);
+            m_gpu_pick_hit = resolve_pick(texel, request, m_gpu_pick);
 
-            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0);
+            if (m_gpu_pick_hit && request.visibility_id)
+            {
+                VisibilityAttributes attributes;
+
+                // Instances may have moved since the id was written, the normal is still close enough to orient a projector.
+                m_gpu_pick_hit    = resolve_visibility(m_visibility_geometry, m_instance_transforms, glm::inverse(request.inv_view_proj), glm::uvec2(texel.id[0], texel.id[1]), request.ndc, glm::vec2(m_width, m_height), attributes);
+                m_gpu_pick.normal = attributes.normal;
+            }
+        });
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void update_projector(const SimulationInput& input)
+    {
+        DecalProjector projector = build_decal_projector(m_hit_pos, m_hit_normal, input.projector_rotation, input.projector_size, input.projector_outer_depth, input.projector_inner_depth);
+
+        m_projector_pos          = projector.position;
+        m_projector_dir          = projector.direction;
+        m_projector_view         = projector.view;
+        m_projector_proj         = projector.proj;
+        m_projector_view_proj    = projector.view_proj;
+        m_projector_aspect_ratio = m_decal_aspect_ratios[input.selected_decal];
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void place_decal(const SimulationInput& input)
+    {
+        DecalInstance instance;
+
+        instance.m_hit_pos             = m_hit_pos;
+        instance.m_hit_normal          = m_hit_normal;
+        instance.m_hit_distance        = m_hit_distance;
+        instance.m_projector_pos       = m_projector_pos;
+        instance.m_projector_dir       = m_projector_dir;
+        instance.m_projector_view      = m_projector_view;
+        instance.m_projector_proj      = m_projector_proj;
+        instance.m_projector_view_proj = m_projector_view_proj;
+        instance.m_selected_decal      = input.selected_decal;
+        instance.m_decal_overlay_color = input.decal_overlay_color;
+        instance.m_aspect_ratio        = m_projector_aspect_ratio;
+
+        m_decal_instances.push_back(instance);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void render_g_buffer()
+    {
+        GBufferTrafficFrame* traffic = &m_g_buffer_traffic[m_frame_index % G_BUFFER_TRAFFIC_FRAMES];
+
+        // A slot whose results haven't landed yet is left alone, so this frame just isn't measured.
+        if (traffic->pending)
+            traffic = nullptr;
+        else
+        {
+            traffic->visibility_buffer = m_visibility_buffer;
+            std::fill(traffic->fragment_bytes, traffic->fragment_bytes + G_BUFFER_TRAFFIC_PASS_COUNT, 0);
         }
 
-        glDepthMask(GL_TRUE);
+        m_frame_timer->begin("G-Buffer");
+
+        if (m_visibility_buffer)
+            render_visibility_buffer(traffic);
+        else
+        {
+            begin_g_buffer_traffic(traffic, G_BUFFER_TRAFFIC_RASTER, fragment_bytes({ m_g_buffer_0_rt.get(), m_g_buffer_1_rt.get(), m_g_buffer_2_rt.get(), m_g_buffer_3_rt, m_g_buffer_4_rt, m_depth_rt.get() }));
+            render_scene(m_g_buffer_fbo.get(), m_g_buffer_programs.get(), 0, 0, m_width, m_height, GL_BACK);
+            end_g_buffer_traffic(traffic);
+        }
+
+        m_frame_timer->end();
+
+        if (traffic)
+            traffic->pending = true;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void render_deferred_shading()
+    void render_visibility_buffer(GBufferTrafficFrame* traffic)
     {
-        glDisable(GL_DEPTH_TEST);
-        glDisable(GL_CULL_FACE);
-        glDisable(GL_BLEND);
+        static const GLuint  kBackground[] = { 0, 0, 0, 0 };
+        static const GLfloat kFarDepth     = 1.0f;
 
-        //m_direct_light_fbo->bind();
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // Only ids and depth are rasterized. Integer targets are cleared explicitly, glClearColor() doesn't apply to them.
+        m_g_buffer_fbo->bind();
+
+        glDepthMask(GL_TRUE);
+        glClearBufferuiv(GL_COLOR, 0, kBackground);
+        glClearBufferfv(GL_DEPTH, 0, &kFarDepth);
 
+        begin_g_buffer_traffic(traffic, G_BUFFER_TRAFFIC_RASTER, fragment_bytes({ m_visibility_rt.get(), m_depth_rt.get() }));
+        render_scene(m_g_buffer_fbo.get(), m_visibility_programs.get(), 0, 0, m_width, m_height, GL_BACK, false);
+        end_g_buffer_traffic(traffic);
+
+        m_visibility_resolve_fbo->bind();
+
+        glDisable(GL_CULL_FACE);
         glViewport(0, 0, m_width, m_height);
 
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        glClearDepth(1.0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Bind shader program.
-        m_deferred_shading_program->use();
+        // Classify every covered pixel by the draw, i.e. material, its triangle belongs to.
+        m_frame_timer->begin("Material Classification");
 
-        if (m_deferred_shading_program->set_uniform("s_Albedo", 0))
-            m_g_buffer_0_rt->bind(0);
+        glDepthFunc(GL_ALWAYS);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 
-        if (m_deferred_shading_program->set_uniform("s_Normals", 1))
-            m_g_buffer_1_rt->bind(1);
+        m_material_classify_program->use();
 
-        if (m_deferred_shading_program->set_uniform("s_Depth", 2))
-            m_depth_rt->bind(2);
+        if (m_material_classify_program->set_uniform("s_Visibility", 0))
+            m_visibility_rt->bind(0);
 
-        // Bind uniform buffers.
-        m_global_ubo->bind_base(0);
+        if (m_material_classify_program->set_uniform("s_TriangleDraws", 1))
+        {
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_BUFFER, m_triangle_draw_texture);
+        }
 
-        // Render fullscreen triangle
+        begin_g_buffer_traffic(traffic, G_BUFFER_TRAFFIC_CLASSIFY, fragment_bytes({ m_material_depth_rt }));
         glDrawArrays(GL_TRIANGLES, 0, 3);
+        end_g_buffer_traffic(traffic);
+
+        m_frame_timer->end();
+
+        // One fullscreen triangle per draw at its classification depth. The early depth test leaves each one only its own pixels, so
+        // every pixel is resolved exactly once.
+        m_frame_timer->begin("Resolve");
+
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        m_global_ubo->bind_base(0);
+
+        begin_g_buffer_traffic(traffic, G_BUFFER_TRAFFIC_RESOLVE, fragment_bytes({ m_g_buffer_0_rt.get(), m_g_buffer_1_rt.get() }));
+
+        for (auto& mesh : m_scene_meshes)
+            resolve_mesh(mesh);
+
+        end_g_buffer_traffic(traffic);
+
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+
+        m_frame_timer->end();
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void create_cube()
+    void resolve_mesh(const SceneMesh& mesh)
     {
-        const glm::vec4 cube_vertices[] = {
-            glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f),  // Far-Bottom-Left
-            glm::vec4(-1.0f, 1.0f, 1.0f, 1.0f),   // Far-Top-Left
-            glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),    // Far-Top-Right
-            glm::vec4(1.0f, -1.0f, 1.0f, 1.0f),   // Far-Bottom-Right
-            glm::vec4(-1.0f, -1.0f, -1.0f, 1.0f), // Near-Bottom-Left
-            glm::vec4(-1.0f, 1.0f, -1.0f, 1.0f),  // Near-Top-Left
-            glm::vec4(1.0f, 1.0f, -1.0f, 1.0f),   // Near-Top-Right
-            glm::vec4(1.0f, -1.0f, -1.0f, 1.0f)   // Near-Bottom-Right
-        };
+        if (mesh.instances.empty())
+            return;
 
-        GLushort cube_elements[] = {
-            // front
-            0,
-            1,
-            2,
-            2,
-            3,
-            0,
-            // right
-            1,
-            5,
+        dw::SubMesh* submeshes = mesh.mesh->sub_meshes();
+
+        ShaderProgram* program     = nullptr;
+        uint32_t       permutation = UINT32_MAX;
+
+        for (auto i : mesh.submesh_draw_order)
+        {
+            dw::SubMesh& submesh = submeshes[i];
+
+            uint32_t key = m_visibility_resolve_programs->key(mesh.submesh_permutations[i] | global_permutation());
+
+            if (key != permutation)
+            {
+                permutation = key;
+                program     = m_visibility_resolve_programs->get(permutation);
+
+                if (!program)
+                    continue;
+
+                // Bind shader program.
+                program->use();
+
+                bind_visibility_geometry(program, 2);
+            }
+
+            // The variant failed to compile, its submeshes are skipped.
+            if (!program)
+                continue;
+
+            program->set_uniform("u_MaterialDepth", float(mesh.base_draw + i + 1) / float(VISIBILITY_MAX_DRAWS));
+
+            if (submesh.mat->texture(aiTextureType_DIFFUSE))
+            {
+                if (program->set_uniform("s_Albedo", 0))
+                    submesh.mat->texture(aiTextureType_DIFFUSE)->bind(0);
+            }
+
+            if (submesh.mat->texture(aiTextureType_HEIGHT))
+            {
+                if (program->set_uniform("s_Normal", 1))
+                    submesh.mat->texture(aiTextureType_HEIGHT)->bind(1);
+            }
+
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void bind_visibility_geometry(ShaderProgram* program, int first_unit)
+    {
+        if (program->set_uniform("s_Visibility", first_unit))
+            m_visibility_rt->bind(first_unit);
+
+        const char* names[]    = { "s_Vertices", "s_Indices", "s_InstanceTransforms" };
+        GLuint      textures[] = { m_visibility_vertex_texture, m_visibility_index_texture, m_instance_texture };
+
+        for (int i = 0; i < 3; i++)
+        {
+            int unit = first_unit + 1 + i;
+
+            if (program->set_uniform(names[i], unit))
+            {
+                glActiveTexture(GL_TEXTURE0 + unit);
+                glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+            }
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    uint32_t fragment_bytes(std::initializer_list<dw::Texture2D*> targets)
+    {
+        uint32_t bytes = 0;
+
+        for (auto target : targets)
+            bytes += texture_format_bytes(target->internal_format());
+
+        return bytes;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void begin_g_buffer_traffic(GBufferTrafficFrame* traffic, GBufferTrafficPass pass, uint32_t bytes)
+    {
+        if (!traffic)
+            return;
+
+        traffic->fragment_bytes[pass] = bytes;
+        glBeginQuery(GL_SAMPLES_PASSED, traffic->queries[pass]);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void end_g_buffer_traffic(GBufferTrafficFrame* traffic)
+    {
+        if (traffic)
+            glEndQuery(GL_SAMPLES_PASSED);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void poll_g_buffer_traffic()
+    {
+        for (auto& traffic : m_g_buffer_traffic)
+        {
+            if (!traffic.pending)
+                continue;
+
+            bool available = true;
+
+            for (int i = 0; i < G_BUFFER_TRAFFIC_PASS_COUNT; i++)
+            {
+                GLuint result = GL_TRUE;
+
+                if (traffic.fragment_bytes[i] > 0)
+                    glGetQueryObjectuiv(traffic.queries[i], GL_QUERY_RESULT_AVAILABLE, &result);
+
+                available &= result == GL_TRUE;
+            }
+
+            if (!available)
+                continue;
+
+            GBufferTraffic result;
+
+            for (int i = 0; i < G_BUFFER_TRAFFIC_PASS_COUNT; i++)
+            {
+                if (traffic.fragment_bytes[i] == 0)
+                    continue;
+
+                GLuint64 samples = 0;
+                glGetQueryObjectui64v(traffic.queries[i], GL_QUERY_RESULT, &samples);
+
+                result.bytes += samples * traffic.fragment_bytes[i];
+
+                if (i == G_BUFFER_TRAFFIC_RASTER)
+                    result.raster_fragments = samples;
+            }
+
+            m_g_buffer_traffic_results[traffic.visibility_buffer ? 1 : 0] = result;
+            traffic.pending                                                = false;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void build_hiz()
+    {
+        m_frame_timer->begin("Hi-Z");
+
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_BLEND);
+
+        m_hiz_downsample_program->use();
+
+        GLuint   hiz_texture = m_hiz_rt->id();
+        uint32_t width       = m_width;
+        uint32_t height      = m_height;
+
+        for (uint32_t i = 0; i < m_hiz_rt->mip_levels(); i++)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, m_hiz_fbos[i]);
+
+            m_hiz_downsample_program->set_uniform("u_SourceSize", glm::ivec2(width, height));
+            m_hiz_downsample_program->set_uniform("u_FromDepth", i == 0 ? 1 : 0);
+
+            if (m_hiz_downsample_program->set_uniform("s_Source", 0))
+            {
+                if (i == 0)
+                    m_depth_rt->bind(0);
+                else
+                {
+                    // Restrict sampling to the previous level so reading it while writing this one isn't a feedback loop.
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, hiz_texture);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, i - 1);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, i - 1);
+                }
+            }
+
+            width  = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+
+            glViewport(0, 0, width, height);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, hiz_texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_hiz_rt->mip_levels() - 1);
+
+        // Copy the low resolution level into the next free PBO. It is consumed a few frames later, so this never stalls.
+        GLuint pbo = 0;
+
+        if (m_hiz_readback->begin_write(pbo))
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+            glGetTexImage(GL_TEXTURE_2D, m_hiz_readback_level, GL_RG, GL_FLOAT, nullptr);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            HiZReadback readback;
+
+            readback.view_proj     = m_global_uniforms.view_proj;
+            readback.level         = m_hiz_readback_level;
+            readback.width         = m_hiz_readback_width;
+            readback.height        = m_hiz_readback_height;
+            readback.screen_width  = m_width;
+            readback.screen_height = m_height;
+            readback.scene_version = m_scene_version;
+
+            m_hiz_readback->end_write(readback);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        m_frame_timer->end();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void poll_hiz_readback()
+    {
+        m_hiz_readback->consume_latest([this](const void* data, const HiZReadback& readback) {
+            // A fresh pyramid per readback, so the one the simulation thread may still be culling against is never overwritten.
+            std::shared_ptr<OcclusionSnapshot> occlusion = std::make_shared<OcclusionSnapshot>();
+
+            occlusion->pyramid.build_from_level((const glm::vec2*)data, readback.width, readback.height, readback.level, readback.screen_width, readback.screen_height);
+            occlusion->view_proj = readback.view_proj;
+
+            m_occlusion               = occlusion;
+            m_occlusion_scene_version = readback.scene_version;
+
+            // The CPU light grid bins without depth while the camera moves. Once depth for the view it came to rest at arrives, bin
+            // again so the tiles stop holding lights hidden behind the geometry.
+            if (!gpu_light_culling() && !m_light_grid_depth_bounds && occlusion_matches_view(m_last_view_proj))
+                m_lights_dirty = true;
+        });
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // The Hi-Z readback lags a few frames behind, so its depth only describes frames with the same view, scene and window size.
+    bool occlusion_matches_view(const glm::mat4& view_proj) const
+    {
+        return m_occlusion && !m_occlusion->pyramid.empty() && m_occlusion->view_proj == view_proj && m_occlusion_scene_version == m_scene_version && m_occlusion->pyramid.screen_width() == uint32_t(m_width) && m_occlusion->pyramid.screen_height() == uint32_t(m_height);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void update_frame_stages()
+    {
+        const FrameSnapshot& snapshot = m_snapshot_buffer.read();
+
+        bool view_changed   = !m_incremental_rendering || !m_frame_valid || m_last_view_proj != snapshot.view_proj || m_instances_dirty;
+        bool decals_changed = snapshot.draw_order != m_last_decal_draw_order;
+
+        FrameStageStatus g_buffer = FRAME_STAGE_SKIPPED;
+
+        if (view_changed)
+            g_buffer = FRAME_STAGE_FULL;
+        else if (decals_changed)
+        {
+            // Newly placed decals only touch the pixels under their boxes, anything else has to clear the old decals too.
+            g_buffer = decal_draws_appended(m_last_decal_draw_order, snapshot.draw_order, m_last_decal_instance_count) ? FRAME_STAGE_PARTIAL : FRAME_STAGE_FULL;
+        }
+
+        // Depth only depends on the camera and scene, so decal changes never invalidate Hi-Z or the light grid.
+        m_stage_status[FRAME_STAGE_G_BUFFER]      = g_buffer;
+        m_stage_status[FRAME_STAGE_HIZ]           = view_changed ? FRAME_STAGE_FULL : FRAME_STAGE_SKIPPED;
+        m_stage_status[FRAME_STAGE_DECALS]        = g_buffer;
+        m_stage_status[FRAME_STAGE_LIGHT_CULLING] = (view_changed || m_lights_dirty) ? FRAME_STAGE_FULL : FRAME_STAGE_SKIPPED;
+        m_stage_status[FRAME_STAGE_SHADING]       = m_lights_dirty ? FRAME_STAGE_FULL : g_buffer;
+
+        if (g_buffer == FRAME_STAGE_PARTIAL)
+            m_scissor = appended_decals_scissor();
+
+        bool reused = true;
+
+        for (int i = 0; i < FRAME_STAGE_COUNT; i++)
+        {
+            if (m_stage_status[i] == FRAME_STAGE_SKIPPED)
+                m_stage_skip_counts[i]++;
+            else
+                reused = false;
+        }
+
+        if (reused)
+            m_reused_frames++;
+
+        if (m_instances_dirty)
+            m_scene_version++;
+
+        m_last_view_proj            = snapshot.view_proj;
+        m_last_decal_draw_order     = snapshot.draw_order;
+        m_last_decal_instance_count = int(snapshot.decal_count);
+        m_lights_dirty              = false;
+        m_instances_dirty           = false;
+        m_frame_valid               = true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    glm::ivec4 appended_decals_scissor()
+    {
+        const FrameSnapshot& snapshot = m_snapshot_buffer.read();
+
+        glm::vec4 bounds = glm::vec4(1.0f, 1.0f, -1.0f, -1.0f);
+
+        for (int i = 0; i < snapshot.draw_order.size(); i++)
+        {
+            if (snapshot.draw_order[i].second < m_last_decal_instance_count)
+                continue;
+
+            glm::vec3 corners[8];
+            decal_box_corners(snapshot.draws[i].view_proj, corners);
+
+            glm::vec4 rect;
+            decal_screen_rect(snapshot.view_proj, corners, rect);
+
+            bounds = glm::vec4(glm::min(glm::vec2(bounds), glm::vec2(rect)), glm::max(glm::vec2(bounds.z, bounds.w), glm::vec2(rect.z, rect.w)));
+        }
+
+        // Round outwards so partially covered pixels are redrawn too. Stored as x, y, width, height for glScissor().
+        int x0 = int(floorf((bounds.x * 0.5f + 0.5f) * m_width));
+        int y0 = int(floorf((bounds.y * 0.5f + 0.5f) * m_height));
+        int x1 = int(ceilf((bounds.z * 0.5f + 0.5f) * m_width));
+        int y1 = int(ceilf((bounds.w * 0.5f + 0.5f) * m_height));
+
+        return glm::ivec4(x0, y0, std::max(x1 - x0, 0), std::max(y1 - y0, 0));
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool begin_stage(FrameStage stage)
+    {
+        if (m_stage_status[stage] == FRAME_STAGE_PARTIAL)
+        {
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(m_scissor.x, m_scissor.y, m_scissor.z, m_scissor.w);
+        }
+        else
+            glDisable(GL_SCISSOR_TEST);
+
+        return m_stage_status[stage] != FRAME_STAGE_SKIPPED;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void present()
+    {
+        m_frame_timer->begin("Present");
+
+        // The shaded image outlives the frame, so skipped frames present it again as-is.
+        m_shaded_fbo->bind();
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        m_frame_timer->end();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Declares this frame's passes, skipping the stages update_frame_stages() left out, and backs the transients the compiled graph
+    // keeps. Albedo, normal, depth and the shaded image are imported, incremental frames rely on them outliving the frame.
+    bool build_render_graph()
+    {
+        m_render_graph.clear();
+
+        uint32_t albedo   = m_render_graph.import_texture("G-Buffer Albedo", texture_desc(m_g_buffer_0_rt.get()));
+        uint32_t normal   = m_render_graph.import_texture("G-Buffer Normal", texture_desc(m_g_buffer_1_rt.get()));
+        uint32_t depth    = m_render_graph.import_texture("Depth", texture_desc(m_depth_rt.get()));
+        uint32_t shaded   = m_render_graph.import_texture("Shaded", texture_desc(m_shaded_rt.get()));
+        uint32_t hiz      = m_render_graph.import_texture("Hi-Z", texture_desc(m_hiz_rt.get()));
+        uint32_t lights   = m_render_graph.import_buffer("Light Grid");
+        uint32_t geometry = m_visibility_buffer ? m_render_graph.import_texture("Visibility", texture_desc(m_visibility_rt.get())) : m_render_graph.import_texture("G-Buffer Source Normal", texture_desc(m_g_buffer_2_rt.get()));
+
+        uint32_t tangent        = RENDER_GRAPH_INVALID;
+        uint32_t bitangent      = RENDER_GRAPH_INVALID;
+        uint32_t material_depth = RENDER_GRAPH_INVALID;
+
+        if (m_stage_status[FRAME_STAGE_G_BUFFER] != FRAME_STAGE_SKIPPED)
+        {
+            uint32_t pass = m_render_graph.add_pass("G-Buffer", [this]() {
+                begin_stage(FRAME_STAGE_G_BUFFER);
+                render_g_buffer();
+            });
+
+            m_render_graph.write(pass, albedo);
+            m_render_graph.write(pass, normal);
+            m_render_graph.write(pass, depth);
+            m_render_graph.write(pass, geometry);
+
+            if (m_visibility_buffer)
+            {
+                material_depth = m_render_graph.create_texture("Material Depth", render_target_desc(GL_DEPTH_COMPONENT32F));
+                m_render_graph.write(pass, material_depth);
+            }
+            else
+            {
+                TextureDesc desc = render_target_desc(m_g_buffer_1_rt->internal_format());
+
+                tangent   = m_render_graph.create_texture("G-Buffer Tangent", desc);
+                bitangent = m_render_graph.create_texture("G-Buffer Bitangent", desc);
+
+                m_render_graph.write(pass, tangent);
+                m_render_graph.write(pass, bitangent);
+            }
+        }
+
+        // The readback is a side effect the graph can't see.
+        if (m_stage_status[FRAME_STAGE_HIZ] != FRAME_STAGE_SKIPPED)
+        {
+            uint32_t pass = m_render_graph.add_pass(
+                "Hi-Z", [this]() {
+                    begin_stage(FRAME_STAGE_HIZ);
+                    build_hiz();
+                },
+                true);
+
+            m_render_graph.read(pass, depth);
+            m_render_graph.write(pass, hiz);
+        }
+
+        if (m_stage_status[FRAME_STAGE_DECALS] != FRAME_STAGE_SKIPPED)
+        {
+            uint32_t pass = m_render_graph.add_pass("Decals", [this]() {
+                begin_stage(FRAME_STAGE_DECALS);
+                render_decals();
+            });
+
+            m_render_graph.read(pass, depth);
+            m_render_graph.read(pass, geometry);
+            m_render_graph.read(pass, albedo);
+            m_render_graph.read(pass, normal);
+            m_render_graph.write(pass, albedo);
+            m_render_graph.write(pass, normal);
+
+            if (tangent != RENDER_GRAPH_INVALID)
+            {
+                m_render_graph.read(pass, tangent);
+                m_render_graph.read(pass, bitangent);
+            }
+        }
+
+        if (m_stage_status[FRAME_STAGE_LIGHT_CULLING] != FRAME_STAGE_SKIPPED)
+        {
+            uint32_t pass = m_render_graph.add_pass("Light Culling", [this]() {
+                begin_stage(FRAME_STAGE_LIGHT_CULLING);
+                cull_lights();
+            });
+
+            m_render_graph.read(pass, depth);
+            m_render_graph.write(pass, lights);
+        }
+
+        if (m_stage_status[FRAME_STAGE_SHADING] != FRAME_STAGE_SKIPPED)
+        {
+            uint32_t pass = m_render_graph.add_pass("Shading", [this]() {
+                begin_stage(FRAME_STAGE_SHADING);
+                render_deferred_shading();
+            });
+
+            m_render_graph.read(pass, albedo);
+            m_render_graph.read(pass, normal);
+            m_render_graph.read(pass, depth);
+            m_render_graph.read(pass, lights);
+            m_render_graph.write(pass, shaded);
+        }
+
+        if (m_debug_gui && m_gpu_picking)
+        {
+            uint32_t pass = m_render_graph.add_pass(
+                "Picking", [this]() {
+                    glDisable(GL_SCISSOR_TEST);
+                    issue_gpu_pick();
+                },
+                true);
+
+            m_render_graph.read(pass, depth);
+            m_render_graph.read(pass, geometry);
+        }
+
+        uint32_t present_pass = m_render_graph.add_pass(
+            "Present", [this]() {
+                glDisable(GL_SCISSOR_TEST);
+                present();
+            },
+            true);
+
+        m_render_graph.read(present_pass, shaded);
+
+        if (!m_render_graph.compile())
+        {
+            DW_LOG_ERROR("Render graph: " + m_render_graph.error());
+            return false;
+        }
+
+        realize_transient_textures();
+
+        // Resources of skipped stages aren't declared, their targets stay as they are for the next frame that needs them.
+        if (material_depth != RENDER_GRAPH_INVALID)
+            bind_transient(m_material_depth_rt, material_depth);
+
+        if (tangent != RENDER_GRAPH_INVALID)
+        {
+            bind_transient(m_g_buffer_3_rt, tangent);
+            bind_transient(m_g_buffer_4_rt, bitangent);
+        }
+
+        if (m_transient_framebuffers_dirty && m_stage_status[FRAME_STAGE_G_BUFFER] != FRAME_STAGE_SKIPPED)
+            create_transient_framebuffers();
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Backs every physical slot of the compiled graph with a texture of its description. Slots keep their texture across frames and
+    // are only recreated when their description changes.
+    void realize_transient_textures()
+    {
+        if (m_transient_textures.size() < m_render_graph.slot_count())
+            m_transient_textures.resize(m_render_graph.slot_count());
+
+        for (uint32_t i = 0; i < m_render_graph.slot_count(); i++)
+        {
+            const TextureDesc& desc = m_render_graph.slot_desc(i);
+
+            if (m_transient_textures[i] && same_texture_desc(texture_desc(m_transient_textures[i].get()), desc))
+                continue;
+
+            GLenum format = GL_RGBA;
+            GLenum type   = GL_UNSIGNED_BYTE;
+
+            transfer_format(desc.internal_format, format, type);
+
+            m_transient_textures[i] = std::make_unique<dw::Texture2D>(desc.width, desc.height, desc.array_size, desc.mip_levels, 1, desc.internal_format, format, type);
+            m_transient_textures[i]->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+            track_texture("Render Graph Slot " + std::to_string(i), GPU_MEMORY_RENDER_TARGETS, m_transient_textures[i].get());
+
+            m_transient_framebuffers_dirty = true;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void bind_transient(dw::Texture2D*& target, uint32_t resource)
+    {
+        dw::Texture2D* texture = m_transient_textures[m_render_graph.physical_slot(resource)].get();
+
+        if (target != texture)
+        {
+            target                         = texture;
+            m_transient_framebuffers_dirty = true;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    TextureDesc render_target_desc(GLenum internal_format)
+    {
+        TextureDesc desc;
+
+        desc.internal_format = internal_format;
+        desc.width           = m_width;
+        desc.height          = m_height;
+
+        return desc;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Upload format and type dw::Texture2D takes alongside the internal format, for the formats transients are created with.
+    void transfer_format(GLenum internal_format, GLenum& format, GLenum& type)
+    {
+        switch (internal_format)
+        {
+            case GL_RG16F:
+                format = GL_RG;
+                type   = GL_HALF_FLOAT;
+                break;
+            case GL_RGB32F:
+                format = GL_RGB;
+                type   = GL_FLOAT;
+                break;
+            case GL_DEPTH_COMPONENT32F:
+                format = GL_DEPTH_COMPONENT;
+                type   = GL_FLOAT;
+                break;
+            default:
+                format = GL_RGBA;
+                type   = GL_UNSIGNED_BYTE;
+                break;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void render_decals()
+    {
+        m_frame_timer->begin("Decals");
+
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glDepthMask(GL_FALSE);
+        glDisable(GL_CULL_FACE);
+
+        m_decal_fbo->bind();
+
+        glViewport(0, 0, m_width, m_height);
+
+        m_cube_vao->bind();
+
+        // Bind uniform buffers.
+        m_global_ubo->bind_base(0);
+
+        const FrameSnapshot& snapshot = m_snapshot_buffer.read();
+
+        ShaderProgram* program     = nullptr;
+        uint32_t       permutation = UINT32_MAX;
+
+        for (int i = 0; i < snapshot.draws.size(); i++)
+        {
+            const DecalDraw& draw = snapshot.draws[i];
+
+            // Global flags follow the current targets. A snapshot taken before they were switched still carries the old ones.
+            uint32_t key = (snapshot.draw_order[i].first & ~PERMUTATION_GLOBAL_FLAGS) | global_permutation();
+
+            if (key != permutation)
+            {
+                if (program)
+                    m_frame_timer->end();
+
+                permutation = key;
+                program     = m_decals_programs->get(permutation);
+
+                if (!program)
+                    continue;
+
+                m_frame_timer->begin("Decals [" + permutation_name(permutation) + "]");
+
+                // Albedo-only variants don't write a normal, so keep the G-buffer normal intact.
+                GLboolean write_normal = (permutation & PERMUTATION_NORMAL_MAP) ? GL_TRUE : GL_FALSE;
+                glColorMaski(1, write_normal, write_normal, write_normal, write_normal);
+
+                // Bind shader program.
+                program->use();
+
+                if (program->set_uniform("s_Depth", 2))
+                    m_depth_rt->bind(2);
+
+                if (program->set_uniform("s_SourceNormal", 3))
+                    m_g_buffer_2_rt->bind(3);
+
+                if (program->set_uniform("s_Tangent", 4))
+                    m_g_buffer_3_rt->bind(4);
+
+                if (program->set_uniform("s_Bitangent", 5))
+                    m_g_buffer_4_rt->bind(5);
+
+                bind_visibility_geometry(program, 3);
+            }
+
+            // The variant failed to compile, its decals are skipped.
+            if (!program)
+                continue;
+
+            program->set_uniform("u_InvDecalVP", draw.inv_view_proj);
+            program->set_uniform("u_DecalVP", draw.view_proj);
+            program->set_uniform("u_DecalModel", draw.model);
+            program->set_uniform("u_DecalOverlayColor", draw.overlay_color);
+            program->set_uniform("u_AspectRatio", draw.aspect_ratio);
+
+            if (program->set_uniform("s_Decal", 0))
+                m_decal_textures[draw.type]->bind(0);
+
+            if (program->set_uniform("s_DecalNormal", 1))
+                m_decal_normal_textures[draw.type]->bind(1);
+
+            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0);
+        }
+
+        if (program)
+            m_frame_timer->end();
+
+        glColorMaski(1, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_TRUE);
+
+        m_frame_timer->end();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool gpu_light_culling() const
+    {
+        return m_gpu_light_culling && m_light_culling_program;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void cull_lights()
+    {
+        const FrameSnapshot& snapshot = m_snapshot_buffer.read();
+
+        uint32_t tiles_x = light_tile_count(m_width);
+        uint32_t tiles_y = light_tile_count(m_height);
+
+        if (gpu_light_culling())
+        {
+            m_frame_timer->begin("Light Culling (GPU)");
+
+            m_light_culling_program->use();
+
+            m_light_culling_program->set_uniform("u_View", snapshot.view);
+            m_light_culling_program->set_uniform("u_Proj", snapshot.projection);
+            m_light_culling_program->set_uniform("u_InvProj", glm::inverse(snapshot.projection));
+            m_light_culling_program->set_uniform("u_LightCount", int(m_lights.size()));
+            m_light_culling_program->set_uniform("u_ScreenSize", glm::ivec2(m_width, m_height));
+
+            if (m_light_culling_program->set_uniform("s_Depth", 0))
+                m_depth_rt->bind(0);
+
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_light_buffer);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_TILE_BUFFER_BINDING, m_light_tile_buffer);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_INDEX_BUFFER_BINDING, m_light_index_buffer);
+
+            glDispatchCompute(tiles_x, tiles_y, 1);
+
+            // The shading pass reads the results through buffer textures.
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+            m_frame_timer->end();
+        }
+        else
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+
+            // There is no depth buffer readback on this path, the tiles take their depth range from the last Hi-Z readback when it
+            // still matches the frame. Otherwise they bin against the full depth range until it does.
+            m_light_grid_depth_bounds = occlusion_matches_view(snapshot.view_proj);
+
+            if (m_light_grid_depth_bounds)
+                m_occlusion->pyramid.tile_depth_bounds(LIGHT_TILE_SIZE, m_light_tile_depth_bounds);
+
+            build_light_grid(m_lights.data(), uint32_t(m_lights.size()), snapshot.view, snapshot.projection, m_width, m_height, m_light_grid_depth_bounds ? m_light_tile_depth_bounds.data() : nullptr, m_light_grid);
+
+            m_light_culling_cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            glBindBuffer(GL_TEXTURE_BUFFER, m_light_tile_buffer);
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, m_light_grid.tiles.size() * sizeof(glm::uvec2), m_light_grid.tiles.data());
+
+            // The index list grows with the number of visible lights, so reallocate it when it no longer fits.
+            size_t index_size = std::max(m_light_grid.indices.size(), size_t(1)) * sizeof(uint32_t);
+
+            glBindBuffer(GL_TEXTURE_BUFFER, m_light_index_buffer);
+
+            if (index_size > m_light_index_buffer_size)
+            {
+                m_light_index_buffer_size = index_size;
+                glBufferData(GL_TEXTURE_BUFFER, index_size, nullptr, GL_DYNAMIC_DRAW);
+
+                m_gpu_memory.track("Light Indices", GPU_MEMORY_BUFFERS, m_light_index_buffer_size);
+            }
+
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, m_light_grid.indices.size() * sizeof(uint32_t), m_light_grid.indices.data());
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void render_deferred_shading()
+    {
+        m_frame_timer->begin("Deferred Shading");
+
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_BLEND);
+
+        m_shaded_fbo->bind();
+
+        glViewport(0, 0, m_width, m_height);
+
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        ShaderProgram* program = m_deferred_shading_programs->get(global_permutation());
+
+        if (!program)
+        {
+            m_frame_timer->end();
+            return;
+        }
+
+        // Bind shader program.
+        program->use();
+
+        if (program->set_uniform("s_Albedo", 0))
+            m_g_buffer_0_rt->bind(0);
+
+        if (program->set_uniform("s_Normals", 1))
+            m_g_buffer_1_rt->bind(1);
+
+        if (program->set_uniform("s_Depth", 2))
+            m_depth_rt->bind(2);
+
+        if (program->set_uniform("s_Lights", 3))
+        {
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_BUFFER, m_light_texture);
+        }
+
+        if (program->set_uniform("s_LightTiles", 4))
+        {
+            glActiveTexture(GL_TEXTURE4);
+            glBindTexture(GL_TEXTURE_BUFFER, m_light_tile_texture);
+        }
+
+        if (program->set_uniform("s_LightIndices", 5))
+        {
+            glActiveTexture(GL_TEXTURE5);
+            glBindTexture(GL_TEXTURE_BUFFER, m_light_index_texture);
+        }
+
+        program->set_uniform("u_TilesX", int(light_tile_count(m_width)));
+
+        // Bind uniform buffers.
+        m_global_ubo->bind_base(0);
+
+        // Render fullscreen triangle
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        m_frame_timer->end();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void create_cube()
+    {
+        const glm::vec4 cube_vertices[] = {
+            glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f),  // Far-Bottom-Left
+            glm::vec4(-1.0f, 1.0f, 1.0f, 1.0f),   // Far-Top-Left
+            glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),    // Far-Top-Right
+            glm::vec4(1.0f, -1.0f, 1.0f, 1.0f),   // Far-Bottom-Right
+            glm::vec4(-1.0f, -1.0f, -1.0f, 1.0f), // Near-Bottom-Left
+            glm::vec4(-1.0f, 1.0f, -1.0f, 1.0f),  // Near-Top-Left
+            glm::vec4(1.0f, 1.0f, -1.0f, 1.0f),   // Near-Top-Right
+            glm::vec4(1.0f, -1.0f, -1.0f, 1.0f)   // Near-Bottom-Right
+        };
+
+        GLushort cube_elements[] = {
+            // front
+            0,
+            1,
+            2,
+            2,
+            3,
+            0,
+            // right
+            1,
+            5,
             6,
             6,
             2,
@@ -472,312 +1711,1502 @@ private:
             3
         };
 
-        // Create vertex buffer.
-        m_cube_vbo = std::make_unique<dw::VertexBuffer>(GL_STATIC_DRAW, sizeof(cube_vertices), (void*)&cube_vertices[0][0]);
+        // Create vertex buffer.
+        m_cube_vbo = std::make_unique<dw::VertexBuffer>(GL_STATIC_DRAW, sizeof(cube_vertices), (void*)&cube_vertices[0][0]);
+
+        if (!m_cube_vbo)
+            DW_LOG_ERROR("Failed to create Vertex Buffer");
+
+        // Create index buffer.
+        m_cube_ibo = std::make_unique<dw::IndexBuffer>(GL_STATIC_DRAW, sizeof(cube_elements), cube_elements);
+
+        if (!m_cube_ibo)
+            DW_LOG_ERROR("Failed to create Index Buffer");
+
+        // Declare vertex attributes.
+        dw::VertexAttrib attribs[] = { { 4, GL_FLOAT, false, 0 } };
+
+        // Create vertex array.
+        m_cube_vao = std::make_unique<dw::VertexArray>(m_cube_vbo.get(), m_cube_ibo.get(), sizeof(float) * 4, 1, attribs);
+
+        if (!m_cube_vao)
+            DW_LOG_ERROR("Failed to create Vertex Array");
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Startup as a graph of tasks. GL work stays on this thread, in the order it is added here, while CPU only work runs on workers as
+    // soon as what it reads is loaded. dw::Mesh::load() and dw::Texture2D::create_from_files() upload as they parse, so Assimp import
+    // and image decoding stay on this thread, overlapped by the Embree build and visibility geometry flattening.
+    bool run_startup_tasks()
+    {
+        TaskGraph tasks;
+
+        // Added first so the workers waiting on the meshes start as early as possible.
+        uint32_t scene  = tasks.add_task("Scene Meshes", TASK_AFFINITY_MAIN_THREAD, [this]() { return load_scene(); });
+        uint32_t embree = tasks.add_task("Embree", TASK_AFFINITY_WORKER, [this]() { return initialize_embree(); }, { scene });
+
+        uint32_t visibility_geometry = UINT32_MAX;
+
+        if (m_visibility_buffer)
+        {
+            uint32_t flatten = tasks.add_task("Visibility Geometry Flatten", TASK_AFFINITY_WORKER, [this]() {
+                build_visibility_geometry();
+                return true;
+            }, { scene });
+
+            visibility_geometry = tasks.add_task("Visibility Geometry Upload", TASK_AFFINITY_MAIN_THREAD, [this]() {
+                upload_visibility_geometry();
+                return true;
+            }, { flatten });
+        }
+
+        uint32_t shaders  = tasks.add_task("Shaders", TASK_AFFINITY_MAIN_THREAD, [this]() { return create_shaders(); });
+        uint32_t uniforms = tasks.add_task("Uniform Buffer", TASK_AFFINITY_MAIN_THREAD, [this]() { return create_uniform_buffer(); });
+        uint32_t decals   = tasks.add_task("Decal Textures", TASK_AFFINITY_MAIN_THREAD, [this]() { return load_decals(); });
+
+        uint32_t permutations = tasks.add_task("Shader Permutations", TASK_AFFINITY_MAIN_THREAD, [this]() { return prepare_permutations(); }, { shaders, scene, decals });
+
+        uint32_t cube = tasks.add_task("Cube", TASK_AFFINITY_MAIN_THREAD, [this]() {
+            create_cube();
+            return true;
+        });
+
+        uint32_t targets = tasks.add_task("Render Targets", TASK_AFFINITY_MAIN_THREAD, [this]() {
+            create_textures();
+            create_framebuffers();
+            create_g_buffer_traffic_queries();
+            create_hiz_resources();
+            return true;
+        });
+
+        uint32_t lights = tasks.add_task("Light Buffers", TASK_AFFINITY_MAIN_THREAD, [this]() {
+            create_light_buffers();
+            return true;
+        }, { scene });
+
+        // Uploading the transforms also moves the ray scene instances, so it waits for the BVH.
+        uint32_t instances = tasks.add_task("Instance Buffer", TASK_AFFINITY_MAIN_THREAD, [this]() {
+            create_instance_buffer();
+            return true;
+        }, { scene, embree });
+
+        uint32_t readback = tasks.add_task("Pick Readback", TASK_AFFINITY_MAIN_THREAD, [this]() {
+            m_pick_readback = std::make_unique<ReadbackRing<GLReadbackBackend, PickRequest>>(GLReadbackBackend(), PICK_READBACK_FRAMES, sizeof(PickTexel));
+            m_gpu_memory.track("Pick Readback", GPU_MEMORY_BUFFERS, PICK_READBACK_FRAMES * sizeof(PickTexel));
+            return true;
+        });
+
+        // Needs every allocation tracked before it can tell what the decals may use.
+        std::vector<uint32_t> allocations = { scene, decals, targets, lights, instances, readback, uniforms, cube, permutations };
+
+        if (visibility_geometry != UINT32_MAX)
+            allocations.push_back(visibility_geometry);
+
+        tasks.add_task("Memory Budget", TASK_AFFINITY_MAIN_THREAD, [this]() {
+            enforce_memory_budget();
+            return true;
+        }, allocations);
+
+        tasks.add_task("Camera", TASK_AFFINITY_MAIN_THREAD, [this]() {
+            create_camera();
+            return true;
+        });
+
+        bool success = tasks.run();
+
+        DW_LOG_INFO("Startup: " + tasks.report());
+
+        return success;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool create_shaders()
+    {
+        m_shader_cache = std::make_unique<ShaderCache>("shader_cache");
+        m_frame_timer  = std::make_unique<FrameTimer>();
+
+        // Variants are compiled on first use, prepare_permutations() builds the ones the loaded scene and decals need up front.
+        m_g_buffer_programs         = std::make_unique<ShaderPermutations>(m_shader_cache.get(), "g_buffer", std::vector<ShaderStage>{ { GL_VERTEX_SHADER, "shader/g_buffer_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/g_buffer_fs.glsl" } }, PERMUTATION_NORMAL_MAP | PERMUTATION_PACKED_G_BUFFER);
+        m_deferred_shading_programs = std::make_unique<ShaderPermutations>(m_shader_cache.get(), "deferred_shading", std::vector<ShaderStage>{ { GL_VERTEX_SHADER, "shader/fullscreen_triangle_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/deferred_shading_fs.glsl" } }, PERMUTATION_PACKED_G_BUFFER);
+
+        // Decals are not required to present a frame, so let the driver link them in the background.
+        m_decals_programs = std::make_unique<ShaderPermutations>(m_shader_cache.get(), "decals", std::vector<ShaderStage>{ { GL_VERTEX_SHADER, "shader/decals_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/decals_fs.glsl" } }, PERMUTATION_NORMAL_MAP | PERMUTATION_ALPHA_TEST | PERMUTATION_PACKED_G_BUFFER | PERMUTATION_VISIBILITY_BUFFER, true);
+
+        m_visibility_programs         = std::make_unique<ShaderPermutations>(m_shader_cache.get(), "visibility", std::vector<ShaderStage>{ { GL_VERTEX_SHADER, "shader/visibility_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/visibility_fs.glsl" } }, 0);
+        m_visibility_resolve_programs = std::make_unique<ShaderPermutations>(m_shader_cache.get(), "visibility_resolve", std::vector<ShaderStage>{ { GL_VERTEX_SHADER, "shader/visibility_resolve_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/visibility_resolve_fs.glsl" } }, PERMUTATION_NORMAL_MAP | PERMUTATION_PACKED_G_BUFFER);
+
+        // Compute shaders need GL 4.3, otherwise lights are always binned on the CPU.
+        if (gl_version_at_least(4, 3))
+        {
+            m_light_culling_program = m_shader_cache->create("light_culling", { { GL_COMPUTE_SHADER, "shader/light_culling_cs.glsl" } });
+
+            if (!m_light_culling_program)
+                DW_LOG_WARNING("Failed to create light culling program, falling back to CPU light binning");
+        }
+
+        m_hiz_downsample_program = m_shader_cache->create("hiz_downsample", { { GL_VERTEX_SHADER, "shader/fullscreen_triangle_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/hiz_downsample_fs.glsl" } });
+
+        if (!m_hiz_downsample_program)
+        {
+            DW_LOG_FATAL("Failed to create Shader Program");
+            return false;
+        }
+
+        m_material_classify_program = m_shader_cache->create("material_classify", { { GL_VERTEX_SHADER, "shader/fullscreen_triangle_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/material_classify_fs.glsl" } });
+
+        if (!m_material_classify_program)
+        {
+            DW_LOG_FATAL("Failed to create Shader Program");
+            return false;
+        }
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool prepare_permutations()
+    {
+        uint32_t global = global_permutation();
+
+        if (!m_deferred_shading_programs->prepare(global))
+            return false;
+
+        // The visibility pass has a single variant, the materials are applied by the resolve.
+        if (m_visibility_buffer && !m_visibility_programs->prepare(global))
+            return false;
+
+        ShaderPermutations* surface_programs = m_visibility_buffer ? m_visibility_resolve_programs.get() : m_g_buffer_programs.get();
+
+        for (auto& mesh : m_scene_meshes)
+        {
+            for (auto flags : mesh.submesh_permutations)
+            {
+                if (!surface_programs->prepare(flags | global))
+                    return false;
+            }
+        }
+
+        // Decals below the LOD threshold use the albedo-only variant of their type.
+        for (auto flags : m_decal_permutations)
+        {
+            if (!m_decals_programs->prepare(flags | global) || !m_decals_programs->prepare((flags & ~PERMUTATION_NORMAL_MAP) | global))
+                return false;
+        }
+
+        const ShaderCacheStats& stats = m_shader_cache->stats();
+
+        DW_LOG_INFO("Shader startup took " + std::to_string(stats.total_time_ms) + " ms with a " + (stats.cache_misses == 0 ? "warm" : "cold") + " cache (" + std::to_string(stats.cache_hits) + " cached, " + std::to_string(stats.cache_misses) + " compiled, " + std::to_string(stats.background) + " in background)");
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool gl_version_at_least(GLint required_major, GLint required_minor)
+    {
+        GLint major = 0;
+        GLint minor = 0;
+
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+        return major > required_major || (major == required_major && minor >= required_minor);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    uint32_t global_permutation()
+    {
+        return (m_packed_g_buffer ? PERMUTATION_PACKED_G_BUFFER : 0) | (m_visibility_buffer ? PERMUTATION_VISIBILITY_BUFFER : 0);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void create_textures()
+    {
+        m_g_buffer_0_rt = std::make_unique<dw::Texture2D>(m_width, m_height, 1, 1, 1, GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE);
+
+        // The packed layout stores octahedral encoded vectors, the raw layout stores them as-is.
+        GLenum normal_internal_format = m_packed_g_buffer ? GL_RG16F : GL_RGB32F;
+        GLenum normal_format          = m_packed_g_buffer ? GL_RG : GL_RGB;
+        GLenum normal_type            = m_packed_g_buffer ? GL_HALF_FLOAT : GL_FLOAT;
+
+        m_g_buffer_1_rt = std::make_unique<dw::Texture2D>(m_width, m_height, 1, 1, 1, normal_internal_format, normal_format, normal_type);
+        m_depth_rt      = std::make_unique<dw::Texture2D>(m_width, m_height, 1, 1, 1, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT);
+        m_shaded_rt     = std::make_unique<dw::Texture2D>(m_width, m_height, 1, 1, 1, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+
+        m_g_buffer_0_rt->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+        m_g_buffer_1_rt->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+        m_depth_rt->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+        m_shaded_rt->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+        track_texture("G-Buffer Albedo", GPU_MEMORY_RENDER_TARGETS, m_g_buffer_0_rt.get());
+        track_texture("G-Buffer Normal", GPU_MEMORY_RENDER_TARGETS, m_g_buffer_1_rt.get());
+        track_texture("Depth", GPU_MEMORY_RENDER_TARGETS, m_depth_rt.get());
+        track_texture("Shaded", GPU_MEMORY_RENDER_TARGETS, m_shaded_rt.get());
+
+        // The visibility buffer keeps ids instead of the source frame, decals rebuild it from the triangle under each pixel. Picking
+        // reads the source normal or the ids on frames that skip the G-buffer, so both outlive the frame. Tangents, bitangents and the
+        // material depth are render graph transients.
+        if (m_visibility_buffer)
+        {
+            m_g_buffer_2_rt.reset();
+            m_gpu_memory.untrack("G-Buffer Source Normal");
+
+            m_visibility_rt = std::make_unique<dw::Texture2D>(m_width, m_height, 1, 1, 1, GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT);
+
+            // Integer textures are incomplete with linear filtering, even when only read through texelFetch().
+            m_visibility_rt->set_min_filter(GL_NEAREST);
+            m_visibility_rt->set_mag_filter(GL_NEAREST);
+            m_visibility_rt->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+            track_texture("Visibility", GPU_MEMORY_RENDER_TARGETS, m_visibility_rt.get());
+        }
+        else
+        {
+            m_g_buffer_2_rt = std::make_unique<dw::Texture2D>(m_width, m_height, 1, 1, 1, normal_internal_format, normal_format, normal_type);
+            m_g_buffer_2_rt->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+            track_texture("G-Buffer Source Normal", GPU_MEMORY_RENDER_TARGETS, m_g_buffer_2_rt.get());
+
+            m_visibility_rt.reset();
+            m_gpu_memory.untrack("Visibility");
+        }
+
+        release_transient_textures();
+
+        // Every target was replaced, so nothing from the last frame can be reused.
+        m_frame_valid = false;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void release_transient_textures()
+    {
+        for (uint32_t i = 0; i < m_transient_textures.size(); i++)
+            m_gpu_memory.untrack("Render Graph Slot " + std::to_string(i));
+
+        m_transient_textures.clear();
+
+        m_g_buffer_3_rt     = nullptr;
+        m_g_buffer_4_rt     = nullptr;
+        m_material_depth_rt = nullptr;
+
+        m_transient_framebuffers_dirty = true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void create_framebuffers()
+    {
+        m_decal_fbo = std::make_unique<dw::Framebuffer>();
+
+        dw::Texture* decal_rts[] = { m_g_buffer_0_rt.get(), m_g_buffer_1_rt.get() };
+        m_decal_fbo->attach_multiple_render_targets(2, decal_rts);
+        m_decal_fbo->attach_depth_stencil_target(m_depth_rt.get(), 0, 0);
+
+        m_shaded_fbo = std::make_unique<dw::Framebuffer>();
+        m_shaded_fbo->attach_render_target(0, m_shaded_rt.get(), 0, 0);
+
+        // The G-buffer ones attach transients, so they wait until the render graph has backed them.
+        m_transient_framebuffers_dirty = true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void create_transient_framebuffers()
+    {
+        // The scene is always rasterized into m_g_buffer_fbo, with the visibility buffer it only holds ids.
+        m_g_buffer_fbo = std::make_unique<dw::Framebuffer>();
+
+        if (m_visibility_buffer)
+        {
+            m_g_buffer_fbo->attach_render_target(0, m_visibility_rt.get(), 0, 0);
+
+            m_visibility_resolve_fbo = std::make_unique<dw::Framebuffer>();
+
+            dw::Texture* resolve_rts[] = { m_g_buffer_0_rt.get(), m_g_buffer_1_rt.get() };
+            m_visibility_resolve_fbo->attach_multiple_render_targets(2, resolve_rts);
+            m_visibility_resolve_fbo->attach_depth_stencil_target(m_material_depth_rt, 0, 0);
+        }
+        else
+        {
+            dw::Texture* gbuffer_rts[] = { m_g_buffer_0_rt.get(), m_g_buffer_1_rt.get(), m_g_buffer_2_rt.get(), m_g_buffer_3_rt, m_g_buffer_4_rt };
+            m_g_buffer_fbo->attach_multiple_render_targets(5, gbuffer_rts);
+
+            m_visibility_resolve_fbo.reset();
+        }
+
+        m_g_buffer_fbo->attach_depth_stencil_target(m_depth_rt.get(), 0, 0);
+
+        m_transient_framebuffers_dirty = false;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool create_uniform_buffer()
+    {
+        // Create uniform buffer for global data
+        m_global_ubo = std::make_unique<dw::UniformBuffer>(GL_DYNAMIC_DRAW, sizeof(GlobalUniforms));
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void create_light_buffers()
+    {
+        // The compute path writes these as SSBOs, the shading pass always reads them as buffer textures.
+        glGenBuffers(1, &m_light_buffer);
+        glGenBuffers(1, &m_light_tile_buffer);
+        glGenBuffers(1, &m_light_index_buffer);
+
+        allocate_light_tile_buffers();
+
+        glGenTextures(1, &m_light_texture);
+        glGenTextures(1, &m_light_tile_texture);
+        glGenTextures(1, &m_light_index_texture);
+
+        glBindTexture(GL_TEXTURE_BUFFER, m_light_tile_texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, m_light_tile_buffer);
+
+        glBindTexture(GL_TEXTURE_BUFFER, m_light_index_texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, m_light_index_buffer);
+
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+        generate_lights(0);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void allocate_light_tile_buffers()
+    {
+        uint32_t tile_count = light_tile_count(m_width) * light_tile_count(m_height);
+
+        // Sized for the compute path, which gives every tile a fixed MAX_LIGHTS_PER_TILE slice of the index list.
+        m_light_index_buffer_size = tile_count * MAX_LIGHTS_PER_TILE * sizeof(uint32_t);
+
+        // The buffer textures reference the buffer objects, so they see the new storage without being attached again.
+        glBindBuffer(GL_TEXTURE_BUFFER, m_light_tile_buffer);
+        glBufferData(GL_TEXTURE_BUFFER, tile_count * sizeof(glm::uvec2), nullptr, GL_DYNAMIC_DRAW);
+
+        glBindBuffer(GL_TEXTURE_BUFFER, m_light_index_buffer);
+        glBufferData(GL_TEXTURE_BUFFER, m_light_index_buffer_size, nullptr, GL_DYNAMIC_DRAW);
+
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        m_gpu_memory.track("Light Tiles", GPU_MEMORY_BUFFERS, tile_count * sizeof(glm::uvec2));
+        m_gpu_memory.track("Light Indices", GPU_MEMORY_BUFFERS, m_light_index_buffer_size);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void create_hiz_resources()
+    {
+        // Level 0 is half resolution, each level stores the (min, max) depth of the 2x2 texels below it.
+        uint32_t width      = std::max(uint32_t(m_width) / 2, 1u);
+        uint32_t height     = std::max(uint32_t(m_height) / 2, 1u);
+        uint32_t mip_levels = 1;
+
+        while ((width >> mip_levels) > 0 || (height >> mip_levels) > 0)
+            mip_levels++;
+
+        // Called again on resize, which also drops the copies still in flight since they hold the old size.
+        m_hiz_readback.reset();
+        glDeleteFramebuffers(GLsizei(m_hiz_fbos.size()), m_hiz_fbos.data());
+
+        m_hiz_rt = std::make_unique<dw::Texture2D>(width, height, 1, mip_levels, 1, GL_RG32F, GL_RG, GL_FLOAT);
+        m_hiz_rt->set_min_filter(GL_NEAREST_MIPMAP_NEAREST);
+        m_hiz_rt->set_mag_filter(GL_NEAREST);
+        m_hiz_rt->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+        m_hiz_fbos.resize(mip_levels);
+        glGenFramebuffers(mip_levels, m_hiz_fbos.data());
+
+        m_hiz_readback_level = mip_levels - 1;
+
+        for (uint32_t i = 0; i < mip_levels; i++)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, m_hiz_fbos[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_hiz_rt->id(), i);
+
+            uint32_t level_width  = std::max(width >> i, 1u);
+            uint32_t level_height = std::max(height >> i, 1u);
+
+            // Read back the largest level that fits within HIZ_READBACK_WIDTH.
+            if (level_width <= HIZ_READBACK_WIDTH && i < m_hiz_readback_level)
+            {
+                m_hiz_readback_level  = i;
+                m_hiz_readback_width  = level_width;
+                m_hiz_readback_height = level_height;
+            }
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if (m_hiz_readback_level == mip_levels - 1)
+        {
+            m_hiz_readback_width  = std::max(width >> m_hiz_readback_level, 1u);
+            m_hiz_readback_height = std::max(height >> m_hiz_readback_level, 1u);
+        }
+
+        m_hiz_readback = std::make_unique<ReadbackRing<GLReadbackBackend, HiZReadback>>(GLReadbackBackend(), HIZ_READBACK_FRAMES, m_hiz_readback_width * m_hiz_readback_height * sizeof(glm::vec2));
+
+        track_texture("Hi-Z", GPU_MEMORY_RENDER_TARGETS, m_hiz_rt.get());
+        m_gpu_memory.track("Hi-Z Readback", GPU_MEMORY_BUFFERS, HIZ_READBACK_FRAMES * m_hiz_readback_width * m_hiz_readback_height * sizeof(glm::vec2));
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void generate_lights(uint32_t count)
+    {
+        std::mt19937                          generator(1337);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        m_lights.resize(count);
+
+        for (auto& light : m_lights)
+        {
+            glm::vec3 position = m_scene_min + (m_scene_max - m_scene_min) * glm::vec3(unit(generator), unit(generator), unit(generator));
+            glm::vec3 color    = glm::vec3(unit(generator), unit(generator), unit(generator));
+            bool      spot     = unit(generator) < 0.25f;
+
+            light.position_range  = glm::vec4(position, 50.0f + 150.0f * unit(generator));
+            light.color_intensity = glm::vec4(color, 1.0f + 4.0f * unit(generator));
+            light.direction_type  = glm::vec4(glm::vec3(0.0f, -1.0f, 0.0f), spot ? LIGHT_TYPE_SPOT : LIGHT_TYPE_POINT);
+            light.spot_angles     = glm::vec4(cosf(glm::radians(20.0f)), cosf(glm::radians(35.0f)), 0.0f, 0.0f);
+        }
+
+        // Keep at least one element so the buffer texture is never empty.
+        glBindBuffer(GL_TEXTURE_BUFFER, m_light_buffer);
+        glBufferData(GL_TEXTURE_BUFFER, std::max(m_lights.size(), size_t(1)) * sizeof(Light), m_lights.size() > 0 ? m_lights.data() : nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        m_gpu_memory.track("Lights", GPU_MEMORY_BUFFERS, std::max(m_lights.size(), size_t(1)) * sizeof(Light));
+
+        glBindTexture(GL_TEXTURE_BUFFER, m_light_texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_light_buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+        m_lights_dirty = true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void ui()
+    {
+        ImGui::DragFloat("Decal Rotation", &m_projector_rotation, 1.0f, -180.0f, 180.0f);
+        ImGui::DragFloat("Decal Size", &m_projector_size, 5.0f, 10.0f, 200.0f);
+        ImGui::DragFloat("Decal Extents Outer", &m_projector_outer_depth, 1.0f, 2.0f, 50.0f);
+        ImGui::DragFloat("Decal Extents Inner", &m_projector_inner_depth, 1.0f, 2.0f, 50.0f);
+        ImGui::Checkbox("Visualize Projectors", &m_visualize_projectors);
+        ImGui::ColorEdit4("Decal Overlay Color", &m_decal_overlay_color.x);
+
+        const char* listbox_items[] = { "Decal 0", "Decal 1", "Decal 2", "Decal 3", "Decal 4", "Decal 5", "Decal 6", "Decal 7" };
+        ImGui::ListBox("Selected Decal", &m_selected_decal, listbox_items, IM_ARRAYSIZE(listbox_items), 8);
+
+        if (ImGui::Button("Clear Decals"))
+            m_clear_decal_requests++;
+
+        bool packed_g_buffer     = m_packed_g_buffer;
+        bool visibility_buffer   = m_visibility_buffer;
+        bool render_path_changed = ImGui::Checkbox("Packed G-Buffer", &m_packed_g_buffer);
+
+        if (ImGui::Checkbox("Visibility Buffer", &m_visibility_buffer))
+        {
+            create_visibility_geometry();
+            render_path_changed = true;
+        }
+
+        if (render_path_changed)
+        {
+            create_textures();
+            create_framebuffers();
+
+            // Going back to the previous path beats drawing the new one with missing variants.
+            if (!prepare_permutations())
+            {
+                DW_LOG_ERROR("Failed to prepare the shader permutations of the selected G-buffer path, reverting");
+
+                m_packed_g_buffer   = packed_g_buffer;
+                m_visibility_buffer = visibility_buffer;
+
+                create_textures();
+                create_framebuffers();
+            }
+
+            enforce_memory_budget();
+        }
+
+        // The last measured frame of each path, so switching between them compares the two.
+        for (int i = 0; i < 2; i++)
+        {
+            if (m_g_buffer_traffic_results[i].raster_fragments > 0)
+                ImGui::Text("%s Writes: %s per frame (%.2f MFragments rasterized)", kRenderPathNames[i], format_bytes(m_g_buffer_traffic_results[i].bytes).c_str(), m_g_buffer_traffic_results[i].raster_fragments / 1000000.0);
+        }
+
+        ImGui::Separator();
+
+        if (m_instances.size() > 0)
+        {
+            ImGui::SliderInt("Instance", &m_selected_instance, 0, int(m_instances.size()) - 1);
+
+            SceneInstance& instance = m_instances[m_selected_instance];
+
+            if (ImGui::DragFloat3("Instance Position", &instance.position.x, 1.0f))
+                m_instances_dirty = true;
+
+            if (ImGui::DragFloat("Instance Scale", &instance.scale, 0.01f, 0.01f, 10.0f))
+                m_instances_dirty = true;
+
+            if (ImGui::Button("Duplicate Instance"))
+            {
+                add_instance(instance.mesh, instance.position + glm::vec3(0.0f, 0.0f, m_scene_max.z - m_scene_min.z), instance.scale);
+                m_selected_instance = int(m_instances.size()) - 1;
+            }
+        }
+
+        ImGui::Checkbox("GPU Picking", &m_gpu_picking);
+
+        if (m_gpu_picking)
+            ImGui::Text("Picks In Flight: %u, Landed: %u, Skipped: %u", m_pick_readback->in_flight(), uint32_t(m_pick_readback->consumed()), uint32_t(m_pick_readback->skipped_writes()));
+
+        ImGui::Text("Meshes: %u, Instances: %u", uint32_t(m_scene_meshes.size()), uint32_t(m_instances.size()));
+
+        if (ImGui::Button("Benchmark Embree Rebuild (1k Instances)"))
+        {
+            m_rebuild_timings = benchmark_ray_scene_rebuild(INSTANCE_BENCHMARK_COUNT, INSTANCE_BENCHMARK_ITERATIONS);
+
+            DW_LOG_INFO("Embree rebuild of " + std::to_string(m_rebuild_timings.instance_count) + " instances (" + std::to_string(m_rebuild_timings.triangle_count) + " triangles): top level " + std::to_string(m_rebuild_timings.top_level_ms) + " ms, flattened " + std::to_string(m_rebuild_timings.flattened_ms) + " ms");
+        }
+
+        if (m_rebuild_timings.instance_count > 0)
+            ImGui::Text("Top Level: %.3f ms, Flattened: %.3f ms", m_rebuild_timings.top_level_ms, m_rebuild_timings.flattened_ms);
+
+        ImGui::Separator();
+
+        if (m_light_culling_program)
+        {
+            if (ImGui::Checkbox("GPU Light Culling", &m_gpu_light_culling))
+                m_lights_dirty = true;
+        }
+
+        if (ImGui::Button("No Lights"))
+            generate_lights(0);
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("1k Lights"))
+            generate_lights(1000);
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("10k Lights"))
+            generate_lights(10000);
+
+        ImGui::Text("Lights: %u", uint32_t(m_lights.size()));
+
+        ImGui::Separator();
+
+        const FrameSnapshot& snapshot = m_snapshot_buffer.read();
+
+        ImGui::Checkbox("Hi-Z Decal Culling", &m_hiz_culling);
+        ImGui::Text("Decals Drawn: %u, Frustum Culled: %u, Occlusion Culled: %u", uint32_t(snapshot.draws.size()), snapshot.decals_frustum_culled, snapshot.decals_occlusion_culled);
+
+        ImGui::Checkbox("Decal LOD", &m_decal_lod);
+        ImGui::DragFloat("LOD Drop Area (px)", &m_decal_lod_drop_area, 1.0f, 0.0f, 1024.0f);
+        ImGui::DragFloat("LOD Albedo Only Area (px)", &m_decal_lod_albedo_area, 100.0f, 0.0f, 262144.0f);
+        ImGui::Text("Decal LOD Dropped: %u, Albedo Only: %u, Full: %u", snapshot.lod_counts[DECAL_LOD_DROPPED], snapshot.lod_counts[DECAL_LOD_ALBEDO], snapshot.lod_counts[DECAL_LOD_FULL]);
+
+        if (!gpu_light_culling())
+        {
+            ImGui::Text("Light Culling (CPU): %.3f ms (%.1f lights/us), %s", m_light_culling_cpu_ms, m_light_culling_cpu_ms > 0.0 ? m_lights.size() / (m_light_culling_cpu_ms * 1000.0) : 0.0, m_light_grid_depth_bounds ? "Hi-Z depth bounds" : "full depth range");
+            ImGui::Text("Light Indices: %u (%.2f per tile)", uint32_t(m_light_grid.indices.size()), m_light_grid.tiles.size() > 0 ? float(m_light_grid.indices.size()) / float(m_light_grid.tiles.size()) : 0.0f);
+            ImGui::Text("Light Tiles Over %u Lights: %u", MAX_LIGHTS_PER_TILE, m_light_grid.overflow_tiles);
+        }
+
+        ImGui::Separator();
+
+        ImGui::Checkbox("Incremental Rendering", &m_incremental_rendering);
+
+        for (int i = 0; i < FRAME_STAGE_COUNT; i++)
+            ImGui::Text("%s: %s (skipped %u frames)", kFrameStageNames[i], kFrameStageStatusNames[m_stage_status[i]], m_stage_skip_counts[i]);
+
+        ImGui::Text("Reused Frames: %u", m_reused_frames);
+
+        const RenderGraphStats& graph_stats = m_render_graph.stats();
+        std::string             graph_order;
+
+        for (auto pass : m_render_graph.order())
+            graph_order += (graph_order.empty() ? "" : " > ") + m_render_graph.pass_name(pass);
+
+        ImGui::Text("Render Graph: %s", graph_order.c_str());
+        ImGui::Text("Passes: %u (%u culled), Resources: %u (%u culled)", graph_stats.passes, graph_stats.culled_passes, graph_stats.resources, graph_stats.culled_resources);
+        ImGui::Text("Transients: %u in %u slots, %s -> %s", graph_stats.transient_textures, graph_stats.physical_slots, format_bytes(graph_stats.transient_bytes).c_str(), format_bytes(graph_stats.allocated_bytes).c_str());
+
+        if (m_stage_status[FRAME_STAGE_G_BUFFER] == FRAME_STAGE_PARTIAL)
+            ImGui::Text("Scissor: %d, %d, %d x %d", m_scissor.x, m_scissor.y, m_scissor.z, m_scissor.w);
+
+        ImGui::Separator();
+
+        // Waiting for the worker hands the simulation state back to this thread before steps run inline again.
+        if (ImGui::Checkbox("Threaded Simulation", &m_threaded_simulation) && !m_threaded_simulation)
+            m_simulation_worker->wait_idle();
+
+        ImGui::Text("Simulation: %.3f ms, Input Latency: %.2f ms (%u frames)", snapshot.simulate_ms, m_input_latency_ms, m_input_latency_frames);
+
+        if (ImGui::Button("Benchmark Frame Pipeline (10k Decals)"))
+        {
+            m_pipeline_timings[0] = benchmark_frame_pipeline(false, PIPELINE_BENCHMARK_DECALS, PIPELINE_BENCHMARK_RENDER_MS, PIPELINE_BENCHMARK_FRAMES);
+            m_pipeline_timings[1] = benchmark_frame_pipeline(true, PIPELINE_BENCHMARK_DECALS, PIPELINE_BENCHMARK_RENDER_MS, PIPELINE_BENCHMARK_FRAMES);
+
+            const char* modes[] = { "Serial", "Threaded" };
+
+            for (int i = 0; i < 2; i++)
+                DW_LOG_INFO(std::string(modes[i]) + " frame pipeline: " + std::to_string(m_pipeline_timings[i].frame_ms) + " ms/frame, simulate " + std::to_string(m_pipeline_timings[i].simulate_ms) + " ms, latency " + std::to_string(m_pipeline_timings[i].latency_ms) + " ms (" + std::to_string(m_pipeline_timings[i].latency_frames) + " frames)");
+        }
+
+        if (m_pipeline_timings[0].frames > 0)
+        {
+            ImGui::Text("Serial: %.3f ms/frame, %.2f ms latency", m_pipeline_timings[0].frame_ms, m_pipeline_timings[0].latency_ms);
+            ImGui::Text("Threaded: %.3f ms/frame, %.2f ms latency", m_pipeline_timings[1].frame_ms, m_pipeline_timings[1].latency_ms);
+        }
+
+        ImGui::Separator();
+
+        if (ImGui::Checkbox("Compressed Decal Textures", &m_compressed_decals))
+        {
+            reload_decal_textures_with_fallback();
+            enforce_memory_budget();
+        }
+
+        ImGui::RadioButton("BC7 Albedo", &m_albedo_codec, TEXTURE_CODEC_BC7);
+        ImGui::SameLine();
+        ImGui::RadioButton("BC1 Albedo", &m_albedo_codec, TEXTURE_CODEC_BC1);
+
+        if (ImGui::Button("Build Compressed Decal Cache"))
+            build_decal_texture_cache();
+
+        if (m_decal_cache_stats.texels > 0)
+        {
+            ImGui::Text("Encode: %.2f ms (%.1f MPixels/s), Min PSNR: %.2f dB", m_decal_cache_stats.encode_ms, m_decal_cache_stats.texels / (m_decal_cache_stats.encode_ms * 1000.0), m_decal_cache_min_psnr);
+            ImGui::Text("Decal VRAM: %s -> %s", format_bytes(m_decal_cache_stats.source_bytes).c_str(), format_bytes(m_decal_cache_stats.encoded_bytes).c_str());
+        }
+
+        ImGui::Text("Decal Texture Load: %.2f ms", m_decal_load_ms);
+
+        if (ImGui::InputInt("GPU Memory Budget (MB)", &m_gpu_memory_budget_mb, 16, 128))
+        {
+            m_gpu_memory_budget_mb = std::max(m_gpu_memory_budget_mb, 0);
+            enforce_memory_budget();
+        }
+
+        ImGui::Text("GPU Memory: %s (peak %s), Decal Mip Bias: %u", format_bytes(m_gpu_memory.total_bytes()).c_str(), format_bytes(m_gpu_memory.peak_bytes()).c_str(), m_decal_mip_bias);
+
+        for (int i = 0; i < GPU_MEMORY_CATEGORY_COUNT; i++)
+            ImGui::Text("%s: %s", kGpuMemoryCategoryNames[i], format_bytes(m_gpu_memory.category_bytes(GpuMemoryCategory(i))).c_str());
+
+        const ShaderCacheStats& shader_stats = m_shader_cache->stats();
+
+        ImGui::Separator();
+        ImGui::Text("Shader Startup: %.2f ms (%s cache)", shader_stats.total_time_ms, shader_stats.cache_misses == 0 ? "warm" : "cold");
+        ImGui::Text("Programs Cached: %u, Compiled: %u, Background: %u", shader_stats.cache_hits, shader_stats.cache_misses, shader_stats.background);
+        ImGui::Text("Program Binaries: %s, Parallel Compile: %s", m_shader_cache->binary_supported() ? "Yes" : "No", m_shader_cache->parallel_supported() ? "Yes" : "No");
+        ImGui::Text("Permutations: G-Buffer %u, Decals %u, Shading %u", m_g_buffer_programs->compiled_count(), m_decals_programs->compiled_count(), m_deferred_shading_programs->compiled_count());
+
+        ImGui::Separator();
+
+        for (auto& result : m_frame_timer->results())
+            ImGui::Text("%s: %.3f ms", result.name.c_str(), result.time_ms);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool load_scene()
+    {
+        const int object_count = sizeof(kSceneObjects) / sizeof(kSceneObjects[0]);
+
+        std::vector<std::string> missing;
+
+        m_scene_min = glm::vec3(INFINITY);
+        m_scene_max = glm::vec3(-INFINITY);
+
+        for (int i = 0; i < object_count; i++)
+        {
+            const SceneObject& object = kSceneObjects[i];
+
+            if (std::find(missing.begin(), missing.end(), object.mesh) != missing.end())
+                continue;
+
+            uint32_t mesh_idx = 0;
+
+            while (mesh_idx < m_scene_meshes.size() && strcmp(m_scene_meshes[mesh_idx].path, object.mesh) != 0)
+                mesh_idx++;
+
+            if (mesh_idx == m_scene_meshes.size() && !load_scene_mesh(object.mesh, !object.optional))
+            {
+                if (!object.optional)
+                    return false;
+
+                missing.push_back(object.mesh);
+                continue;
+            }
+
+            SceneInstance instance;
+
+            instance.mesh         = mesh_idx;
+            instance.position     = object.position;
+            instance.scale        = object.scale;
+            instance.ray_instance = 0;
+
+            m_scene_meshes[mesh_idx].instances.push_back(uint32_t(m_instances.size()));
+            m_instances.push_back(instance);
+
+            // Light placement only needs a rough extent, so bound the transformed corners of the mesh bounds.
+            const SceneMesh& mesh = m_scene_meshes[mesh_idx];
+
+            for (int j = 0; j < 8; j++)
+            {
+                glm::vec3 corner = glm::vec3((j & 1) ? mesh.max_extents.x : mesh.min_extents.x, (j & 2) ? mesh.max_extents.y : mesh.min_extents.y, (j & 4) ? mesh.max_extents.z : mesh.min_extents.z);
+                glm::vec3 world  = glm::vec3(instance_transform(instance) * glm::vec4(corner, 1.0f));
+
+                m_scene_min = glm::min(m_scene_min, world);
+                m_scene_max = glm::max(m_scene_max, world);
+            }
+        }
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool load_scene_mesh(const char* path, bool required)
+    {
+        SceneMesh mesh;
+
+        mesh.path     = path;
+        mesh.mesh     = dw::Mesh::load(path);
+        mesh.ray_mesh = 0;
+
+        if (!mesh.mesh)
+        {
+            if (required)
+                DW_LOG_FATAL(std::string("Failed to load mesh: ") + path);
+            else
+                DW_LOG_WARNING(std::string("Skipping objects of missing mesh: ") + path);
+
+            return false;
+        }
+
+        dw::Vertex* vertices = mesh.mesh->vertices();
+
+        mesh.min_extents = glm::vec3(INFINITY);
+        mesh.max_extents = glm::vec3(-INFINITY);
+
+        for (uint32_t i = 0; i < mesh.mesh->vertex_count(); i++)
+        {
+            mesh.min_extents = glm::min(mesh.min_extents, vertices[i].position);
+            mesh.max_extents = glm::max(mesh.max_extents, vertices[i].position);
+        }
+
+        dw::SubMesh* submeshes = mesh.mesh->sub_meshes();
+
+        mesh.submesh_permutations.resize(mesh.mesh->sub_mesh_count());
+        mesh.submesh_draw_order.resize(mesh.mesh->sub_mesh_count());
+
+        for (uint32_t i = 0; i < mesh.mesh->sub_mesh_count(); i++)
+        {
+            mesh.submesh_permutations[i] = submeshes[i].mat->texture(aiTextureType_HEIGHT) ? PERMUTATION_NORMAL_MAP : 0;
+            mesh.submesh_draw_order[i]   = i;
+        }
+
+        // Group submeshes by permutation so each G-buffer variant is bound once per mesh.
+        std::stable_sort(mesh.submesh_draw_order.begin(), mesh.submesh_draw_order.end(), [&mesh](uint32_t a, uint32_t b) { return mesh.submesh_permutations[a] < mesh.submesh_permutations[b]; });
+
+        // Materials share textures between submeshes, so each one is only counted once.
+        std::set<dw::Texture2D*> textures;
+        aiTextureType            texture_types[] = { aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_HEIGHT, aiTextureType_NORMALS, aiTextureType_OPACITY };
+
+        for (uint32_t i = 0; i < mesh.mesh->sub_mesh_count(); i++)
+        {
+            for (auto type : texture_types)
+            {
+                dw::Texture2D* texture = submeshes[i].mat->texture(type);
+
+                if (texture)
+                    textures.insert(texture);
+            }
+        }
+
+        uint32_t texture_idx = 0;
+
+        for (auto texture : textures)
+            track_texture(std::string(path) + " Texture " + std::to_string(texture_idx++), GPU_MEMORY_MATERIAL_TEXTURES, texture);
+
+        m_scene_meshes.push_back(std::move(mesh));
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool load_decals()
+    {
+        const int decal_type_count = sizeof(kDecalTypes) / sizeof(kDecalTypes[0]);
+
+        m_decal_textures.resize(decal_type_count);
+        m_decal_normal_textures.resize(decal_type_count);
+        m_decal_permutations.resize(decal_type_count);
+        m_decal_aspect_ratios.resize(decal_type_count);
+
+        if (!reload_decal_textures())
+            return false;
+
+        for (int i = 0; i < decal_type_count; i++)
+        {
+            const DecalType& type = kDecalTypes[i];
+
+            // Taken up front so the simulation thread never queries the texture.
+            float width  = float(m_decal_textures[i]->width());
+            float height = float(m_decal_textures[i]->height());
+
+            m_decal_aspect_ratios[i] = width > height ? glm::vec2(1.0f, width / height) : glm::vec2(height / width, 1.0f);
+            m_decal_permutations[i]  = (type.normal ? PERMUTATION_NORMAL_MAP : 0) | (type.alpha_test ? PERMUTATION_ALPHA_TEST : 0);
+        }
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool reload_decal_textures()
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        std::vector<std::unique_ptr<dw::Texture2D>> albedo(m_decal_textures.size());
+        std::vector<std::unique_ptr<dw::Texture2D>> normal(m_decal_textures.size());
+
+        // Every type is loaded before any is replaced, so a failure keeps the previous textures.
+        for (int i = 0; i < m_decal_textures.size(); i++)
+        {
+            if (!load_decal_textures(i, albedo[i], normal[i]))
+                return false;
+        }
+
+        m_decal_texture_descs.clear();
+
+        for (int i = 0; i < m_decal_textures.size(); i++)
+        {
+            m_decal_textures[i]        = std::move(albedo[i]);
+            m_decal_normal_textures[i] = std::move(normal[i]);
+
+            m_decal_texture_descs.push_back(texture_desc(m_decal_textures[i].get()));
+
+            if (m_decal_normal_textures[i])
+                m_decal_texture_descs.push_back(texture_desc(m_decal_normal_textures[i].get()));
+        }
+
+        m_decal_load_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        DW_LOG_INFO("Loaded decal textures in " + std::to_string(m_decal_load_ms) + " ms");
+
+        // Freshly loaded textures are fully resident again.
+        m_decal_mip_bias = 0;
+        m_frame_valid    = false;
+
+        track_decal_textures();
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Falls back to the uncompressed textures when the compressed ones fail to load. reload_decal_textures() keeps the previous
+    // textures on failure, so nothing is ever left null.
+    void reload_decal_textures_with_fallback()
+    {
+        if (reload_decal_textures())
+            return;
+
+        if (m_compressed_decals)
+        {
+            DW_LOG_WARNING("Failed to load compressed decal textures, falling back to uncompressed ones");
+
+            m_compressed_decals = false;
+
+            if (reload_decal_textures())
+                return;
+        }
+
+        DW_LOG_ERROR("Failed to reload decal textures, keeping the previous ones");
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Loads the textures of decal type i into albedo and normal, which are left untouched on failure.
+    bool load_decal_textures(int i, std::unique_ptr<dw::Texture2D>& albedo, std::unique_ptr<dw::Texture2D>& normal)
+    {
+        const DecalType& type = kDecalTypes[i];
+
+        std::unique_ptr<dw::Texture2D> loaded_albedo;
+        std::unique_ptr<dw::Texture2D> loaded_normal;
+
+        if (!load_decal_texture(type.albedo, true, loaded_albedo))
+            return false;
+
+        if (type.normal && !load_decal_texture(type.normal, false, loaded_normal))
+            return false;
+
+        albedo = std::move(loaded_albedo);
+        normal = std::move(loaded_normal);
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool load_decal_texture(const char* path, bool albedo, std::unique_ptr<dw::Texture2D>& texture)
+    {
+        // A cache written by build_decal_texture_cache() skips decoding and mip generation entirely.
+        if (m_compressed_decals)
+        {
+            std::string  cache_path = std::string(path) + DECAL_CACHE_EXTENSION;
+            TextureCodec codec      = albedo ? TextureCodec(m_albedo_codec) : TEXTURE_CODEC_BC5;
+            bool         stale      = false;
+
+            if (load_compressed_texture(cache_path, codec, texture, stale))
+                return true;
+
+            // An entry that exists but doesn't hold what this slot expects is rebuilt from the source file.
+            if (stale)
+            {
+                DW_LOG_WARNING("Rebuilding stale texture cache: " + cache_path);
 
-        if (!m_cube_vbo)
-            DW_LOG_ERROR("Failed to create Vertex Buffer");
+                TextureCompressionStats stats;
 
-        // Create index buffer.
-        m_cube_ibo = std::make_unique<dw::IndexBuffer>(GL_STATIC_DRAW, sizeof(cube_elements), cube_elements);
+                if (build_decal_cache_entry(path, albedo, stats) && load_compressed_texture(cache_path, codec, texture, stale))
+                    return true;
+            }
+        }
 
-        if (!m_cube_ibo)
-            DW_LOG_ERROR("Failed to create Index Buffer");
+        texture = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files(path, false, albedo));
 
-        // Declare vertex attributes.
-        dw::VertexAttrib attribs[] = { { 4, GL_FLOAT, false, 0 } };
+        if (!texture)
+        {
+            DW_LOG_FATAL(std::string("Failed to load decal texture: ") + path);
+            return false;
+        }
 
-        // Create vertex array.
-        m_cube_vao = std::make_unique<dw::VertexArray>(m_cube_vbo.get(), m_cube_ibo.get(), sizeof(float) * 4, 1, attribs);
+        texture->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
+        texture->set_mag_filter(GL_LINEAR);
 
-        if (!m_cube_vao)
-            DW_LOG_ERROR("Failed to create Vertex Array");
+        return true;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    bool create_shaders()
+    // Sets stale when the file exists but is corrupt or holds another codec than the slot expects.
+    bool load_compressed_texture(const std::string& path, TextureCodec codec, std::unique_ptr<dw::Texture2D>& texture, bool& stale)
     {
+        MappedTextureContainer container;
+
+        stale = false;
+
+        if (!container.open(path) || !container.matches(codec))
         {
-            // Create general shaders
-            m_g_buffer_vs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_VERTEX_SHADER, "shader/g_buffer_vs.glsl"));
-            m_g_buffer_fs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_FRAGMENT_SHADER, "shader/g_buffer_fs.glsl"));
+            FILE* file = fopen(path.c_str(), "rb");
 
+            if (file)
             {
-                if (!m_g_buffer_vs || !m_g_buffer_fs)
-                {
-                    DW_LOG_FATAL("Failed to create Shaders");
-                    return false;
-                }
+                stale = true;
+                fclose(file);
+            }
 
-                // Create general shader program
-                dw::Shader* shaders[] = { m_g_buffer_vs.get(), m_g_buffer_fs.get() };
-                m_g_buffer_program    = std::make_unique<dw::Program>(2, shaders);
+            return false;
+        }
 
-                if (!m_g_buffer_program)
-                {
-                    DW_LOG_FATAL("Failed to create Shader Program");
-                    return false;
-                }
+        const TextureContainerHeader& header = container.header();
 
-                m_g_buffer_program->uniform_block_binding("GlobalUniforms", 0);
-            }
+        texture = std::make_unique<dw::Texture2D>(header.width, header.height, 1, header.mip_count, 1, header.internal_format, GL_RGBA, GL_UNSIGNED_BYTE);
+
+        // Blocks go from the mapped file to the driver as-is.
+        glBindTexture(GL_TEXTURE_2D, texture->id());
+
+        for (uint32_t i = 0; i < header.mip_count; i++)
+        {
+            const TextureContainerMip& mip = container.mip(i);
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, mip.width, mip.height, header.internal_format, GLsizei(mip.size), container.mip_data(i));
         }
 
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        texture->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
+        texture->set_mag_filter(GL_LINEAR);
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void build_decal_texture_cache()
+    {
+        const int decal_type_count = sizeof(kDecalTypes) / sizeof(kDecalTypes[0]);
+
+        m_decal_cache_stats    = TextureCompressionStats();
+        m_decal_cache_min_psnr = INFINITY;
+
+        for (int i = 0; i < decal_type_count * 2; i++)
         {
-            // Create general shaders
-            m_decals_vs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_VERTEX_SHADER, "shader/decals_vs.glsl"));
-            m_decals_fs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_FRAGMENT_SHADER, "shader/decals_fs.glsl"));
+            const DecalType& type   = kDecalTypes[i / 2];
+            bool             albedo = (i % 2) == 0;
+            const char*      path   = albedo ? type.albedo : type.normal;
 
-            {
-                if (!m_decals_vs || !m_decals_fs)
-                {
-                    DW_LOG_FATAL("Failed to create Shaders");
-                    return false;
-                }
+            if (!path)
+                continue;
 
-                // Create general shader program
-                dw::Shader* shaders[] = { m_decals_vs.get(), m_decals_fs.get() };
-                m_decals_program      = std::make_unique<dw::Program>(2, shaders);
+            TextureCompressionStats stats;
 
-                if (!m_decals_program)
-                {
-                    DW_LOG_FATAL("Failed to create Shader Program");
-                    return false;
-                }
+            if (!build_decal_cache_entry(path, albedo, stats))
+                continue;
 
-                m_decals_program->uniform_block_binding("GlobalUniforms", 0);
-            }
+            m_decal_cache_stats.texels += stats.texels;
+            m_decal_cache_stats.encode_ms += stats.encode_ms;
+            m_decal_cache_stats.source_bytes += stats.source_bytes;
+            m_decal_cache_stats.encoded_bytes += stats.encoded_bytes;
+            m_decal_cache_min_psnr = std::min(m_decal_cache_min_psnr, stats.psnr);
         }
 
+        if (m_compressed_decals)
         {
-            // Create general shaders
-            m_fullscreen_triangle_vs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_VERTEX_SHADER, "shader/fullscreen_triangle_vs.glsl"));
-            m_deferred_shading_fs    = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_FRAGMENT_SHADER, "shader/deferred_shading_fs.glsl"));
+            reload_decal_textures_with_fallback();
+            enforce_memory_budget();
+        }
+    }
 
-            {
-                if (!m_fullscreen_triangle_vs || !m_deferred_shading_fs)
-                {
-                    DW_LOG_FATAL("Failed to create Shaders");
-                    return false;
-                }
+    // -----------------------------------------------------------------------------------------------------------------------------------
 
-                // Create general shader program
-                dw::Shader* shaders[]      = { m_fullscreen_triangle_vs.get(), m_deferred_shading_fs.get() };
-                m_deferred_shading_program = std::make_unique<dw::Program>(2, shaders);
+    // Compresses one decal texture with the codec its slot uses and writes it to its cache entry.
+    bool build_decal_cache_entry(const char* path, bool albedo, TextureCompressionStats& stats)
+    {
+        // Always converted from the source files, whatever is resident right now.
+        std::unique_ptr<dw::Texture2D> source = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files(path, false, albedo));
 
-                if (!m_deferred_shading_program)
-                {
-                    DW_LOG_FATAL("Failed to create Shader Program");
-                    return false;
-                }
+        if (!source)
+        {
+            DW_LOG_ERROR(std::string("Failed to load decal texture: ") + path);
+            return false;
+        }
 
-                m_deferred_shading_program->uniform_block_binding("GlobalUniforms", 0);
-            }
+        std::vector<uint8_t> rgba(size_t(source->width()) * source->height() * 4);
+
+        glBindTexture(GL_TEXTURE_2D, source->id());
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        CompressedTexture compressed;
+        TextureCodec      codec = albedo ? TextureCodec(m_albedo_codec) : TEXTURE_CODEC_BC5;
+
+        compressed.srgb = albedo && (source->internal_format() == GL_SRGB8_ALPHA8 || source->internal_format() == GL_SRGB8);
+
+        stats = compress_texture(rgba.data(), source->width(), source->height(), codec, 0, compressed);
+
+        // Compared against what the uncompressed path actually keeps resident, not against the RGBA8 the encoder read.
+        stats.source_bytes = texture_bytes(texture_desc(source.get()));
+
+        std::string cache_path = std::string(path) + DECAL_CACHE_EXTENSION;
+
+        if (!write_texture_container(cache_path, compressed))
+        {
+            DW_LOG_ERROR("Failed to write texture cache: " + cache_path);
+            return false;
         }
 
+        DW_LOG_INFO(std::string(path) + ": " + kTextureCodecNames[codec] + " " + std::to_string(stats.encode_ms) + " ms (" + std::to_string(stats.texels / (stats.encode_ms * 1000.0)) + " MPixels/s), PSNR " + std::to_string(stats.psnr) + " dB, " + format_bytes(stats.source_bytes) + " -> " + format_bytes(stats.encoded_bytes));
+
         return true;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void create_textures()
+    void track_decal_textures()
     {
-        m_g_buffer_0_rt = std::make_unique<dw::Texture2D>(m_width, m_height, 1, 1, 1, GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE);
-        m_g_buffer_1_rt = std::make_unique<dw::Texture2D>(m_width, m_height, 1, 1, 1, GL_RGB32F, GL_RGB, GL_FLOAT);
-        m_g_buffer_2_rt = std::make_unique<dw::Texture2D>(m_width, m_height, 1, 1, 1, GL_RGB32F, GL_RGB, GL_FLOAT);
-        m_g_buffer_3_rt = std::make_unique<dw::Texture2D>(m_width, m_height, 1, 1, 1, GL_RGB32F, GL_RGB, GL_FLOAT);
-        m_g_buffer_4_rt = std::make_unique<dw::Texture2D>(m_width, m_height, 1, 1, 1, GL_RGB32F, GL_RGB, GL_FLOAT);
-        m_depth_rt      = std::make_unique<dw::Texture2D>(m_width, m_height, 1, 1, 1, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT);
+        for (int i = 0; i < m_decal_textures.size(); i++)
+        {
+            track_texture("Decal " + std::to_string(i) + " Albedo", GPU_MEMORY_DECAL_TEXTURES, m_decal_textures[i].get());
 
-        m_g_buffer_0_rt->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
-        m_g_buffer_1_rt->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
-        m_g_buffer_2_rt->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
-        m_g_buffer_3_rt->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
-        m_g_buffer_4_rt->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
-        m_depth_rt->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+            if (m_decal_normal_textures[i])
+                track_texture("Decal " + std::to_string(i) + " Normal", GPU_MEMORY_DECAL_TEXTURES, m_decal_normal_textures[i].get());
+        }
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void create_framebuffers()
+    TextureDesc texture_desc(dw::Texture2D* texture)
     {
-        m_g_buffer_fbo = std::make_unique<dw::Framebuffer>();
+        TextureDesc desc;
 
-        dw::Texture* gbuffer_rts[] = { m_g_buffer_0_rt.get(), m_g_buffer_1_rt.get(), m_g_buffer_2_rt.get(), m_g_buffer_3_rt.get(), m_g_buffer_4_rt.get() };
-        m_g_buffer_fbo->attach_multiple_render_targets(5, gbuffer_rts);
-        m_g_buffer_fbo->attach_depth_stencil_target(m_depth_rt.get(), 0, 0);
+        desc.internal_format = texture->internal_format();
+        desc.width           = texture->width();
+        desc.height          = texture->height();
+        desc.array_size      = texture->array_size();
+        desc.mip_levels      = texture->mip_levels();
 
-        m_decal_fbo = std::make_unique<dw::Framebuffer>();
+        return desc;
+    }
 
-        dw::Texture* decal_rts[] = { m_g_buffer_0_rt.get(), m_g_buffer_1_rt.get() };
-        m_decal_fbo->attach_multiple_render_targets(2, decal_rts);
-        m_decal_fbo->attach_depth_stencil_target(m_depth_rt.get(), 0, 0);
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void track_texture(const std::string& name, GpuMemoryCategory category, dw::Texture2D* texture)
+    {
+        m_gpu_memory.track_texture(name, category, texture_desc(texture));
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    bool create_uniform_buffer()
+    void enforce_memory_budget()
     {
-        // Create uniform buffer for global data
-        m_global_ubo = std::make_unique<dw::UniformBuffer>(GL_DYNAMIC_DRAW, sizeof(GlobalUniforms));
+        uint64_t budget   = uint64_t(m_gpu_memory_budget_mb) * 1024 * 1024;
+        uint64_t fixed    = m_gpu_memory.total_bytes() - m_gpu_memory.category_bytes(GPU_MEMORY_DECAL_TEXTURES);
+        uint32_t max_bias = 0;
+
+        for (auto& desc : m_decal_texture_descs)
+            max_bias = std::max(max_bias, desc.mip_levels - 1);
+
+        // Decal textures are the only allocations that can shrink without changing the image everywhere, so they absorb the budget.
+        if (!set_decal_mip_bias(select_mip_bias(m_decal_texture_descs, fixed, budget, max_bias)))
+            DW_LOG_ERROR("Failed to change the decal texture mip bias, keeping " + std::to_string(m_decal_mip_bias));
+
+        if (budget > 0 && m_gpu_memory.total_bytes() > budget)
+            DW_LOG_WARNING("GPU memory " + format_bytes(m_gpu_memory.total_bytes()) + " exceeds the " + format_bytes(budget) + " budget even with decal textures at their smallest mip");
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Returns false when dropped levels had to be loaded again and that failed, the current textures and bias are kept then.
+    bool set_decal_mip_bias(uint32_t bias)
+    {
+        if (bias == m_decal_mip_bias)
+            return true;
+
+        uint32_t drop = bias - m_decal_mip_bias;
+
+        // Dropped levels are gone, so making them resident again means loading the files again.
+        if (bias < m_decal_mip_bias)
+        {
+            std::vector<std::unique_ptr<dw::Texture2D>> albedo(m_decal_textures.size());
+            std::vector<std::unique_ptr<dw::Texture2D>> normal(m_decal_textures.size());
+
+            for (int i = 0; i < m_decal_textures.size(); i++)
+            {
+                if (!load_decal_textures(i, albedo[i], normal[i]))
+                    return false;
+            }
+
+            for (int i = 0; i < m_decal_textures.size(); i++)
+            {
+                m_decal_textures[i]        = std::move(albedo[i]);
+                m_decal_normal_textures[i] = std::move(normal[i]);
+            }
+
+            drop = bias;
+        }
+
+        for (int i = 0; i < m_decal_textures.size(); i++)
+        {
+            trim_texture(m_decal_textures[i], drop);
+
+            if (m_decal_normal_textures[i])
+                trim_texture(m_decal_normal_textures[i], drop);
+        }
+
+        DW_LOG_INFO("Decal textures now skip their top " + std::to_string(bias) + " mip levels");
+
+        m_decal_mip_bias = bias;
+        m_frame_valid    = false;
+
+        track_decal_textures();
 
         return true;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void ui()
+    void trim_texture(std::unique_ptr<dw::Texture2D>& texture, uint32_t drop)
     {
-        ImGui::DragFloat("Decal Rotation", &m_projector_rotation, 1.0f, -180.0f, 180.0f);
-        ImGui::DragFloat("Decal Size", &m_projector_size, 5.0f, 10.0f, 200.0f);
-        ImGui::DragFloat("Decal Extents Outer", &m_projector_outer_depth, 1.0f, 2.0f, 50.0f);
-        ImGui::DragFloat("Decal Extents Inner", &m_projector_inner_depth, 1.0f, 2.0f, 50.0f);
-        ImGui::Checkbox("Visualize Projectors", &m_visualize_projectors);
-        ImGui::ColorEdit4("Decal Overlay Color", &m_decal_overlay_color.x);
+        // Always keep the last level.
+        drop = std::min(drop, texture->mip_levels() - 1);
 
-        const char* listbox_items[] = { "Decal 0", "Decal 1", "Decal 2", "Decal 3", "Decal 4", "Decal 5", "Decal 6", "Decal 7" };
-        ImGui::ListBox("Selected Decal", &m_selected_decal, listbox_items, IM_ARRAYSIZE(listbox_items), 8);
+        if (drop == 0)
+            return;
 
-        if (ImGui::Button("Clear Decals"))
-            m_decal_instances.clear();
+        uint32_t width  = std::max(texture->width() >> drop, 1u);
+        uint32_t height = std::max(texture->height() >> drop, 1u);
+
+        std::unique_ptr<dw::Texture2D> trimmed = std::make_unique<dw::Texture2D>(width, height, 1, texture->mip_levels() - drop, 1, texture->internal_format(), texture->format(), texture->type());
+
+        if (gl_version_at_least(4, 3))
+        {
+            // A GPU side copy of the remaining levels, so lowering residency never goes back to the files.
+            for (uint32_t i = 0; i < trimmed->mip_levels(); i++)
+                glCopyImageSubData(texture->id(), GL_TEXTURE_2D, i + drop, 0, 0, 0, trimmed->id(), GL_TEXTURE_2D, i, 0, 0, 0, std::max(width >> i, 1u), std::max(height >> i, 1u), 1);
+        }
+        else
+        {
+            // glCopyImageSubData is GL 4.3, so the 4.1 path reads the remaining levels back and uploads them again.
+            TextureDesc desc = texture_desc(texture.get());
+
+            bool compressed = false;
+            texture_format_bytes(desc.internal_format, &compressed);
+
+            std::vector<uint8_t> level(texture_level_bytes(desc, drop));
+
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+            for (uint32_t i = 0; i < trimmed->mip_levels(); i++)
+            {
+                GLsizei level_width  = std::max(width >> i, 1u);
+                GLsizei level_height = std::max(height >> i, 1u);
+
+                glBindTexture(GL_TEXTURE_2D, texture->id());
+
+                if (compressed)
+                    glGetCompressedTexImage(GL_TEXTURE_2D, i + drop, level.data());
+                else
+                    glGetTexImage(GL_TEXTURE_2D, i + drop, texture->format(), texture->type(), level.data());
+
+                glBindTexture(GL_TEXTURE_2D, trimmed->id());
+
+                if (compressed)
+                    glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level_width, level_height, desc.internal_format, GLsizei(texture_level_bytes(desc, i + drop)), level.data());
+                else
+                    glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level_width, level_height, texture->format(), texture->type(), level.data());
+            }
+
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+
+        trimmed->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
+        trimmed->set_mag_filter(GL_LINEAR);
+
+        texture = std::move(trimmed);
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    bool load_scene()
+    bool initialize_embree()
     {
-        m_mesh = dw::Mesh::load("mesh/sponza.obj");
+        m_ray_scene = std::make_unique<RayScene>();
 
-        if (!m_mesh)
+        for (auto& mesh : m_scene_meshes)
         {
-            DW_LOG_FATAL("Failed to load mesh!");
-            return false;
+            std::vector<glm::vec3> vertices(mesh.mesh->vertex_count());
+            std::vector<uint32_t>  indices(mesh.mesh->index_count());
+            dw::Vertex*            vertex_ptr = mesh.mesh->vertices();
+
+            for (int i = 0; i < mesh.mesh->vertex_count(); i++)
+                vertices[i] = vertex_ptr[i].position;
+
+            uint32_t index_count = flatten_submesh_indices(mesh.mesh->indices(), mesh.mesh->sub_meshes(), mesh.mesh->sub_mesh_count(), indices.data());
+
+            mesh.ray_mesh = m_ray_scene->add_mesh(vertices.data(), uint32_t(vertices.size()), indices.data(), index_count / 3);
         }
 
+        for (auto& instance : m_instances)
+            instance.ray_instance = m_ray_scene->add_instance(m_scene_meshes[instance.mesh].ray_mesh, instance_transform(instance));
+
+        m_ray_scene->commit();
+
         return true;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    bool load_decals()
+    void create_instance_buffer()
+    {
+        glGenBuffers(1, &m_instance_buffer);
+        glGenTextures(1, &m_instance_texture);
+
+        m_instances_dirty = true;
+        update_instances();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void create_visibility_geometry()
+    {
+        if (m_visibility_vertex_buffer)
+            return;
+
+        build_visibility_geometry();
+        upload_visibility_geometry();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // CPU only, so startup runs it on a worker while the context thread carries on.
+    void build_visibility_geometry()
     {
-        m_decal_textures.resize(8);
-        m_decal_textures[0] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_00_Albedo.tga", false, true));
-        m_decal_textures[0]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_textures[0]->set_mag_filter(GL_LINEAR);
+        VisibilityGeometry& geometry = m_visibility_geometry;
 
-        m_decal_textures[1] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_01_Albedo.tga", false, true));
-        m_decal_textures[1]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_textures[1]->set_mag_filter(GL_LINEAR);
+        geometry = VisibilityGeometry();
 
-        m_decal_textures[2] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_02_Albedo.tga", false, true));
-        m_decal_textures[2]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_textures[2]->set_mag_filter(GL_LINEAR);
+        for (auto& mesh : m_scene_meshes)
+        {
+            uint32_t     base_vertex = uint32_t(geometry.vertices.size());
+            dw::Vertex*  vertices    = mesh.mesh->vertices();
+            uint32_t*    indices     = mesh.mesh->indices();
+            dw::SubMesh* submeshes   = mesh.mesh->sub_meshes();
 
-        m_decal_textures[3] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_03_Albedo.tga", false, true));
-        m_decal_textures[3]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_textures[3]->set_mag_filter(GL_LINEAR);
+            for (uint32_t i = 0; i < mesh.mesh->vertex_count(); i++)
+            {
+                VisibilityVertex vertex;
+
+                vertex.position  = vertices[i].position;
+                vertex.u         = vertices[i].tex_coord.x;
+                vertex.normal    = vertices[i].normal;
+                vertex.v         = vertices[i].tex_coord.y;
+                vertex.tangent   = vertices[i].tangent;
+                vertex.padding0  = 0.0f;
+                vertex.bitangent = vertices[i].bitangent;
+                vertex.padding1  = 0.0f;
+
+                geometry.vertices.push_back(vertex);
+            }
 
-        m_decal_textures[4] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_04_Albedo.tga", false, true));
-        m_decal_textures[4]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_textures[4]->set_mag_filter(GL_LINEAR);
+            mesh.base_draw = geometry.draw_count;
+            mesh.submesh_base_triangles.resize(mesh.mesh->sub_mesh_count());
 
-        m_decal_textures[5] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_05_Albedo.tga", false, true));
-        m_decal_textures[5]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_textures[5]->set_mag_filter(GL_LINEAR);
+            for (uint32_t i = 0; i < mesh.mesh->sub_mesh_count(); i++)
+            {
+                dw::SubMesh& submesh = submeshes[i];
 
-        m_decal_textures[6] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_06_Albedo.tga", false, true));
-        m_decal_textures[6]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_textures[6]->set_mag_filter(GL_LINEAR);
+                mesh.submesh_base_triangles[i] = uint32_t(geometry.indices.size() / 3);
 
-        m_decal_textures[7] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_07_Albedo.tga", false, true));
-        m_decal_textures[7]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_textures[7]->set_mag_filter(GL_LINEAR);
+                for (uint32_t j = submesh.base_index; j < submesh.base_index + submesh.index_count; j++)
+                    geometry.indices.push_back(base_vertex + submesh.base_vertex + indices[j]);
 
-        m_decal_normal_textures.resize(8);
-        m_decal_normal_textures[0] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_00_Normal.png", false, false));
-        m_decal_normal_textures[0]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_normal_textures[0]->set_mag_filter(GL_LINEAR);
+                geometry.triangle_draws.resize(geometry.indices.size() / 3, uint16_t(geometry.draw_count++));
+            }
+        }
+    }
 
-        m_decal_normal_textures[1] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_01_Normal.png", false, false));
-        m_decal_normal_textures[1]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_normal_textures[1]->set_mag_filter(GL_LINEAR);
+    // -----------------------------------------------------------------------------------------------------------------------------------
 
-        m_decal_normal_textures[2] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_02_Normal.png", false, false));
-        m_decal_normal_textures[2]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_normal_textures[2]->set_mag_filter(GL_LINEAR);
+    void upload_visibility_geometry()
+    {
+        VisibilityGeometry& geometry = m_visibility_geometry;
 
-        m_decal_normal_textures[3] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_03_Normal.png", false, false));
-        m_decal_normal_textures[3]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_normal_textures[3]->set_mag_filter(GL_LINEAR);
+        // Draws are told apart by a depth of (draw + 1) / VISIBILITY_MAX_DRAWS, so the last value is reserved for the clear.
+        if (geometry.draw_count >= VISIBILITY_MAX_DRAWS - 1)
+            DW_LOG_WARNING("Scene has " + std::to_string(geometry.draw_count) + " submeshes, the visibility buffer resolves at most " + std::to_string(VISIBILITY_MAX_DRAWS - 2));
 
-        m_decal_normal_textures[4] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_04_Normal.png", false, false));
-        m_decal_normal_textures[4]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_normal_textures[4]->set_mag_filter(GL_LINEAR);
+        GLuint* buffers[]  = { &m_visibility_vertex_buffer, &m_visibility_index_buffer, &m_triangle_draw_buffer };
+        GLuint* textures[] = { &m_visibility_vertex_texture, &m_visibility_index_texture, &m_triangle_draw_texture };
+        GLenum  formats[]  = { GL_RGBA32F, GL_R32UI, GL_R16UI };
+        size_t  sizes[]    = { geometry.vertices.size() * sizeof(VisibilityVertex), geometry.indices.size() * sizeof(uint32_t), geometry.triangle_draws.size() * sizeof(uint16_t) };
+        void*   data[]     = { geometry.vertices.data(), geometry.indices.data(), geometry.triangle_draws.data() };
 
-        m_decal_normal_textures[5] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_05_Normal.png", false, false));
-        m_decal_normal_textures[5]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_normal_textures[5]->set_mag_filter(GL_LINEAR);
+        const char* names[] = { "Visibility Vertices", "Visibility Indices", "Visibility Triangle Draws" };
 
-        m_decal_normal_textures[6] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_06_Normal.png", false, false));
-        m_decal_normal_textures[6]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_normal_textures[6]->set_mag_filter(GL_LINEAR);
+        for (int i = 0; i < 3; i++)
+        {
+            glGenBuffers(1, buffers[i]);
+            glBindBuffer(GL_TEXTURE_BUFFER, *buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, std::max(sizes[i], size_t(4)), sizes[i] > 0 ? data[i] : nullptr, GL_STATIC_DRAW);
 
-        m_decal_normal_textures[7] = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/Decal_07_Normal.png", false, false));
-        m_decal_normal_textures[7]->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
-        m_decal_normal_textures[7]->set_mag_filter(GL_LINEAR);
+            glGenTextures(1, textures[i]);
+            glBindTexture(GL_TEXTURE_BUFFER, *textures[i]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[i], *buffers[i]);
 
-        return true;
+            m_gpu_memory.track(names[i], GPU_MEMORY_BUFFERS, sizes[i]);
+        }
+
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+        DW_LOG_INFO("Visibility buffer geometry: " + std::to_string(geometry.vertices.size()) + " vertices, " + std::to_string(geometry.indices.size() / 3) + " triangles, " + std::to_string(geometry.draw_count) + " draws");
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    bool initialize_embree()
+    void create_g_buffer_traffic_queries()
     {
-        m_embree_device = rtcNewDevice(nullptr);
+        for (auto& traffic : m_g_buffer_traffic)
+            glGenQueries(G_BUFFER_TRAFFIC_PASS_COUNT, traffic.queries);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
 
-        RTCError embree_error = rtcGetDeviceError(m_embree_device);
+    glm::mat4 instance_transform(const SceneInstance& instance)
+    {
+        return glm::scale(glm::translate(glm::mat4(1.0f), instance.position), glm::vec3(instance.scale));
+    }
 
-        if (embree_error == RTC_ERROR_UNSUPPORTED_CPU)
-            throw std::runtime_error("Your CPU does not meet the minimum requirements for embree");
-        else if (embree_error != RTC_ERROR_NONE)
-            throw std::runtime_error("Failed to initialize embree!");
+    // -----------------------------------------------------------------------------------------------------------------------------------
 
-        m_embree_scene = rtcNewScene(m_embree_device);
+    void update_instances()
+    {
+        if (!m_instances_dirty)
+            return;
 
-        m_embree_triangle_mesh = rtcNewGeometry(m_embree_device, RTC_GEOMETRY_TYPE_TRIANGLE);
+        // Transforms are laid out mesh by mesh, so every instanced draw reads a contiguous range starting at its base instance.
+        std::vector<glm::mat4> transforms;
 
-        std::vector<glm::vec3> vertices(m_mesh->vertex_count());
-        std::vector<uint32_t>  indices(m_mesh->index_count());
-        uint32_t               idx        = 0;
-        dw::Vertex*            vertex_ptr = m_mesh->vertices();
-        uint32_t*              index_ptr  = m_mesh->indices();
+        transforms.reserve(m_instances.size());
 
-        for (int i = 0; i < m_mesh->vertex_count(); i++)
-            vertices[i] = vertex_ptr[i].position;
+        std::lock_guard<std::mutex> lock(m_ray_scene_mutex);
 
-        for (int i = 0; i < m_mesh->sub_mesh_count(); i++)
+        for (auto& mesh : m_scene_meshes)
         {
-            dw::SubMesh& submesh = m_mesh->sub_meshes()[i];
+            mesh.base_instance = uint32_t(transforms.size());
 
-            for (int j = submesh.base_index; j < (submesh.base_index + submesh.index_count); j++)
-                indices[idx++] = submesh.base_vertex + index_ptr[j];
+            for (auto i : mesh.instances)
+            {
+                transforms.push_back(instance_transform(m_instances[i]));
+                m_ray_scene->set_instance_transform(m_instances[i].ray_instance, transforms.back());
+            }
         }
 
-        void* data = rtcSetNewGeometryBuffer(m_embree_triangle_mesh, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, sizeof(glm::vec3), m_mesh->vertex_count());
-        memcpy(data, vertices.data(), vertices.size() * sizeof(glm::vec3));
+        // Only the top level is rebuilt, the meshes below it never change.
+        m_ray_scene->commit();
 
-        data = rtcSetNewGeometryBuffer(m_embree_triangle_mesh, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, 3 * sizeof(uint32_t), m_mesh->index_count() / 3);
-        memcpy(data, indices.data(), indices.size() * sizeof(uint32_t));
+        glBindBuffer(GL_TEXTURE_BUFFER, m_instance_buffer);
+        glBufferData(GL_TEXTURE_BUFFER, std::max(transforms.size(), size_t(1)) * sizeof(glm::mat4), transforms.size() > 0 ? transforms.data() : nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
 
-        rtcCommitGeometry(m_embree_triangle_mesh);
-        rtcAttachGeometry(m_embree_scene, m_embree_triangle_mesh);
-        rtcCommitScene(m_embree_scene);
+        m_gpu_memory.track("Instance Transforms", GPU_MEMORY_BUFFERS, std::max(transforms.size(), size_t(1)) * sizeof(glm::mat4));
 
-        rtcInitIntersectContext(&m_embree_intersect_context);
+        // Kept for resolving visibility ids on the CPU, which index this buffer.
+        m_instance_transforms = std::move(transforms);
 
-        return true;
+        glBindTexture(GL_TEXTURE_BUFFER, m_instance_texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_instance_buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void add_instance(uint32_t mesh, const glm::vec3& position, float scale)
+    {
+        SceneInstance instance;
+
+        std::lock_guard<std::mutex> lock(m_ray_scene_mutex);
+
+        instance.mesh         = mesh;
+        instance.position     = position;
+        instance.scale        = scale;
+        instance.ray_instance = m_ray_scene->add_instance(m_scene_meshes[mesh].ray_mesh, instance_transform(instance));
+
+        m_scene_meshes[mesh].instances.push_back(uint32_t(m_instances.size()));
+        m_instances.push_back(instance);
+
+        m_instances_dirty = true;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
@@ -786,23 +3215,64 @@ private:
     {
         m_main_camera = std::make_unique<dw::Camera>(60.0f, 0.1f, CAMERA_FAR_PLANE, float(m_width) / float(m_height), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0, 0.0f));
         m_main_camera->update();
+
+        m_camera_width  = m_width;
+        m_camera_height = m_height;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void render_mesh(dw::Mesh* mesh, glm::mat4 model, std::unique_ptr<dw::Program>& program)
+    void render_mesh(const SceneMesh& mesh, ShaderPermutations* programs)
     {
-        program->set_uniform("u_Model", model);
+        if (mesh.instances.empty())
+            return;
 
         // Bind vertex array.
-        mesh->mesh_vertex_array()->bind();
+        mesh.mesh->mesh_vertex_array()->bind();
 
-        dw::SubMesh* submeshes = mesh->sub_meshes();
+        dw::SubMesh* submeshes = mesh.mesh->sub_meshes();
 
-        for (uint32_t i = 0; i < mesh->sub_mesh_count(); i++)
+        ShaderProgram* program     = nullptr;
+        uint32_t       permutation = UINT32_MAX;
+
+        // Submeshes are stored sorted by permutation, so each variant is bound once.
+        for (auto i : mesh.submesh_draw_order)
         {
             dw::SubMesh& submesh = submeshes[i];
 
+            uint32_t key = programs->key(mesh.submesh_permutations[i] | global_permutation());
+
+            if (key != permutation)
+            {
+                if (program)
+                    m_frame_timer->end();
+
+                permutation = key;
+                program     = programs->get(permutation);
+
+                if (!program)
+                    continue;
+
+                m_frame_timer->begin("G-Buffer [" + permutation_name(permutation) + "]");
+
+                // Bind shader program.
+                program->use();
+                program->set_uniform("u_BaseInstance", int(mesh.base_instance));
+
+                if (program->set_uniform("s_InstanceTransforms", 2))
+                {
+                    glActiveTexture(GL_TEXTURE2);
+                    glBindTexture(GL_TEXTURE_BUFFER, m_instance_texture);
+                }
+            }
+
+            // The variant failed to compile, its submeshes are skipped.
+            if (!program)
+                continue;
+
+            if (m_visibility_buffer)
+                program->set_uniform("u_BaseTriangle", int(mesh.submesh_base_triangles[i]));
+
             if (submesh.mat->texture(aiTextureType_DIFFUSE))
             {
                 if (program->set_uniform("s_Albedo", 0))
@@ -816,13 +3286,16 @@ private:
             }
 
             // Issue draw call.
-            glDrawElementsBaseVertex(GL_TRIANGLES, submesh.index_count, GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * submesh.base_index), submesh.base_vertex);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, submesh.index_count, GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * submesh.base_index), GLsizei(mesh.instances.size()), submesh.base_vertex);
         }
+
+        if (program)
+            m_frame_timer->end();
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void render_scene(dw::Framebuffer* fbo, std::unique_ptr<dw::Program>& program, int x, int y, int w, int h, GLenum cull_face, bool clear = true)
+    void render_scene(dw::Framebuffer* fbo, ShaderPermutations* programs, int x, int y, int w, int h, GLenum cull_face, bool clear = true)
     {
         glEnable(GL_DEPTH_TEST);
         glDisable(GL_BLEND);
@@ -849,14 +3322,12 @@ private:
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         }
 
-        // Bind shader program.
-        program->use();
-
         // Bind uniform buffers.
         m_global_ubo->bind_base(0);
 
         // Draw scene.
-        render_mesh(m_mesh, m_transform, program);
+        for (auto& mesh : m_scene_meshes)
+            render_mesh(mesh, programs);
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
@@ -870,74 +3341,84 @@ private:
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void update_transforms(dw::Camera* camera)
+    void update_camera(const SimulationInput& input)
     {
-        // Update camera matrices.
-        m_global_uniforms.view_proj     = camera->m_projection * camera->m_view;
-        m_global_uniforms.inv_view_proj = glm::inverse(m_global_uniforms.view_proj);
-        m_global_uniforms.cam_pos       = glm::vec4(camera->m_position, 0.0f);
-    }
+        dw::Camera* current = m_main_camera.get();
 
-    // -----------------------------------------------------------------------------------------------------------------------------------
+        if (input.width != m_camera_width || input.height != m_camera_height)
+        {
+            current->update_projection(60.0f, 0.1f, CAMERA_FAR_PLANE, float(input.width) / float(input.height));
 
-    void update_camera()
-    {
-        dw::Camera* current = m_main_camera.get();
+            m_camera_width  = input.width;
+            m_camera_height = input.height;
+        }
 
-        float forward_delta = m_heading_speed * m_delta;
-        float right_delta   = m_sideways_speed * m_delta;
+        // Everything since the last simulated input, which covers several frames when the simulation fell behind.
+        CameraMotion motion = camera_motion_delta(m_sim_camera_motion, input.camera_motion);
+        m_sim_camera_motion = input.camera_motion;
 
-        current->set_translation_delta(current->m_forward, forward_delta);
-        current->set_translation_delta(current->m_right, right_delta);
+        current->set_translation_delta(current->m_forward, float(motion.forward));
+        current->set_translation_delta(current->m_right, float(motion.right));
 
-        m_camera_x = m_mouse_delta_x * m_camera_sensitivity;
-        m_camera_y = m_mouse_delta_y * m_camera_sensitivity;
+        m_camera_x = float(motion.yaw);
+        m_camera_y = float(motion.pitch);
 
-        if (m_mouse_look)
-        {
-            // Activate Mouse Look
-            current->set_rotatation_delta(glm::vec3((float)(m_camera_y),
-                                                    (float)(m_camera_x),
-                                                    (float)(0.0f)));
-        }
-        else
-        {
-            current->set_rotatation_delta(glm::vec3((float)(0),
-                                                    (float)(0),
-                                                    (float)(0)));
-        }
+        // Mouse look only accumulates while active, otherwise the rotation is zero.
+        current->set_rotatation_delta(glm::vec3((float)(m_camera_y),
+                                                (float)(m_camera_x),
+                                                (float)(0.0f)));
 
         current->update();
-        update_transforms(current);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    static double steady_time_ms()
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
 private:
     // General GPU resources.
-    std::unique_ptr<dw::Shader> m_g_buffer_vs;
-    std::unique_ptr<dw::Shader> m_g_buffer_fs;
-    std::unique_ptr<dw::Shader> m_decals_vs;
-    std::unique_ptr<dw::Shader> m_decals_fs;
-    std::unique_ptr<dw::Shader> m_fullscreen_triangle_vs;
-    std::unique_ptr<dw::Shader> m_deferred_shading_fs;
-
-    std::unique_ptr<dw::Program> m_g_buffer_program;
-    std::unique_ptr<dw::Program> m_decals_program;
-    std::unique_ptr<dw::Program> m_deferred_shading_program;
-
-    std::unique_ptr<dw::Texture2D> m_g_buffer_0_rt; // Albedo
-    std::unique_ptr<dw::Texture2D> m_g_buffer_1_rt; // Normal
-    std::unique_ptr<dw::Texture2D> m_g_buffer_2_rt; // Source Normal
-    std::unique_ptr<dw::Texture2D> m_g_buffer_3_rt; // Tangent
-    std::unique_ptr<dw::Texture2D> m_g_buffer_4_rt; // Bitangent
+    std::unique_ptr<ShaderCache> m_shader_cache;
+    std::unique_ptr<FrameTimer>  m_frame_timer;
+
+    std::unique_ptr<ShaderPermutations> m_g_buffer_programs;
+    std::unique_ptr<ShaderPermutations> m_decals_programs;
+    std::unique_ptr<ShaderPermutations> m_deferred_shading_programs;
+    std::unique_ptr<ShaderProgram>      m_light_culling_program;
+    std::unique_ptr<ShaderProgram>      m_hiz_downsample_program;
+    std::unique_ptr<ShaderPermutations> m_visibility_programs;
+    std::unique_ptr<ShaderPermutations> m_visibility_resolve_programs;
+    std::unique_ptr<ShaderProgram>      m_material_classify_program;
+
+    std::unique_ptr<dw::Texture2D> m_g_buffer_0_rt;           // Albedo
+    std::unique_ptr<dw::Texture2D> m_g_buffer_1_rt;           // Normal
+    std::unique_ptr<dw::Texture2D> m_g_buffer_2_rt;           // Source Normal
+    dw::Texture2D*                 m_g_buffer_3_rt = nullptr; // Tangent, transient.
+    dw::Texture2D*                 m_g_buffer_4_rt = nullptr; // Bitangent, transient.
     std::unique_ptr<dw::Texture2D> m_depth_rt;
+    std::unique_ptr<dw::Texture2D> m_visibility_rt;               // Visibility buffer only.
+    dw::Texture2D*                 m_material_depth_rt = nullptr; // Visibility buffer only, transient.
+
+    std::unique_ptr<dw::Texture2D> m_shaded_rt;
 
     std::unique_ptr<dw::Framebuffer> m_g_buffer_fbo;
+    std::unique_ptr<dw::Framebuffer> m_visibility_resolve_fbo;
     std::unique_ptr<dw::Framebuffer> m_decal_fbo;
+    std::unique_ptr<dw::Framebuffer> m_shaded_fbo;
+
+    // Render graph
+    RenderGraph                                 m_render_graph;
+    std::vector<std::unique_ptr<dw::Texture2D>> m_transient_textures; // Indexed by physical slot.
+    bool                                        m_transient_framebuffers_dirty = true;
 
     std::vector<std::unique_ptr<dw::Texture2D>> m_decal_textures;
     std::vector<std::unique_ptr<dw::Texture2D>> m_decal_normal_textures;
+    std::vector<uint32_t>                       m_decal_permutations;
+    std::vector<glm::vec2>                      m_decal_aspect_ratios;
 
     std::unique_ptr<dw::UniformBuffer> m_global_ubo;
 
@@ -945,14 +3426,92 @@ private:
     std::unique_ptr<dw::IndexBuffer>  m_cube_ibo;
     std::unique_ptr<dw::VertexArray>  m_cube_vao;
 
+    // GPU memory
+    GpuMemoryRegistry        m_gpu_memory;
+    std::vector<TextureDesc> m_decal_texture_descs; // Fully resident, the budget is solved against these.
+    int32_t                  m_gpu_memory_budget_mb = GPU_MEMORY_BUDGET_MB;
+    uint32_t                 m_decal_mip_bias       = 0;
+
+    // Visibility buffer
+    bool                m_visibility_buffer = false;
+    VisibilityGeometry  m_visibility_geometry;
+    GLuint              m_visibility_vertex_buffer  = 0;
+    GLuint              m_visibility_index_buffer   = 0;
+    GLuint              m_triangle_draw_buffer      = 0;
+    GLuint              m_visibility_vertex_texture = 0;
+    GLuint              m_visibility_index_texture  = 0;
+    GLuint              m_triangle_draw_texture     = 0;
+    GBufferTrafficFrame m_g_buffer_traffic[G_BUFFER_TRAFFIC_FRAMES];
+    GBufferTraffic      m_g_buffer_traffic_results[2]; // Indexed by whether the visibility buffer was on.
+
+    // Texture compression
+    bool                    m_compressed_decals    = true; // Prefer DECAL_CACHE_EXTENSION caches next to the source files.
+    int32_t                 m_albedo_codec         = TEXTURE_CODEC_BC7;
+    double                  m_decal_load_ms        = 0.0;
+    double                  m_decal_cache_min_psnr = 0.0;
+    TextureCompressionStats m_decal_cache_stats;
+
     // Camera.
     std::unique_ptr<dw::Camera> m_main_camera;
 
     GlobalUniforms m_global_uniforms;
 
     // Scene
-    dw::Mesh* m_mesh;
-    glm::mat4 m_transform;
+    std::vector<SceneMesh>     m_scene_meshes;
+    std::vector<SceneInstance> m_instances;
+    GLuint                     m_instance_buffer   = 0;
+    GLuint                     m_instance_texture  = 0;
+    bool                       m_instances_dirty   = true;
+    uint64_t                   m_scene_version     = 0; // Bumped by frames that upload moved instances.
+    int32_t                    m_selected_instance = 0;
+    bool                       m_packed_g_buffer   = false;
+    std::vector<glm::mat4>     m_instance_transforms;
+    glm::vec3                  m_scene_min;
+    glm::vec3                  m_scene_max;
+    RaySceneRebuildTimings     m_rebuild_timings;
+
+    // Lights
+    std::vector<Light>     m_lights;
+    LightGrid              m_light_grid;
+    std::vector<glm::vec2> m_light_tile_depth_bounds;
+    GLuint                 m_light_buffer            = 0;
+    GLuint                 m_light_tile_buffer       = 0;
+    GLuint                 m_light_index_buffer      = 0;
+    GLuint                 m_light_texture           = 0;
+    GLuint                 m_light_tile_texture      = 0;
+    GLuint                 m_light_index_texture     = 0;
+    size_t                 m_light_index_buffer_size = 0;
+    bool                   m_gpu_light_culling       = true;
+    bool                   m_lights_dirty            = true;
+    bool                   m_light_grid_depth_bounds = false; // Whether the CPU grid was binned with the Hi-Z depth bounds.
+    double                 m_light_culling_cpu_ms    = 0.0;
+
+    // Hi-Z
+    std::unique_ptr<dw::Texture2D>                                m_hiz_rt;
+    std::vector<GLuint>                                           m_hiz_fbos;
+    std::unique_ptr<ReadbackRing<GLReadbackBackend, HiZReadback>> m_hiz_readback;
+    uint32_t                                                      m_hiz_readback_level  = 0;
+    uint32_t                                                      m_hiz_readback_width  = 0;
+    uint32_t                                                      m_hiz_readback_height = 0;
+    std::shared_ptr<const OcclusionSnapshot>                      m_occlusion;
+    uint64_t                                                      m_occlusion_scene_version = 0;
+    bool                                                          m_hiz_culling = true;
+
+    // Decal LOD
+    bool  m_decal_lod             = true;
+    float m_decal_lod_drop_area   = 4.0f;
+    float m_decal_lod_albedo_area = 4096.0f;
+
+    // Incremental rendering
+    bool                                  m_incremental_rendering = true;
+    bool                                  m_frame_valid           = false;
+    glm::mat4                             m_last_view_proj;
+    std::vector<std::pair<uint32_t, int>> m_last_decal_draw_order;
+    int                                   m_last_decal_instance_count            = 0;
+    glm::ivec4                            m_scissor                              = glm::ivec4(0);
+    FrameStageStatus                      m_stage_status[FRAME_STAGE_COUNT]      = { FRAME_STAGE_FULL, FRAME_STAGE_FULL, FRAME_STAGE_FULL, FRAME_STAGE_FULL, FRAME_STAGE_FULL };
+    uint32_t                              m_stage_skip_counts[FRAME_STAGE_COUNT] = { 0 };
+    uint32_t                              m_reused_frames                        = 0;
 
     // Camera controls.
     bool  m_mouse_look         = false;
@@ -962,11 +3521,33 @@ private:
     float m_camera_speed       = 0.2f;
     bool  m_debug_gui          = true;
 
-    // Embree structure
-    RTCDevice           m_embree_device        = nullptr;
-    RTCScene            m_embree_scene         = nullptr;
-    RTCGeometry         m_embree_triangle_mesh = nullptr;
-    RTCIntersectContext m_embree_intersect_context;
+    // Picking
+    std::unique_ptr<RayScene>                                     m_ray_scene;
+    std::mutex                                                    m_ray_scene_mutex; // Instance edits here, traces on the simulation thread.
+    std::unique_ptr<ReadbackRing<GLReadbackBackend, PickRequest>> m_pick_readback;
+    bool                                                          m_gpu_picking  = false;
+    bool                                                          m_gpu_pick_hit = false;
+    PickResult                                                    m_gpu_pick;
+
+    // Simulation thread. The render thread only exchanges inputs and snapshots with it through the triple buffers.
+    std::unique_ptr<FrameWorker>  m_simulation_worker;
+    TripleBuffer<SimulationInput> m_input_buffer;
+    TripleBuffer<FrameSnapshot>   m_snapshot_buffer;
+    bool                          m_threaded_simulation  = true;
+    uint64_t                      m_frame_index          = 0;
+    uint32_t                      m_place_decal_requests = 0;
+    uint32_t                      m_clear_decal_requests = 0;
+    CameraMotion                  m_camera_motion;
+    double                        m_input_latency_ms     = 0.0;
+    uint32_t                      m_input_latency_frames = 0;
+    FramePipelineStats            m_pipeline_timings[2];
+
+    // Owned by the simulation thread.
+    uint32_t     m_sim_place_requests = 0;
+    uint32_t     m_sim_clear_requests = 0;
+    CameraMotion m_sim_camera_motion;
+    uint32_t     m_camera_width  = 0;
+    uint32_t     m_camera_height = 0;
 
     // Last hit
     glm::vec3 m_hit_pos;
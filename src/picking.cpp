@@ -0,0 +1,41 @@
+#include "picking.h"
+#include <algorithm>
+#include <cmath>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 octahedral_decode(const glm::vec2& e)
+{
+    glm::vec3 n = glm::vec3(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+    float     t = std::max(-n.z, 0.0f);
+
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+
+    return glm::normalize(n);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool resolve_pick(const PickTexel& texel, const PickRequest& request, PickResult& result)
+{
+    if (texel.depth >= 1.0f)
+        return false;
+
+    glm::vec4 world_pos = request.inv_view_proj * glm::vec4(request.ndc, texel.depth * 2.0f - 1.0f, 1.0f);
+
+    result.position = glm::vec3(world_pos) / world_pos.w;
+    result.distance = glm::length(result.position - request.camera_pos);
+
+    if (request.visibility_id)
+        return true;
+
+    if (request.packed_normal)
+        result.normal = octahedral_decode(glm::vec2(texel.normal[0], texel.normal[1]));
+    else
+        result.normal = glm::normalize(glm::vec3(texel.normal[0], texel.normal[1], texel.normal[2]));
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
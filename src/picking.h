@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm.hpp>
+#include <stdint.h>
+
+// Everything needed to turn a read back texel into a hit once it lands, captured when the copy is issued.
+struct PickRequest
+{
+    glm::vec2 ndc;
+    glm::mat4 inv_view_proj;
+    glm::vec3 camera_pos;
+    bool      packed_normal;
+    bool      visibility_id; // The texel holds a visibility id instead of a normal, which the caller rebuilds from the triangle.
+};
+
+// Layout of a pick readback: window space depth followed by the source normal, as two floats when the G-buffer is packed, or by the
+// visibility id when the visibility buffer is used.
+struct PickTexel
+{
+    float    depth;
+    float    normal[3];
+    uint32_t id[2];
+};
+
+struct PickResult
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    float     distance;
+};
+
+// CPU counterpart of octahedral_decode() in deferred_shading_fs.glsl.
+glm::vec3 octahedral_decode(const glm::vec2& e);
+
+// Returns false when the texel is background, i.e. nothing was rasterized under the cursor.
+bool resolve_pick(const PickTexel& texel, const PickRequest& request, PickResult& result);
@@ -0,0 +1,289 @@
+#define _USE_MATH_DEFINES
+#include "ray_scene.h"
+#include <gtc/matrix_transform.hpp>
+#include <stdexcept>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RayScene::RayScene()
+{
+    m_device = rtcNewDevice(nullptr);
+
+    RTCError embree_error = rtcGetDeviceError(m_device);
+
+    if (embree_error == RTC_ERROR_UNSUPPORTED_CPU)
+        throw std::runtime_error("Your CPU does not meet the minimum requirements for embree");
+    else if (embree_error != RTC_ERROR_NONE)
+        throw std::runtime_error("Failed to initialize embree!");
+
+    // The top level only holds instances and is rebuilt whenever one moves, so favour build speed over trace speed.
+    m_scene = rtcNewScene(m_device);
+    rtcSetSceneFlags(m_scene, RTC_SCENE_FLAG_DYNAMIC);
+    rtcSetSceneBuildQuality(m_scene, RTC_BUILD_QUALITY_LOW);
+
+    rtcInitIntersectContext(&m_intersect_context);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RayScene::~RayScene()
+{
+    for (auto& instance : m_instances)
+        rtcReleaseGeometry(instance.geometry);
+
+    for (auto& mesh : m_meshes)
+        rtcReleaseScene(mesh.scene);
+
+    rtcReleaseScene(m_scene);
+    rtcReleaseDevice(m_device);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t RayScene::add_mesh(const glm::vec3* positions, uint32_t vertex_count, const uint32_t* indices, uint32_t triangle_count)
+{
+    Mesh mesh;
+
+    mesh.scene = rtcNewScene(m_device);
+    mesh.positions.assign(positions, positions + vertex_count);
+    mesh.indices.assign(indices, indices + triangle_count * 3);
+
+    RTCGeometry geometry = rtcNewGeometry(m_device, RTC_GEOMETRY_TYPE_TRIANGLE);
+
+    void* data = rtcSetNewGeometryBuffer(geometry, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, sizeof(glm::vec3), vertex_count);
+    memcpy(data, positions, vertex_count * sizeof(glm::vec3));
+
+    data = rtcSetNewGeometryBuffer(geometry, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, 3 * sizeof(uint32_t), triangle_count);
+    memcpy(data, indices, triangle_count * 3 * sizeof(uint32_t));
+
+    rtcCommitGeometry(geometry);
+    rtcAttachGeometry(mesh.scene, geometry);
+    rtcReleaseGeometry(geometry);
+    rtcCommitScene(mesh.scene);
+
+    m_meshes.push_back(std::move(mesh));
+
+    return uint32_t(m_meshes.size() - 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t RayScene::add_instance(uint32_t mesh, const glm::mat4& transform)
+{
+    Instance instance;
+
+    instance.mesh     = mesh;
+    instance.geometry = rtcNewGeometry(m_device, RTC_GEOMETRY_TYPE_INSTANCE);
+
+    rtcSetGeometryInstancedScene(instance.geometry, m_meshes[mesh].scene);
+    rtcSetGeometryTimeStepCount(instance.geometry, 1);
+
+    uint32_t id = uint32_t(m_instances.size());
+
+    // Attach by ID so the instance ID Embree reports is the index into m_instances.
+    rtcAttachGeometryByID(m_scene, instance.geometry, id);
+
+    m_instances.push_back(instance);
+
+    set_instance_transform(id, transform);
+
+    return id;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RayScene::set_instance_transform(uint32_t instance, const glm::mat4& transform)
+{
+    Instance& inst = m_instances[instance];
+
+    inst.transform     = transform;
+    inst.normal_matrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+
+    rtcSetGeometryTransform(inst.geometry, 0, RTC_FORMAT_FLOAT4X4_COLUMN_MAJOR, &transform[0][0]);
+    rtcCommitGeometry(inst.geometry);
+
+    m_dirty = true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RayScene::commit()
+{
+    if (!m_dirty)
+        return;
+
+    rtcCommitScene(m_scene);
+    m_dirty = false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool RayScene::intersect(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit)
+{
+    RTCRayHit rayhit;
+
+    rayhit.ray.org_x = origin.x;
+    rayhit.ray.org_y = origin.y;
+    rayhit.ray.org_z = origin.z;
+
+    rayhit.ray.dir_x = direction.x;
+    rayhit.ray.dir_y = direction.y;
+    rayhit.ray.dir_z = direction.z;
+
+    rayhit.ray.tnear     = 0;
+    rayhit.ray.tfar      = INFINITY;
+    rayhit.ray.time      = 0.0f;
+    rayhit.ray.mask      = 0xFFFFFFFF;
+    rayhit.ray.flags     = 0;
+    rayhit.hit.geomID    = RTC_INVALID_GEOMETRY_ID;
+    rayhit.hit.instID[0] = RTC_INVALID_GEOMETRY_ID;
+
+    rtcIntersect1(m_scene, &m_intersect_context, &rayhit);
+
+    if (rayhit.hit.geomID == RTC_INVALID_GEOMETRY_ID)
+        return false;
+
+    const Instance& instance = m_instances[rayhit.hit.instID[0]];
+
+    // Embree reports the geometric normal in the space of the instanced mesh.
+    hit.distance  = rayhit.ray.tfar;
+    hit.normal    = glm::normalize(instance.normal_matrix * glm::vec3(rayhit.hit.Ng_x, rayhit.hit.Ng_y, rayhit.hit.Ng_z));
+    hit.instance  = rayhit.hit.instID[0];
+    hit.primitive = rayhit.hit.primID;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RTCScene RayScene::build_flattened()
+{
+    size_t vertex_count = 0;
+    size_t index_count  = 0;
+
+    for (auto& instance : m_instances)
+    {
+        vertex_count += m_meshes[instance.mesh].positions.size();
+        index_count += m_meshes[instance.mesh].indices.size();
+    }
+
+    RTCScene    scene    = rtcNewScene(m_device);
+    RTCGeometry geometry = rtcNewGeometry(m_device, RTC_GEOMETRY_TYPE_TRIANGLE);
+
+    glm::vec3* positions = (glm::vec3*)rtcSetNewGeometryBuffer(geometry, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, sizeof(glm::vec3), vertex_count);
+    uint32_t*  indices   = (uint32_t*)rtcSetNewGeometryBuffer(geometry, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, 3 * sizeof(uint32_t), index_count / 3);
+    uint32_t   base      = 0;
+
+    for (auto& instance : m_instances)
+    {
+        const Mesh& mesh = m_meshes[instance.mesh];
+
+        for (auto& position : mesh.positions)
+            *positions++ = glm::vec3(instance.transform * glm::vec4(position, 1.0f));
+
+        for (auto index : mesh.indices)
+            *indices++ = base + index;
+
+        base += uint32_t(mesh.positions.size());
+    }
+
+    rtcCommitGeometry(geometry);
+    rtcAttachGeometry(scene, geometry);
+    rtcReleaseGeometry(geometry);
+    rtcCommitScene(scene);
+
+    return scene;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void generate_sphere(uint32_t rings, uint32_t segments, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+{
+    for (uint32_t r = 0; r <= rings; r++)
+    {
+        float theta = float(M_PI) * float(r) / float(rings);
+
+        for (uint32_t s = 0; s <= segments; s++)
+        {
+            float phi = 2.0f * float(M_PI) * float(s) / float(segments);
+            positions.push_back(glm::vec3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)));
+        }
+    }
+
+    for (uint32_t r = 0; r < rings; r++)
+    {
+        for (uint32_t s = 0; s < segments; s++)
+        {
+            uint32_t i0 = r * (segments + 1) + s;
+            uint32_t i1 = i0 + segments + 1;
+
+            indices.insert(indices.end(), { i0, i1, i0 + 1, i0 + 1, i1, i1 + 1 });
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+RaySceneRebuildTimings benchmark_ray_scene_rebuild(uint32_t instance_count, uint32_t iterations)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t>  indices;
+
+    generate_sphere(32, 64, positions, indices);
+
+    std::mt19937                          generator(1337);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    RayScene scene;
+    uint32_t mesh = scene.add_mesh(positions.data(), uint32_t(positions.size()), indices.data(), uint32_t(indices.size() / 3));
+
+    for (uint32_t i = 0; i < instance_count; i++)
+        scene.add_instance(mesh, glm::translate(glm::mat4(1.0f), glm::vec3(unit(generator), unit(generator), unit(generator)) * 100.0f));
+
+    scene.commit();
+
+    RaySceneRebuildTimings timings;
+
+    timings.instance_count = instance_count;
+    timings.triangle_count = uint32_t(indices.size() / 3) * instance_count;
+
+    std::vector<glm::mat4> transforms(instance_count);
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        // Every instance moves, which is the worst case for the top level and the only case for the flattened scene.
+        for (uint32_t j = 0; j < instance_count; j++)
+            transforms[j] = glm::translate(scene.instance_transform(j), glm::vec3(unit(generator), unit(generator), unit(generator)));
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // Both paths are timed end to end, for the top level that includes committing every moved instance geometry.
+        for (uint32_t j = 0; j < instance_count; j++)
+            scene.set_instance_transform(j, transforms[j]);
+
+        scene.commit();
+
+        auto mid = std::chrono::high_resolution_clock::now();
+
+        rtcReleaseScene(scene.build_flattened());
+
+        auto end = std::chrono::high_resolution_clock::now();
+
+        timings.top_level_ms += std::chrono::duration<double, std::milli>(mid - start).count();
+        timings.flattened_ms += std::chrono::duration<double, std::milli>(end - mid).count();
+    }
+
+    if (iterations > 0)
+    {
+        timings.top_level_ms /= iterations;
+        timings.flattened_ms /= iterations;
+    }
+
+    return timings;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <glm.hpp>
+#include <vector>
+#include <stdint.h>
+#include <rtcore.h>
+
+struct RayHit
+{
+    float     distance  = INFINITY;
+    glm::vec3 normal    = glm::vec3(0.0f); // World space geometric normal.
+    uint32_t  instance  = RTC_INVALID_GEOMETRY_ID;
+    uint32_t  primitive = RTC_INVALID_GEOMETRY_ID;
+};
+
+// Two-level Embree scene. Every mesh is built once into its own bottom-level scene and placed through instances, so moving an
+// instance only rebuilds the top-level scene.
+class RayScene
+{
+public:
+    RayScene();
+    ~RayScene();
+
+    // Returns the mesh index used by add_instance().
+    uint32_t add_mesh(const glm::vec3* positions, uint32_t vertex_count, const uint32_t* indices, uint32_t triangle_count);
+
+    // Returns the instance index, which is also the instance ID reported by intersect().
+    uint32_t add_instance(uint32_t mesh, const glm::mat4& transform);
+    void     set_instance_transform(uint32_t instance, const glm::mat4& transform);
+
+    // Rebuilds the top-level scene if instances were added or moved since the last commit.
+    void commit();
+
+    bool intersect(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit);
+
+    // Single-level scene holding every instance's triangles pre-transformed, i.e. what a move costs without instancing. The
+    // caller releases it.
+    RTCScene build_flattened();
+
+    inline uint32_t         mesh_count() const { return uint32_t(m_meshes.size()); }
+    inline uint32_t         instance_count() const { return uint32_t(m_instances.size()); }
+    inline const glm::mat4& instance_transform(uint32_t instance) const { return m_instances[instance].transform; }
+
+private:
+    struct Mesh
+    {
+        RTCScene               scene;
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t>  indices;
+    };
+
+    struct Instance
+    {
+        uint32_t    mesh;
+        RTCGeometry geometry;
+        glm::mat4   transform;
+        glm::mat3   normal_matrix;
+    };
+
+private:
+    RTCDevice             m_device = nullptr;
+    RTCScene              m_scene  = nullptr;
+    RTCIntersectContext   m_intersect_context;
+    std::vector<Mesh>     m_meshes;
+    std::vector<Instance> m_instances;
+    bool                  m_dirty = true;
+};
+
+struct RaySceneRebuildTimings
+{
+    uint32_t instance_count = 0;
+    uint32_t triangle_count = 0; // Across all instances.
+    double   top_level_ms   = 0.0;
+    double   flattened_ms   = 0.0;
+};
+
+// Concatenates the index ranges of every submesh, offset by their base vertex, so one mesh indexes all of its vertices directly.
+// SubMesh needs base_index, index_count and base_vertex. flattened must hold every submesh's indices, their total is returned.
+template <typename SubMesh>
+uint32_t flatten_submesh_indices(const uint32_t* indices, const SubMesh* submeshes, uint32_t submesh_count, uint32_t* flattened)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < submesh_count; i++)
+    {
+        const SubMesh& submesh = submeshes[i];
+
+        for (uint32_t j = submesh.base_index; j < submesh.base_index + submesh.index_count; j++)
+            flattened[count++] = submesh.base_vertex + indices[j];
+    }
+
+    return count;
+}
+
+// Unit UV sphere around the origin, shared by the benchmarks.
+void generate_sphere(uint32_t rings, uint32_t segments, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices);
+
+// Moves every instance of a generated sphere mesh and measures the top-level rebuild against rebuilding a flattened scene, both
+// averaged over the given number of iterations.
+RaySceneRebuildTimings benchmark_ray_scene_rebuild(uint32_t instance_count, uint32_t iterations);
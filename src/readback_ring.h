@@ -0,0 +1,153 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+// Ring of readback buffers, each guarded by a fence, so GPU to CPU copies are consumed a few frames later without ever waiting.
+// Backend provides the buffer and fence primitives:
+//
+//   typedef ... Buffer;
+//   typedef ... Fence;
+//   Buffer      create_buffer(size_t size);
+//   void        destroy_buffer(Buffer buffer);
+//   Fence       insert_fence();
+//   bool        is_signaled(Fence fence);
+//   void        destroy_fence(Fence fence);
+//   const void* map(Buffer buffer, size_t size);
+//   void        unmap(Buffer buffer);
+//
+// GLReadbackBackend in gl_readback.h implements it with PBOs and sync objects. Payload is whatever the consumer needs to interpret
+// a copy later, e.g. the view-projection it was rendered with.
+template <typename Backend, typename Payload>
+class ReadbackRing
+{
+public:
+    ReadbackRing(const Backend& backend, uint32_t slot_count, size_t size) :
+        m_backend(backend), m_slots(slot_count), m_size(size)
+    {
+        for (auto& slot : m_slots)
+            slot.buffer = m_backend.create_buffer(size);
+    }
+
+    ~ReadbackRing()
+    {
+        for (auto& slot : m_slots)
+        {
+            if (slot.in_flight)
+                m_backend.destroy_fence(slot.fence);
+
+            m_backend.destroy_buffer(slot.buffer);
+        }
+    }
+
+    // Returns false when the next slot is still in flight, in which case this frame's copy is skipped rather than waited for.
+    // Otherwise the caller copies into 'buffer' and calls end_write().
+    bool begin_write(typename Backend::Buffer& buffer)
+    {
+        Slot& slot = m_slots[m_write_index];
+
+        if (slot.in_flight)
+        {
+            m_skipped_writes++;
+            return false;
+        }
+
+        buffer = slot.buffer;
+
+        return true;
+    }
+
+    void end_write(const Payload& payload)
+    {
+        Slot& slot = m_slots[m_write_index];
+
+        slot.fence     = m_backend.insert_fence();
+        slot.payload   = payload;
+        slot.in_flight = true;
+        slot.sequence  = m_next_sequence++;
+
+        m_write_index = (m_write_index + 1) % uint32_t(m_slots.size());
+    }
+
+    // Calls fn(data, payload) with the newest copy whose fence has signalled and frees every older slot with it. Fences signal in
+    // submission order, so older copies are complete too but would only be stale. Returns false when nothing has landed yet.
+    template <typename Fn>
+    bool consume_latest(Fn fn)
+    {
+        int32_t newest = -1;
+
+        // Picked by sequence rather than slot position, so after the ring wraps an older copy can't win over a newer one.
+        for (uint32_t i = 0; i < m_slots.size(); i++)
+        {
+            if (!m_slots[i].in_flight || (newest != -1 && m_slots[i].sequence < m_slots[newest].sequence))
+                continue;
+
+            if (m_backend.is_signaled(m_slots[i].fence))
+                newest = int32_t(i);
+        }
+
+        if (newest == -1)
+            return false;
+
+        uint64_t sequence = m_slots[newest].sequence;
+
+        for (auto& slot : m_slots)
+        {
+            if (slot.in_flight && slot.sequence <= sequence)
+            {
+                m_backend.destroy_fence(slot.fence);
+                slot.in_flight = false;
+            }
+        }
+
+        Slot&       slot = m_slots[newest];
+        const void* data = m_backend.map(slot.buffer, m_size);
+
+        if (!data)
+            return false;
+
+        fn(data, slot.payload);
+        m_backend.unmap(slot.buffer);
+
+        m_consumed++;
+
+        return true;
+    }
+
+    uint32_t in_flight() const
+    {
+        uint32_t count = 0;
+
+        for (auto& slot : m_slots)
+            count += slot.in_flight ? 1 : 0;
+
+        return count;
+    }
+
+    inline uint32_t       slot_count() const { return uint32_t(m_slots.size()); }
+    inline size_t         size() const { return m_size; }
+    inline uint64_t       consumed() const { return m_consumed; }
+    inline uint64_t       skipped_writes() const { return m_skipped_writes; }
+    inline Backend&       backend() { return m_backend; }
+    inline const Backend& backend() const { return m_backend; }
+
+private:
+    struct Slot
+    {
+        typename Backend::Buffer buffer;
+        typename Backend::Fence  fence;
+        Payload                  payload;
+        bool                     in_flight = false;
+        uint64_t                 sequence  = 0;
+    };
+
+private:
+    Backend           m_backend;
+    std::vector<Slot> m_slots;
+    size_t            m_size;
+    uint32_t          m_write_index    = 0;
+    uint64_t          m_next_sequence  = 0;
+    uint64_t          m_consumed       = 0;
+    uint64_t          m_skipped_writes = 0;
+};
@@ -0,0 +1,364 @@
+#include "render_graph.h"
+#include <algorithm>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool same_texture_desc(const TextureDesc& a, const TextureDesc& b)
+{
+    return a.internal_format == b.internal_format && a.width == b.width && a.height == b.height && a.array_size == b.array_size && a.mip_levels == b.mip_levels;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void add_unique(std::vector<uint32_t>& list, uint32_t value)
+{
+    if (std::find(list.begin(), list.end(), value) == list.end())
+        list.push_back(value);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t RenderGraph::create_texture(const std::string& name, const TextureDesc& desc)
+{
+    return add_resource(name, desc, true, false);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t RenderGraph::import_texture(const std::string& name, const TextureDesc& desc)
+{
+    return add_resource(name, desc, true, true);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t RenderGraph::import_buffer(const std::string& name)
+{
+    return add_resource(name, TextureDesc(), false, true);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t RenderGraph::add_pass(const std::string& name, std::function<void()> execute, bool side_effects)
+{
+    Pass pass;
+
+    pass.name         = name;
+    pass.execute      = execute;
+    pass.side_effects = side_effects;
+
+    m_passes.push_back(pass);
+
+    return uint32_t(m_passes.size() - 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::read(uint32_t pass, uint32_t resource)
+{
+    add_unique(m_passes[pass].reads, resource);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::write(uint32_t pass, uint32_t resource)
+{
+    add_unique(m_passes[pass].writes, resource);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool RenderGraph::compile()
+{
+    m_error.clear();
+
+    build_dependencies();
+
+    if (!m_error.empty())
+        return false;
+
+    cull();
+    schedule();
+    assign_slots();
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::execute()
+{
+    for (auto pass : m_order)
+    {
+        if (m_passes[pass].execute)
+            m_passes[pass].execute();
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::clear()
+{
+    m_passes.clear();
+    m_resources.clear();
+    m_slots.clear();
+    m_order.clear();
+    m_error.clear();
+
+    m_stats = RenderGraphStats();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t RenderGraph::add_resource(const std::string& name, const TextureDesc& desc, bool texture, bool imported)
+{
+    Resource resource;
+
+    resource.name     = name;
+    resource.desc     = desc;
+    resource.texture  = texture;
+    resource.imported = imported;
+
+    m_resources.push_back(resource);
+
+    return uint32_t(m_resources.size() - 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::build_dependencies()
+{
+    std::vector<uint32_t>              last_writer(m_resources.size(), RENDER_GRAPH_INVALID);
+    std::vector<std::vector<uint32_t>> readers(m_resources.size());
+
+    for (uint32_t i = 0; i < m_passes.size(); i++)
+    {
+        Pass& pass = m_passes[i];
+
+        pass.producers.clear();
+        pass.dependencies.clear();
+
+        for (auto resource : pass.reads)
+        {
+            uint32_t writer = last_writer[resource];
+
+            if (writer != RENDER_GRAPH_INVALID)
+            {
+                add_unique(pass.producers, writer);
+                add_unique(pass.dependencies, writer);
+            }
+            else if (!m_resources[resource].imported && std::find(pass.writes.begin(), pass.writes.end(), resource) == pass.writes.end())
+            {
+                m_error = "'" + pass.name + "' reads '" + m_resources[resource].name + "' before any pass writes it";
+                return;
+            }
+        }
+
+        // A write has to wait for the previous write and for everything that read it, or those reads would see this one.
+        for (auto resource : pass.writes)
+        {
+            if (last_writer[resource] != RENDER_GRAPH_INVALID)
+                add_unique(pass.dependencies, last_writer[resource]);
+
+            for (auto reader : readers[resource])
+            {
+                if (reader != i)
+                    add_unique(pass.dependencies, reader);
+            }
+
+            last_writer[resource] = i;
+            readers[resource].clear();
+        }
+
+        for (auto resource : pass.reads)
+            readers[resource].push_back(i);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::cull()
+{
+    std::vector<uint32_t> stack;
+
+    for (uint32_t i = 0; i < m_passes.size(); i++)
+    {
+        Pass& pass = m_passes[i];
+
+        pass.culled = true;
+
+        bool persistent = pass.side_effects;
+
+        for (auto resource : pass.writes)
+            persistent = persistent || m_resources[resource].imported;
+
+        if (persistent)
+            stack.push_back(i);
+    }
+
+    // Only reads keep a pass alive. A pass whose writes are overwritten before anything reads them contributes nothing.
+    while (!stack.empty())
+    {
+        Pass& pass = m_passes[stack.back()];
+        stack.pop_back();
+
+        if (!pass.culled)
+            continue;
+
+        pass.culled = false;
+
+        for (auto producer : pass.producers)
+            stack.push_back(producer);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::schedule()
+{
+    std::vector<uint32_t> pending(m_passes.size(), 0);
+    std::vector<bool>     written(m_resources.size(), false);
+
+    m_order.clear();
+
+    for (uint32_t i = 0; i < m_passes.size(); i++)
+    {
+        if (m_passes[i].culled)
+            continue;
+
+        for (auto dependency : m_passes[i].dependencies)
+        {
+            if (!m_passes[dependency].culled)
+                pending[i]++;
+        }
+    }
+
+    std::vector<uint32_t> ready;
+
+    for (uint32_t i = 0; i < m_passes.size(); i++)
+    {
+        if (!m_passes[i].culled && pending[i] == 0)
+            ready.push_back(i);
+    }
+
+    while (!ready.empty())
+    {
+        // Ready passes are kept in declaration order, so the first one is the default.
+        size_t pick = 0;
+
+        for (size_t i = 0; i < ready.size(); i++)
+        {
+            const Pass& pass = m_passes[ready[i]];
+
+            bool reads_live = std::any_of(pass.reads.begin(), pass.reads.end(), [&](uint32_t resource) { return !m_resources[resource].imported && written[resource]; });
+
+            if (reads_live)
+            {
+                pick = i;
+                break;
+            }
+        }
+
+        uint32_t index = ready[pick];
+        ready.erase(ready.begin() + pick);
+
+        m_order.push_back(index);
+
+        for (auto resource : m_passes[index].writes)
+            written[resource] = true;
+
+        for (uint32_t i = 0; i < m_passes.size(); i++)
+        {
+            const Pass& pass = m_passes[i];
+
+            if (pass.culled || std::find(pass.dependencies.begin(), pass.dependencies.end(), index) == pass.dependencies.end())
+                continue;
+
+            if (--pending[i] == 0)
+                ready.insert(std::upper_bound(ready.begin(), ready.end(), i), i);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::assign_slots()
+{
+    for (auto& resource : m_resources)
+    {
+        resource.first_use = RENDER_GRAPH_INVALID;
+        resource.last_use  = RENDER_GRAPH_INVALID;
+        resource.slot      = RENDER_GRAPH_INVALID;
+    }
+
+    for (uint32_t i = 0; i < m_order.size(); i++)
+    {
+        const Pass& pass = m_passes[m_order[i]];
+
+        for (const std::vector<uint32_t>* list : { &pass.reads, &pass.writes })
+        {
+            for (auto index : *list)
+            {
+                Resource& resource = m_resources[index];
+
+                resource.first_use = std::min(resource.first_use, i);
+                resource.last_use  = resource.last_use == RENDER_GRAPH_INVALID ? i : std::max(resource.last_use, i);
+            }
+        }
+    }
+
+    std::vector<uint32_t> transients;
+
+    for (uint32_t i = 0; i < m_resources.size(); i++)
+    {
+        if (!m_resources[i].imported && m_resources[i].first_use != RENDER_GRAPH_INVALID)
+            transients.push_back(i);
+    }
+
+    std::stable_sort(transients.begin(), transients.end(), [&](uint32_t a, uint32_t b) { return m_resources[a].first_use < m_resources[b].first_use; });
+
+    m_slots.clear();
+    m_stats = RenderGraphStats();
+
+    // A texture takes over the first slot of the same description whose last user has already run. GL can't place textures of
+    // different formats in the same memory, so only identical descriptions share.
+    for (auto index : transients)
+    {
+        Resource& resource = m_resources[index];
+
+        for (uint32_t i = 0; i < m_slots.size(); i++)
+        {
+            if (m_slots[i].last_use < resource.first_use && same_texture_desc(m_slots[i].desc, resource.desc))
+            {
+                resource.slot = i;
+                break;
+            }
+        }
+
+        if (resource.slot == RENDER_GRAPH_INVALID)
+        {
+            resource.slot = uint32_t(m_slots.size());
+            m_slots.push_back({ resource.desc, resource.last_use });
+
+            m_stats.allocated_bytes += texture_bytes(resource.desc);
+        }
+        else
+            m_slots[resource.slot].last_use = resource.last_use;
+
+        m_stats.transient_bytes += texture_bytes(resource.desc);
+    }
+
+    m_stats.passes             = uint32_t(m_passes.size());
+    m_stats.culled_passes      = uint32_t(m_passes.size() - m_order.size());
+    m_stats.resources          = uint32_t(m_resources.size());
+    m_stats.transient_textures = uint32_t(transients.size());
+    m_stats.physical_slots     = uint32_t(m_slots.size());
+
+    for (auto& resource : m_resources)
+    {
+        if (resource.first_use == RENDER_GRAPH_INVALID)
+            m_stats.culled_resources++;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
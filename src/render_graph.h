@@ -0,0 +1,110 @@
+#pragma once
+
+#include "gpu_memory.h"
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+const uint32_t RENDER_GRAPH_INVALID = UINT32_MAX;
+
+// Textures with identical descriptions are interchangeable, which is what lets transients share a physical slot.
+bool same_texture_desc(const TextureDesc& a, const TextureDesc& b);
+
+struct RenderGraphStats
+{
+    uint32_t passes             = 0;
+    uint32_t culled_passes      = 0;
+    uint32_t resources          = 0;
+    uint32_t culled_resources   = 0;
+    uint32_t transient_textures = 0;
+    uint32_t physical_slots     = 0;
+    uint64_t transient_bytes    = 0; // What the transient textures would take on their own.
+    uint64_t allocated_bytes    = 0; // What their physical slots take.
+};
+
+// The passes of a frame and the textures they read and write. Compiling works out which passes actually contribute, the order they
+// run in, how long each transient texture lives and which transients can share memory. Holds no GL objects: transients are mapped to
+// physical slot indices and the caller backs every slot with a texture of that slot's description.
+class RenderGraph
+{
+public:
+    // Transient textures live for part of a frame, from the first pass that uses them to the last. Imported ones belong to the caller
+    // and outlive the frame, so passes writing them are never culled.
+    uint32_t create_texture(const std::string& name, const TextureDesc& desc);
+    uint32_t import_texture(const std::string& name, const TextureDesc& desc);
+
+    // Buffers aren't aliased, importing one just orders the passes that share it.
+    uint32_t import_buffer(const std::string& name);
+
+    // Passes with side effects outside the graph, e.g. presenting or a readback, are never culled.
+    uint32_t add_pass(const std::string& name, std::function<void()> execute, bool side_effects = false);
+    void     read(uint32_t pass, uint32_t resource);
+    void     write(uint32_t pass, uint32_t resource);
+
+    // Passes keep their declaration order unless they don't depend on each other, then a pass that reads an already written transient
+    // goes first so its lifetime ends sooner. Returns false if a transient is read before any pass writes it.
+    bool compile();
+    void execute();
+    void clear();
+
+    inline const std::vector<uint32_t>& order() const { return m_order; }
+    inline const RenderGraphStats&      stats() const { return m_stats; }
+    inline const std::string&           error() const { return m_error; }
+    inline const std::string&           pass_name(uint32_t pass) const { return m_passes[pass].name; }
+    inline const std::string&           resource_name(uint32_t resource) const { return m_resources[resource].name; }
+    inline bool                         is_culled(uint32_t pass) const { return m_passes[pass].culled; }
+
+    // Positions in order() of the first and last pass using a resource, RENDER_GRAPH_INVALID for culled ones.
+    inline uint32_t first_use(uint32_t resource) const { return m_resources[resource].first_use; }
+    inline uint32_t last_use(uint32_t resource) const { return m_resources[resource].last_use; }
+
+    // Physical slot of a transient texture, RENDER_GRAPH_INVALID for imported or culled resources.
+    inline uint32_t           physical_slot(uint32_t resource) const { return m_resources[resource].slot; }
+    inline uint32_t           slot_count() const { return uint32_t(m_slots.size()); }
+    inline const TextureDesc& slot_desc(uint32_t slot) const { return m_slots[slot].desc; }
+
+private:
+    struct Pass
+    {
+        std::string           name;
+        std::function<void()> execute;
+        std::vector<uint32_t> reads;
+        std::vector<uint32_t> writes;
+        std::vector<uint32_t> producers;    // Passes whose writes this one reads.
+        std::vector<uint32_t> dependencies; // Every pass that has to run before this one.
+        bool                  side_effects = false;
+        bool                  culled       = false;
+    };
+
+    struct Resource
+    {
+        std::string name;
+        TextureDesc desc;
+        bool        texture   = true;
+        bool        imported  = false;
+        uint32_t    first_use = RENDER_GRAPH_INVALID;
+        uint32_t    last_use  = RENDER_GRAPH_INVALID;
+        uint32_t    slot      = RENDER_GRAPH_INVALID;
+    };
+
+    struct Slot
+    {
+        TextureDesc desc;
+        uint32_t    last_use;
+    };
+
+    uint32_t add_resource(const std::string& name, const TextureDesc& desc, bool texture, bool imported);
+    void     build_dependencies();
+    void     cull();
+    void     schedule();
+    void     assign_slots();
+
+private:
+    std::vector<Pass>     m_passes;
+    std::vector<Resource> m_resources;
+    std::vector<Slot>     m_slots;
+    std::vector<uint32_t> m_order;
+    RenderGraphStats      m_stats;
+    std::string           m_error;
+};
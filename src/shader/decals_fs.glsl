@@ -1,9 +1,27 @@
+// ------------------------------------------------------------------
+// DEFINES ----------------------------------------------------------
+// ------------------------------------------------------------------
+
+#ifdef PACKED_G_BUFFER
+#    define G_BUFFER_NORMAL vec2
+#    define ENCODE_NORMAL(n) octahedral_encode(n)
+#    define DECODE_NORMAL(t) octahedral_decode(t.xy)
+#else
+#    define G_BUFFER_NORMAL vec3
+#    define ENCODE_NORMAL(n) (n)
+#    define DECODE_NORMAL(t) (t.xyz)
+#endif
+
 // ------------------------------------------------------------------
 // OUTPUT VARIABLES  ------------------------------------------------
 // ------------------------------------------------------------------
 
 layout(location = 0) out vec3 FS_OUT_Albedo;
-layout(location = 1) out vec3 FS_OUT_Normal;
+
+// Albedo-only variants leave the normal target masked off.
+#ifdef NORMAL_MAP
+layout(location = 1) out G_BUFFER_NORMAL FS_OUT_Normal;
+#endif
 
 // ------------------------------------------------------------------
 // INPUT VARIABLES  ------------------------------------------------
@@ -24,10 +42,21 @@ layout(std140) uniform GlobalUniforms
 
 uniform sampler2D s_Depth;
 uniform sampler2D s_Decal;
+
+#ifdef NORMAL_MAP
 uniform sampler2D s_DecalNormal;
+#    ifdef VISIBILITY_BUFFER
+// The visibility buffer keeps no surface frame, so it is rebuilt from the triangle under the pixel.
+uniform usampler2D     s_Visibility;
+uniform samplerBuffer  s_Vertices;
+uniform usamplerBuffer s_Indices;
+uniform samplerBuffer  s_InstanceTransforms;
+#    else
 uniform sampler2D s_SourceNormal;
 uniform sampler2D s_Tangent;
 uniform sampler2D s_Bitangent;
+#    endif
+#endif
 
 uniform vec4 u_DecalOverlayColor;
 uniform mat4 u_DecalVP;
@@ -62,9 +91,10 @@ vec3 get_normal_from_map(vec3 tangent, vec3 bitangent, vec3 normal, vec2 tex_coo
     // Create TBN matrix.
     mat3 TBN = mat3(normalize(tangent), normalize(bitangent), normalize(normal));
 
-    // Sample tangent space normal vector from normal map and remap it from [0, 1] to [-1, 1] range.
-    vec3 n = texture(normal_map, tex_coord).xyz;
-    n      = normalize(n * 2.0 - 1.0);
+    // Sample tangent space normal vector from normal map and remap it from [0, 1] to [-1, 1] range. Z is rebuilt from XY so
+    // two channel BC5 normal maps work the same as RGB ones.
+    vec2 xy = texture(normal_map, tex_coord).xy * 2.0 - 1.0;
+    vec3 n  = normalize(vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0))));
 
     // Multiple vector by the TBN matrix to transform the normal from tangent space to world space.
     n = normalize(TBN * n);
@@ -72,6 +102,87 @@ vec3 get_normal_from_map(vec3 tangent, vec3 bitangent, vec3 normal, vec2 tex_coo
     return n;
 }
 
+// ------------------------------------------------------------------
+
+vec2 octahedral_encode(vec3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+
+    vec2 wrapped = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+
+    return n.z >= 0.0 ? n.xy : wrapped;
+}
+
+// ------------------------------------------------------------------
+
+vec3 octahedral_decode(vec2 e)
+{
+    vec3  n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+
+    return normalize(n);
+}
+
+#if defined(NORMAL_MAP) && defined(VISIBILITY_BUFFER)
+// Perspective correct barycentrics, compute_barycentrics() in visibility_resolve_fs.glsl without the derivatives.
+vec3 compute_barycentrics(vec4 clip0, vec4 clip1, vec4 clip2, vec2 ndc)
+{
+    vec3 inv_w = 1.0 / vec3(clip0.w, clip1.w, clip2.w);
+
+    vec2 ndc0 = clip0.xy * inv_w.x;
+    vec2 ndc1 = clip1.xy * inv_w.y;
+    vec2 ndc2 = clip2.xy * inv_w.z;
+
+    float inv_det = 1.0 / ((ndc2.x - ndc1.x) * (ndc0.y - ndc1.y) - (ndc2.y - ndc1.y) * (ndc0.x - ndc1.x));
+
+    vec3 ddx = vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * inv_det * inv_w;
+    vec3 ddy = vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * inv_det * inv_w;
+
+    vec2 delta  = ndc - ndc0;
+    vec3 lambda = vec3(inv_w.x, 0.0, 0.0) + delta.x * ddx + delta.y * ddy;
+
+    return lambda / dot(lambda, vec3(1.0));
+}
+
+// ------------------------------------------------------------------
+
+void surface_frame_from_visibility(out vec3 N, out vec3 T, out vec3 B)
+{
+    uvec2 id = texelFetch(s_Visibility, ivec2(gl_FragCoord.xy), 0).xy;
+
+    if (id.x == 0u)
+        discard;
+
+    int instance = int(id.x - 1u) * 4;
+    int triangle = int(id.y) * 3;
+
+    mat4 model = mat4(texelFetch(s_InstanceTransforms, instance),
+                      texelFetch(s_InstanceTransforms, instance + 1),
+                      texelFetch(s_InstanceTransforms, instance + 2),
+                      texelFetch(s_InstanceTransforms, instance + 3));
+
+    int v0 = int(texelFetch(s_Indices, triangle).x) * 4;
+    int v1 = int(texelFetch(s_Indices, triangle + 1).x) * 4;
+    int v2 = int(texelFetch(s_Indices, triangle + 2).x) * 4;
+
+    mat4 model_view_proj = view_proj * model;
+
+    vec2 ndc    = gl_FragCoord.xy / vec2(textureSize(s_Visibility, 0)) * 2.0 - 1.0;
+    vec3 lambda = compute_barycentrics(model_view_proj * vec4(texelFetch(s_Vertices, v0).xyz, 1.0), model_view_proj * vec4(texelFetch(s_Vertices, v1).xyz, 1.0), model_view_proj * vec4(texelFetch(s_Vertices, v2).xyz, 1.0), ndc);
+
+    mat3 normal_mat = mat3(model);
+
+    N = normalize(normal_mat * mat3(texelFetch(s_Vertices, v0 + 1).xyz, texelFetch(s_Vertices, v1 + 1).xyz, texelFetch(s_Vertices, v2 + 1).xyz) * lambda);
+    T = normalize(normal_mat * mat3(texelFetch(s_Vertices, v0 + 2).xyz, texelFetch(s_Vertices, v1 + 2).xyz, texelFetch(s_Vertices, v2 + 2).xyz) * lambda);
+    B = normalize(normal_mat * mat3(texelFetch(s_Vertices, v0 + 3).xyz, texelFetch(s_Vertices, v1 + 3).xyz, texelFetch(s_Vertices, v2 + 3).xyz) * lambda);
+}
+
+// ------------------------------------------------------------------
+#endif
+
 // ------------------------------------------------------------------
 // MAIN -------------------------------------------------------------
 // ------------------------------------------------------------------
@@ -97,15 +208,25 @@ void main()
 
     vec4 albedo = texture(s_Decal, decal_tex_coord) * u_DecalOverlayColor;
 
+#ifdef ALPHA_TEST
     if (albedo.a < 0.1)
         discard;
-
-    vec3 N = texture(s_SourceNormal, tex_coords).xyz;
-    vec3 T = texture(s_Tangent, tex_coords).xyz;
-    vec3 B = texture(s_Bitangent, tex_coords).xyz;
+#endif
 
     FS_OUT_Albedo = albedo.rgb;
-    FS_OUT_Normal = get_normal_from_map(T, B, N, decal_tex_coord, s_DecalNormal);
+
+#ifdef NORMAL_MAP
+#    ifdef VISIBILITY_BUFFER
+    vec3 N, T, B;
+    surface_frame_from_visibility(N, T, B);
+#    else
+    vec3 N = DECODE_NORMAL(texture(s_SourceNormal, tex_coords));
+    vec3 T = DECODE_NORMAL(texture(s_Tangent, tex_coords));
+    vec3 B = DECODE_NORMAL(texture(s_Bitangent, tex_coords));
+#    endif
+
+    FS_OUT_Normal = ENCODE_NORMAL(get_normal_from_map(T, B, N, decal_tex_coord, s_DecalNormal));
+#endif
 }
 
 // ------------------------------------------------------------------
@@ -1,3 +1,16 @@
+// ------------------------------------------------------------------
+// DEFINES  ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+#ifdef PACKED_G_BUFFER
+#    define DECODE_NORMAL(t) octahedral_decode(t.xy)
+#else
+#    define DECODE_NORMAL(t) (t.xyz)
+#endif
+
+#define LIGHT_TILE_SIZE 16
+#define LIGHT_TYPE_SPOT 1
+
 // ------------------------------------------------------------------
 // INPUT VARIABLES  -------------------------------------------------
 // ------------------------------------------------------------------
@@ -25,10 +38,75 @@ uniform sampler2D s_Depth;
 uniform sampler2D s_Normals;
 uniform sampler2D s_Albedo;
 
+// Four texels per light, see struct Light in light_culling.h.
+uniform samplerBuffer  s_Lights;
+uniform usamplerBuffer s_LightTiles;
+uniform usamplerBuffer s_LightIndices;
+
+uniform int u_TilesX;
+
 // ------------------------------------------------------------------
 // FUNCTIONS  -------------------------------------------------------
 // ------------------------------------------------------------------
 
+vec3 octahedral_decode(vec2 e)
+{
+    vec3  n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+
+    return normalize(n);
+}
+
+// ------------------------------------------------------------------
+
+vec3 world_position_from_depth(vec2 screen_pos, float ndc_depth)
+{
+    // Remap depth to [-1.0, 1.0] range.
+    float depth = ndc_depth * 2.0 - 1.0;
+
+    // Create NDC position.
+    vec4 ndc_pos = vec4(screen_pos, depth, 1.0);
+
+    // Transform back into world position.
+    vec4 world_pos = inv_view_proj * ndc_pos;
+
+    // Undo projection.
+    world_pos = world_pos / world_pos.w;
+
+    return world_pos.xyz;
+}
+
+// ------------------------------------------------------------------
+
+vec3 evaluate_light(int index, vec3 world_pos, vec3 normal, vec3 albedo)
+{
+    vec4 position_range  = texelFetch(s_Lights, index * 4);
+    vec4 color_intensity = texelFetch(s_Lights, index * 4 + 1);
+    vec4 direction_type  = texelFetch(s_Lights, index * 4 + 2);
+    vec4 spot_angles     = texelFetch(s_Lights, index * 4 + 3);
+
+    vec3  to_light = position_range.xyz - world_pos;
+    float dist     = length(to_light);
+
+    if (dist > position_range.w)
+        return vec3(0.0);
+
+    vec3 L = to_light / dist;
+
+    // Windowed inverse square falloff that reaches zero at the light range.
+    float ratio       = dist / position_range.w;
+    float window      = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    float attenuation = window * window / (dist * dist * 0.0001 + 1.0);
+
+    if (int(direction_type.w) == LIGHT_TYPE_SPOT)
+        attenuation *= smoothstep(spot_angles.y, spot_angles.x, dot(-L, direction_type.xyz));
+
+    return albedo * color_intensity.rgb * color_intensity.a * max(dot(normal, L), 0.0) * attenuation;
+}
+
 // ------------------------------------------------------------------
 // MAIN  ------------------------------------------------------------
 // ------------------------------------------------------------------
@@ -39,11 +117,23 @@ void main(void)
 {
     vec3 dir = normalize(vec3(0.0, 1.0, 1.0));
 
-    vec3 albedo = texture(s_Albedo, FS_IN_TexCoord).rgb;
-    vec3 normal = texture(s_Normals, FS_IN_TexCoord).rgb;
+    vec3  albedo = texture(s_Albedo, FS_IN_TexCoord).rgb;
+    vec3  normal = DECODE_NORMAL(texture(s_Normals, FS_IN_TexCoord));
+    float depth  = texture(s_Depth, FS_IN_TexCoord).r;
 
     vec3 color = albedo * max(dot(normal, dir), 0.0) + albedo * kAmbient;
 
+    if (depth < 1.0)
+    {
+        vec3 world_pos = world_position_from_depth(FS_IN_TexCoord * 2.0 - 1.0, depth);
+
+        ivec2 tile         = ivec2(gl_FragCoord.xy) / LIGHT_TILE_SIZE;
+        uvec2 offset_count = texelFetch(s_LightTiles, tile.y * u_TilesX + tile.x).xy;
+
+        for (uint i = 0; i < offset_count.y; i++)
+            color += evaluate_light(int(texelFetch(s_LightIndices, int(offset_count.x + i)).x), world_pos, normal, albedo);
+    }
+
     FS_OUT_Color = vec4(color, 1.0);
 }
 
@@ -1,12 +1,24 @@
+// ------------------------------------------------------------------
+// DEFINES ----------------------------------------------------------
+// ------------------------------------------------------------------
+
+#ifdef PACKED_G_BUFFER
+#    define G_BUFFER_NORMAL vec2
+#    define ENCODE_NORMAL(n) octahedral_encode(n)
+#else
+#    define G_BUFFER_NORMAL vec3
+#    define ENCODE_NORMAL(n) (n)
+#endif
+
 // ------------------------------------------------------------------
 // OUTPUT VARIABLES  ------------------------------------------------
 // ------------------------------------------------------------------
 
 layout(location = 0) out vec3 FS_OUT_Albedo;
-layout(location = 1) out vec3 FS_OUT_Normal;
-layout(location = 2) out vec3 FS_OUT_SrcNormal;
-layout(location = 3) out vec3 FS_OUT_Tangent;
-layout(location = 4) out vec3 FS_OUT_Bitangent;
+layout(location = 1) out G_BUFFER_NORMAL FS_OUT_Normal;
+layout(location = 2) out G_BUFFER_NORMAL FS_OUT_SrcNormal;
+layout(location = 3) out G_BUFFER_NORMAL FS_OUT_Tangent;
+layout(location = 4) out G_BUFFER_NORMAL FS_OUT_Bitangent;
 
 // ------------------------------------------------------------------
 // INPUT VARIABLES  -------------------------------------------------
@@ -22,10 +34,13 @@ in vec2 FS_IN_TexCoord;
 // ------------------------------------------------------------------
 
 uniform sampler2D s_Albedo;
+
+#ifdef NORMAL_MAP
 uniform sampler2D s_Normal;
+#endif
 
 // ------------------------------------------------------------------
-// MAIN -------------------------------------------------------------
+// FUNCTIONS --------------------------------------------------------
 // ------------------------------------------------------------------
 
 vec3 get_normal_from_map(vec3 tangent, vec3 bitangent, vec3 normal, vec2 tex_coord, sampler2D normal_map)
@@ -46,6 +61,21 @@ vec3 get_normal_from_map(vec3 tangent, vec3 bitangent, vec3 normal, vec2 tex_coo
     return n;
 }
 
+// ------------------------------------------------------------------
+
+vec2 octahedral_encode(vec3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+
+    vec2 wrapped = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+
+    return n.z >= 0.0 ? n.xy : wrapped;
+}
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
 void main()
 {
     vec4 diffuse = texture(s_Albedo, FS_IN_TexCoord);
@@ -54,11 +84,15 @@ void main()
     vec3 T = normalize(FS_IN_Tangent);
     vec3 B = normalize(FS_IN_Bitangent);
 
-    FS_OUT_Albedo    = diffuse.xyz;
-    FS_OUT_Normal    = get_normal_from_map(T, B, N, FS_IN_TexCoord, s_Normal);
-    FS_OUT_SrcNormal = N;
-    FS_OUT_Tangent   = T;
-    FS_OUT_Bitangent = B;
+    FS_OUT_Albedo = diffuse.xyz;
+#ifdef NORMAL_MAP
+    FS_OUT_Normal = ENCODE_NORMAL(get_normal_from_map(T, B, N, FS_IN_TexCoord, s_Normal));
+#else
+    FS_OUT_Normal = ENCODE_NORMAL(N);
+#endif
+    FS_OUT_SrcNormal = ENCODE_NORMAL(N);
+    FS_OUT_Tangent   = ENCODE_NORMAL(T);
+    FS_OUT_Bitangent = ENCODE_NORMAL(B);
 }
 
 // ------------------------------------------------------------------
@@ -28,7 +28,10 @@ layout(std140) uniform GlobalUniforms
     vec4 cam_pos;
 };
 
-uniform mat4 u_Model;
+// Four texels per instance transform, laid out mesh by mesh starting at u_BaseInstance.
+uniform samplerBuffer s_InstanceTransforms;
+
+uniform int u_BaseInstance;
 
 // ------------------------------------------------------------------
 // MAIN -------------------------------------------------------------
@@ -36,9 +39,16 @@ uniform mat4 u_Model;
 
 void main()
 {
-    vec4 world_pos = u_Model * vec4(VS_IN_Position, 1.0f);
+    int instance = (u_BaseInstance + gl_InstanceID) * 4;
+
+    mat4 model = mat4(texelFetch(s_InstanceTransforms, instance),
+                      texelFetch(s_InstanceTransforms, instance + 1),
+                      texelFetch(s_InstanceTransforms, instance + 2),
+                      texelFetch(s_InstanceTransforms, instance + 3));
+
+    vec4 world_pos = model * vec4(VS_IN_Position, 1.0f);
 
-    mat3 normal_mat = mat3(u_Model);
+    mat3 normal_mat = mat3(model);
 
     FS_IN_Normal    = normalize(normal_mat * VS_IN_Normal);
     FS_IN_Tangent   = normal_mat * VS_IN_Tangent;
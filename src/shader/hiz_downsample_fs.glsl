@@ -0,0 +1,47 @@
+// ------------------------------------------------------------------
+// OUTPUT VARIABLES  ------------------------------------------------
+// ------------------------------------------------------------------
+
+out vec2 FS_OUT_MinMax;
+
+// ------------------------------------------------------------------
+// UNIFORMS  --------------------------------------------------------
+// ------------------------------------------------------------------
+
+// Either the depth buffer or the previous pyramid level, restricted to a single level through GL_TEXTURE_BASE_LEVEL.
+uniform sampler2D s_Source;
+
+uniform ivec2 u_SourceSize;
+uniform int   u_FromDepth;
+
+// ------------------------------------------------------------------
+// MAIN  ------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main(void)
+{
+    ivec2 texel_coord = ivec2(gl_FragCoord.xy);
+    ivec2 dst_size    = max(u_SourceSize / 2, ivec2(1));
+    ivec2 coord       = texel_coord * 2;
+    vec2  result      = vec2(1.0, 0.0);
+
+    // Level sizes round down, so the last texel of a row or column also covers the odd texel left over. This matches
+    // downsample_min_max() in depth_pyramid.cpp.
+    int x_count = (texel_coord.x == dst_size.x - 1 && (u_SourceSize.x & 1) != 0) ? 3 : 2;
+    int y_count = (texel_coord.y == dst_size.y - 1 && (u_SourceSize.y & 1) != 0) ? 3 : 2;
+
+    for (int y = 0; y < y_count; y++)
+    {
+        for (int x = 0; x < x_count; x++)
+        {
+            vec4 texel = texelFetch(s_Source, min(coord + ivec2(x, y), u_SourceSize - 1), 0);
+            vec2 value = u_FromDepth != 0 ? texel.rr : texel.rg;
+
+            result = vec2(min(result.x, value.x), max(result.y, value.y));
+        }
+    }
+
+    FS_OUT_MinMax = result;
+}
+
+// ------------------------------------------------------------------
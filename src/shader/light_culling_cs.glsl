@@ -0,0 +1,164 @@
+// ------------------------------------------------------------------
+// DEFINES ----------------------------------------------------------
+// ------------------------------------------------------------------
+
+#define LIGHT_TILE_SIZE 16
+#define MAX_LIGHTS_PER_TILE 256
+
+// ------------------------------------------------------------------
+// INPUTS -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(local_size_x = LIGHT_TILE_SIZE, local_size_y = LIGHT_TILE_SIZE, local_size_z = 1) in;
+
+// ------------------------------------------------------------------
+// STRUCTURES -------------------------------------------------------
+// ------------------------------------------------------------------
+
+struct Light
+{
+    vec4 position_range;
+    vec4 color_intensity;
+    vec4 direction_type;
+    vec4 spot_angles;
+};
+
+// ------------------------------------------------------------------
+// UNIFORMS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(std430, binding = 0) readonly buffer LightBuffer
+{
+    Light lights[];
+};
+
+layout(std430, binding = 1) writeonly buffer LightTileBuffer
+{
+    uvec2 tiles[];
+};
+
+layout(std430, binding = 2) writeonly buffer LightIndexBuffer
+{
+    uint indices[];
+};
+
+uniform sampler2D s_Depth;
+
+uniform mat4  u_View;
+uniform mat4  u_Proj;
+uniform mat4  u_InvProj;
+uniform int   u_LightCount;
+uniform ivec2 u_ScreenSize;
+
+// ------------------------------------------------------------------
+// SHARED DATA ------------------------------------------------------
+// ------------------------------------------------------------------
+
+shared uint g_MinDepth;
+shared uint g_MaxDepth;
+shared uint g_LightCount;
+
+// ------------------------------------------------------------------
+// FUNCTIONS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+float linear_depth(float depth)
+{
+    vec4 p = u_InvProj * vec4(0.0, 0.0, depth * 2.0 - 1.0, 1.0);
+    return -p.z / p.w;
+}
+
+// ------------------------------------------------------------------
+
+// Same conservative bound as sphere_screen_rect() in light_culling.cpp.
+bool sphere_screen_rect(vec3 center, float radius, out vec4 rect)
+{
+    float near_plane = u_Proj[3][2] / (u_Proj[2][2] - 1.0);
+
+    rect = vec4(-1.0, -1.0, 1.0, 1.0);
+
+    if (center.z - radius > -near_plane)
+        return false;
+
+    if (center.z + radius > -near_plane)
+        return true;
+
+    // Seeded outside the screen, so a sphere that is off screen ends up outside it too.
+    rect = vec4(1e30, 1e30, -1e30, -1e30);
+
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = center + vec3((i & 1) != 0 ? radius : -radius, (i & 2) != 0 ? radius : -radius, (i & 4) != 0 ? radius : -radius);
+        vec4 clip   = u_Proj * vec4(corner, 1.0);
+        vec2 ndc    = clip.xy / clip.w;
+
+        rect.xy = min(rect.xy, ndc);
+        rect.zw = max(rect.zw, ndc);
+    }
+
+    return !(rect.z < -1.0 || rect.x > 1.0 || rect.w < -1.0 || rect.y > 1.0);
+}
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+    if (gl_LocalInvocationIndex == 0)
+    {
+        g_MinDepth   = 0xFFFFFFFF;
+        g_MaxDepth   = 0;
+        g_LightCount = 0;
+    }
+
+    barrier();
+
+    // Depth is always positive, so its bit pattern sorts like the value itself.
+    ivec2 coord = min(ivec2(gl_GlobalInvocationID.xy), u_ScreenSize - 1);
+    uint  depth = floatBitsToUint(texelFetch(s_Depth, coord, 0).r);
+
+    atomicMin(g_MinDepth, depth);
+    atomicMax(g_MaxDepth, depth);
+
+    barrier();
+
+    float min_distance = linear_depth(uintBitsToFloat(g_MinDepth));
+    float max_distance = linear_depth(uintBitsToFloat(g_MaxDepth));
+
+    vec2 tile_min = vec2(gl_WorkGroupID.xy * LIGHT_TILE_SIZE) / vec2(u_ScreenSize) * 2.0 - 1.0;
+    vec2 tile_max = vec2((gl_WorkGroupID.xy + 1) * LIGHT_TILE_SIZE) / vec2(u_ScreenSize) * 2.0 - 1.0;
+
+    uint tile   = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint offset = tile * MAX_LIGHTS_PER_TILE;
+
+    for (uint i = gl_LocalInvocationIndex; i < uint(u_LightCount); i += LIGHT_TILE_SIZE * LIGHT_TILE_SIZE)
+    {
+        vec3  center   = (u_View * vec4(lights[i].position_range.xyz, 1.0)).xyz;
+        float radius   = lights[i].position_range.w;
+        float distance = -center.z;
+
+        vec4 rect;
+
+        if (!sphere_screen_rect(center, radius, rect))
+            continue;
+
+        if (rect.z < tile_min.x || rect.x > tile_max.x || rect.w < tile_min.y || rect.y > tile_max.y)
+            continue;
+
+        if (distance + radius < min_distance || distance - radius > max_distance)
+            continue;
+
+        uint idx = atomicAdd(g_LightCount, 1);
+
+        if (idx < MAX_LIGHTS_PER_TILE)
+            indices[offset + idx] = i;
+    }
+
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0)
+        tiles[tile] = uvec2(offset, min(g_LightCount, uint(MAX_LIGHTS_PER_TILE)));
+}
+
+// ------------------------------------------------------------------
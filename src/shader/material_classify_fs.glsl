@@ -0,0 +1,30 @@
+// ------------------------------------------------------------------
+// DEFINES  ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+// Must match VISIBILITY_MAX_DRAWS in visibility_buffer.h.
+#define VISIBILITY_MAX_DRAWS 65536.0
+
+// ------------------------------------------------------------------
+// UNIFORMS  --------------------------------------------------------
+// ------------------------------------------------------------------
+
+uniform usampler2D     s_Visibility;
+uniform usamplerBuffer s_TriangleDraws;
+
+// ------------------------------------------------------------------
+// MAIN  ------------------------------------------------------------
+// ------------------------------------------------------------------
+
+// Writes the draw that covers each pixel as depth, so each resolve draw only runs on its own pixels through an early depth equal test.
+void main(void)
+{
+    uvec2 id = texelFetch(s_Visibility, ivec2(gl_FragCoord.xy), 0).xy;
+
+    if (id.x == 0u)
+        discard;
+
+    gl_FragDepth = float(texelFetch(s_TriangleDraws, int(id.y)).x + 1u) / VISIBILITY_MAX_DRAWS;
+}
+
+// ------------------------------------------------------------------
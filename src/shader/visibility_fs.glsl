@@ -0,0 +1,30 @@
+// ------------------------------------------------------------------
+// OUTPUT VARIABLES  ------------------------------------------------
+// ------------------------------------------------------------------
+
+// See encode_visibility_id() in visibility_buffer.h.
+layout(location = 0) out uvec2 FS_OUT_Id;
+
+// ------------------------------------------------------------------
+// INPUT VARIABLES  -------------------------------------------------
+// ------------------------------------------------------------------
+
+flat in uint FS_IN_Instance;
+
+// ------------------------------------------------------------------
+// UNIFORMS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+// First triangle of the submesh in the concatenated scene index buffer.
+uniform int u_BaseTriangle;
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+    FS_OUT_Id = uvec2(FS_IN_Instance + 1u, uint(u_BaseTriangle + gl_PrimitiveID));
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,186 @@
+// ------------------------------------------------------------------
+// DEFINES ----------------------------------------------------------
+// ------------------------------------------------------------------
+
+#ifdef PACKED_G_BUFFER
+#    define G_BUFFER_NORMAL vec2
+#    define ENCODE_NORMAL(n) octahedral_encode(n)
+#else
+#    define G_BUFFER_NORMAL vec3
+#    define ENCODE_NORMAL(n) (n)
+#endif
+
+// ------------------------------------------------------------------
+// OUTPUT VARIABLES  ------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(location = 0) out vec3 FS_OUT_Albedo;
+layout(location = 1) out G_BUFFER_NORMAL FS_OUT_Normal;
+
+// ------------------------------------------------------------------
+// UNIFORMS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(std140) uniform GlobalUniforms
+{
+    mat4 view_proj;
+    mat4 inv_view_proj;
+    vec4 cam_pos;
+};
+
+uniform usampler2D s_Visibility;
+
+// Four texels per vertex, see struct VisibilityVertex in visibility_buffer.h.
+uniform samplerBuffer  s_Vertices;
+uniform usamplerBuffer s_Indices;
+uniform samplerBuffer  s_InstanceTransforms;
+
+uniform sampler2D s_Albedo;
+
+#ifdef NORMAL_MAP
+uniform sampler2D s_Normal;
+#endif
+
+// ------------------------------------------------------------------
+// FUNCTIONS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+struct Barycentrics
+{
+    vec3 lambda;
+    vec3 ddx;
+    vec3 ddy;
+};
+
+// ------------------------------------------------------------------
+
+// GLSL twin of compute_barycentrics() in visibility_buffer.cpp.
+Barycentrics compute_barycentrics(vec4 clip0, vec4 clip1, vec4 clip2, vec2 ndc, vec2 screen_size)
+{
+    vec3 inv_w = 1.0 / vec3(clip0.w, clip1.w, clip2.w);
+
+    vec2 ndc0 = clip0.xy * inv_w.x;
+    vec2 ndc1 = clip1.xy * inv_w.y;
+    vec2 ndc2 = clip2.xy * inv_w.z;
+
+    float inv_det = 1.0 / ((ndc2.x - ndc1.x) * (ndc0.y - ndc1.y) - (ndc2.y - ndc1.y) * (ndc0.x - ndc1.x));
+
+    vec3 ddx = vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * inv_det * inv_w;
+    vec3 ddy = vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * inv_det * inv_w;
+
+    float ddx_sum = dot(ddx, vec3(1.0));
+    float ddy_sum = dot(ddy, vec3(1.0));
+
+    vec2  delta        = ndc - ndc0;
+    float interp_inv_w = inv_w.x + delta.x * ddx_sum + delta.y * ddy_sum;
+    float interp_w     = 1.0 / interp_inv_w;
+
+    Barycentrics result;
+
+    result.lambda = interp_w * vec3(inv_w.x + delta.x * ddx.x + delta.y * ddy.x,
+                                    delta.x * ddx.y + delta.y * ddy.y,
+                                    delta.x * ddx.z + delta.y * ddy.z);
+
+    // One pixel is 2 / size in NDC.
+    ddx *= 2.0 / screen_size.x;
+    ddy *= 2.0 / screen_size.y;
+    ddx_sum *= 2.0 / screen_size.x;
+    ddy_sum *= 2.0 / screen_size.y;
+
+    result.ddx = (result.lambda * interp_inv_w + ddx) / (interp_inv_w + ddx_sum) - result.lambda;
+    result.ddy = (result.lambda * interp_inv_w + ddy) / (interp_inv_w + ddy_sum) - result.lambda;
+
+    return result;
+}
+
+// ------------------------------------------------------------------
+
+vec3 get_normal_from_map(vec3 tangent, vec3 bitangent, vec3 normal, vec2 tex_coord, vec2 tex_coord_ddx, vec2 tex_coord_ddy, sampler2D normal_map)
+{
+    // Create TBN matrix.
+    mat3 TBN = mat3(normalize(tangent), normalize(bitangent), normalize(normal));
+
+    // Sample tangent space normal vector from normal map and remap it from [0, 1] to [-1, 1] range. There are no quad derivatives
+    // in a resolve, so the analytic ones pick the mip level.
+    vec3 n = textureGrad(normal_map, tex_coord, tex_coord_ddx, tex_coord_ddy).xyz;
+
+    n.y = 1.0 - n.y;
+
+    n = normalize(n * 2.0 - 1.0);
+
+    // Multiple vector by the TBN matrix to transform the normal from tangent space to world space.
+    n = normalize(TBN * n);
+
+    return n;
+}
+
+// ------------------------------------------------------------------
+
+vec2 octahedral_encode(vec3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+
+    vec2 wrapped = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+
+    return n.z >= 0.0 ? n.xy : wrapped;
+}
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+    // Only pixels classified to this draw get here, so the texel is never background.
+    uvec2 id = texelFetch(s_Visibility, ivec2(gl_FragCoord.xy), 0).xy;
+
+    int instance = int(id.x - 1u) * 4;
+    int triangle = int(id.y) * 3;
+
+    mat4 model = mat4(texelFetch(s_InstanceTransforms, instance),
+                      texelFetch(s_InstanceTransforms, instance + 1),
+                      texelFetch(s_InstanceTransforms, instance + 2),
+                      texelFetch(s_InstanceTransforms, instance + 3));
+
+    int v0 = int(texelFetch(s_Indices, triangle).x) * 4;
+    int v1 = int(texelFetch(s_Indices, triangle + 1).x) * 4;
+    int v2 = int(texelFetch(s_Indices, triangle + 2).x) * 4;
+
+    vec4 position_u0 = texelFetch(s_Vertices, v0);
+    vec4 position_u1 = texelFetch(s_Vertices, v1);
+    vec4 position_u2 = texelFetch(s_Vertices, v2);
+    vec4 normal_v0   = texelFetch(s_Vertices, v0 + 1);
+    vec4 normal_v1   = texelFetch(s_Vertices, v1 + 1);
+    vec4 normal_v2   = texelFetch(s_Vertices, v2 + 1);
+
+    mat4 model_view_proj = view_proj * model;
+
+    vec2 screen_size = vec2(textureSize(s_Visibility, 0));
+    vec2 ndc         = gl_FragCoord.xy / screen_size * 2.0 - 1.0;
+
+    Barycentrics b = compute_barycentrics(model_view_proj * vec4(position_u0.xyz, 1.0), model_view_proj * vec4(position_u1.xyz, 1.0), model_view_proj * vec4(position_u2.xyz, 1.0), ndc, screen_size);
+
+    mat3 uvs = mat3(vec3(position_u0.w, normal_v0.w, 0.0), vec3(position_u1.w, normal_v1.w, 0.0), vec3(position_u2.w, normal_v2.w, 0.0));
+
+    vec2 tex_coord     = (uvs * b.lambda).xy;
+    vec2 tex_coord_ddx = (uvs * b.ddx).xy;
+    vec2 tex_coord_ddy = (uvs * b.ddy).xy;
+
+    // Same normal matrix as g_buffer_vs.glsl.
+    mat3 normal_mat = mat3(model);
+
+    vec3 N = normalize(normal_mat * mat3(normal_v0.xyz, normal_v1.xyz, normal_v2.xyz) * b.lambda);
+
+    FS_OUT_Albedo = textureGrad(s_Albedo, tex_coord, tex_coord_ddx, tex_coord_ddy).xyz;
+
+#ifdef NORMAL_MAP
+    vec3 T = normalize(normal_mat * mat3(texelFetch(s_Vertices, v0 + 2).xyz, texelFetch(s_Vertices, v1 + 2).xyz, texelFetch(s_Vertices, v2 + 2).xyz) * b.lambda);
+    vec3 B = normalize(normal_mat * mat3(texelFetch(s_Vertices, v0 + 3).xyz, texelFetch(s_Vertices, v1 + 3).xyz, texelFetch(s_Vertices, v2 + 3).xyz) * b.lambda);
+
+    FS_OUT_Normal = ENCODE_NORMAL(get_normal_from_map(T, B, N, tex_coord, tex_coord_ddx, tex_coord_ddy, s_Normal));
+#else
+    FS_OUT_Normal = ENCODE_NORMAL(N);
+#endif
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,19 @@
+// ------------------------------------------------------------------
+// UNIFORMS  --------------------------------------------------------
+// ------------------------------------------------------------------
+
+// Depth material_classify_fs.glsl wrote for the draw being resolved.
+uniform float u_MaterialDepth;
+
+// ------------------------------------------------------------------
+// MAIN  ------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main(void)
+{
+    float x     = -1.0 + float((gl_VertexID & 1) << 2);
+    float y     = -1.0 + float((gl_VertexID & 2) << 1);
+    gl_Position = vec4(x, y, u_MaterialDepth * 2.0 - 1.0, 1.0);
+}
+
+// ------------------------------------------------------------------
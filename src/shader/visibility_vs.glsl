@@ -0,0 +1,47 @@
+// ------------------------------------------------------------------
+// INPUT VARIABLES --------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(location = 0) in vec3 VS_IN_Position;
+
+// ------------------------------------------------------------------
+// OUTPUT VARIABLES -------------------------------------------------
+// ------------------------------------------------------------------
+
+flat out uint FS_IN_Instance;
+
+// ------------------------------------------------------------------
+// UNIFORMS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(std140) uniform GlobalUniforms
+{
+    mat4 view_proj;
+    mat4 inv_view_proj;
+    vec4 cam_pos;
+};
+
+// Four texels per instance transform, laid out mesh by mesh starting at u_BaseInstance.
+uniform samplerBuffer s_InstanceTransforms;
+
+uniform int u_BaseInstance;
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+    int instance = u_BaseInstance + gl_InstanceID;
+
+    mat4 model = mat4(texelFetch(s_InstanceTransforms, instance * 4),
+                      texelFetch(s_InstanceTransforms, instance * 4 + 1),
+                      texelFetch(s_InstanceTransforms, instance * 4 + 2),
+                      texelFetch(s_InstanceTransforms, instance * 4 + 3));
+
+    FS_IN_Instance = uint(instance);
+
+    gl_Position = view_proj * model * vec4(VS_IN_Position, 1.0f);
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,521 @@
+#include "shader_cache.h"
+#include <logger.h>
+#include <GLFW/glfw3.h>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#    include <direct.h>
+#else
+#    include <sys/stat.h>
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#    define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#if defined(__APPLE__)
+#    define SHADER_VERSION_STRING "#version 410 core\n"
+#else
+#    define SHADER_VERSION_STRING "#version 430 core\n"
+#endif
+
+#define SHADER_CACHE_MAGIC 0x48435344 // 'DSCH'
+#define SHADER_CACHE_VERSION 1
+
+typedef void (*PFN_MaxShaderCompilerThreads)(GLuint count);
+
+struct ShaderCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t binary_format;
+    uint32_t binary_size;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool read_text(const std::string& path, std::string& out)
+{
+    std::ifstream file(path);
+
+    if (!file.is_open())
+        return false;
+
+    std::stringstream ss;
+    ss << file.rdbuf();
+    out = ss.str();
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool has_extension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+    for (GLint i = 0; i < count; i++)
+    {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+
+        if (ext && strcmp(ext, name) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void write_program_binary(GLuint program, const std::string& path)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum            format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    FILE* f = fopen(path.c_str(), "wb");
+
+    if (!f)
+    {
+        DW_LOG_WARNING("Failed to write shader cache entry: " + path);
+        return;
+    }
+
+    ShaderCacheHeader header = { SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, uint32_t(format), uint32_t(length) };
+
+    fwrite(&header, sizeof(ShaderCacheHeader), 1, f);
+    fwrite(binary.data(), length, 1, f);
+    fclose(f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static GLuint load_program_binary(const std::string& path)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+
+    if (!f)
+        return 0;
+
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    ShaderCacheHeader header;
+    std::vector<char> binary;
+
+    bool valid = fread(&header, sizeof(ShaderCacheHeader), 1, f) == 1 && header.magic == SHADER_CACHE_MAGIC && header.version == SHADER_CACHE_VERSION;
+
+    // A truncated or corrupt entry must not size the read, it is treated like a miss.
+    valid = valid && header.binary_size > 0 && file_size >= 0 && uint64_t(header.binary_size) == uint64_t(file_size) - sizeof(ShaderCacheHeader);
+
+    if (valid)
+    {
+        binary.resize(header.binary_size);
+        valid = fread(binary.data(), header.binary_size, 1, f) == 1;
+    }
+
+    fclose(f);
+
+    if (!valid)
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binary_format, binary.data(), header.binary_size);
+
+    // The driver rejects binaries produced by a different driver build, in which case we fall back to compiling from source.
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+
+    if (status != GL_TRUE)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t shader_hash(const std::string& text, uint64_t seed)
+{
+    // FNV-1a
+    uint64_t hash = seed;
+
+    for (char c : text)
+    {
+        hash ^= uint64_t(uint8_t(c));
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderProgram::ShaderProgram(GLuint program, std::vector<GLuint> shaders, std::string cache_path, bool pending) :
+    m_program(program), m_shaders(shaders), m_cache_path(cache_path), m_pending(pending)
+{
+    if (!m_pending)
+        finalize();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderProgram::~ShaderProgram()
+{
+    for (auto shader : m_shaders)
+        glDeleteShader(shader);
+
+    glDeleteProgram(m_program);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::is_ready()
+{
+    if (m_pending)
+    {
+        GLint complete = GL_FALSE;
+        glGetProgramiv(m_program, GL_COMPLETION_STATUS_KHR, &complete);
+
+        if (complete == GL_TRUE)
+        {
+            m_pending = false;
+            finalize();
+        }
+    }
+
+    return !m_pending && m_valid;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::is_valid()
+{
+    return m_valid;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ShaderProgram::use()
+{
+    glUseProgram(m_program);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ShaderProgram::uniform_block_binding(const std::string& name, int binding)
+{
+    // Bindings requested while the program is still linking are applied once it finishes.
+    if (m_pending)
+    {
+        m_block_bindings.push_back({ name, binding });
+        return;
+    }
+
+    GLuint idx = glGetUniformBlockIndex(m_program, name.c_str());
+
+    if (idx != GL_INVALID_INDEX)
+        glUniformBlockBinding(m_program, idx, binding);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, int value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glUniform1i(loc, value);
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, float value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glUniform1f(loc, value);
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, const glm::vec2& value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glUniform2f(loc, value.x, value.y);
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, const glm::ivec2& value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glUniform2i(loc, value.x, value.y);
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, const glm::vec3& value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glUniform3f(loc, value.x, value.y, value.z);
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, const glm::vec4& value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glUniform4f(loc, value.x, value.y, value.z, value.w);
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, const glm::mat4& value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glUniformMatrix4fv(loc, 1, GL_FALSE, &value[0][0]);
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+GLuint ShaderProgram::id()
+{
+    return m_program;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ShaderProgram::finalize()
+{
+    GLint status = GL_FALSE;
+    glGetProgramiv(m_program, GL_LINK_STATUS, &status);
+
+    if (status != GL_TRUE)
+    {
+        char log[2048];
+
+        for (auto shader : m_shaders)
+        {
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+
+            if (log[0] != '\0')
+                DW_LOG_ERROR(std::string("Shader compilation failed: ") + log);
+        }
+
+        glGetProgramInfoLog(m_program, sizeof(log), nullptr, log);
+        DW_LOG_ERROR(std::string("Program link failed: ") + log);
+
+        m_valid = false;
+    }
+    else if (!m_cache_path.empty())
+        write_program_binary(m_program, m_cache_path);
+
+    for (auto shader : m_shaders)
+    {
+        glDetachShader(m_program, shader);
+        glDeleteShader(shader);
+    }
+
+    m_shaders.clear();
+
+    if (m_valid)
+    {
+        for (auto& binding : m_block_bindings)
+        {
+            GLuint idx = glGetUniformBlockIndex(m_program, binding.first.c_str());
+
+            if (idx != GL_INVALID_INDEX)
+                glUniformBlockBinding(m_program, idx, binding.second);
+        }
+    }
+
+    m_block_bindings.clear();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+GLint ShaderProgram::location(const std::string& name)
+{
+    auto it = m_location_map.find(name);
+
+    if (it != m_location_map.end())
+        return it->second;
+
+    GLint loc            = glGetUniformLocation(m_program, name.c_str());
+    m_location_map[name] = loc;
+
+    return loc;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderCache::ShaderCache(const std::string& directory) :
+    m_directory(directory)
+{
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+
+    GLint num_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+
+    m_binary_supported = num_formats > 0;
+
+    // Binaries are only valid for the driver that produced them, so the driver identity is part of the cache key.
+    m_driver = std::string((const char*)glGetString(GL_VENDOR)) + (const char*)glGetString(GL_RENDERER) + (const char*)glGetString(GL_VERSION);
+
+    if (has_extension("GL_KHR_parallel_shader_compile"))
+    {
+        PFN_MaxShaderCompilerThreads max_threads = (PFN_MaxShaderCompilerThreads)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+
+        if (max_threads)
+        {
+            max_threads(0xFFFFFFFF);
+            m_parallel_supported = true;
+        }
+    }
+    else if (has_extension("GL_ARB_parallel_shader_compile"))
+    {
+        PFN_MaxShaderCompilerThreads max_threads = (PFN_MaxShaderCompilerThreads)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+
+        if (max_threads)
+        {
+            max_threads(0xFFFFFFFF);
+            m_parallel_supported = true;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::unique_ptr<ShaderProgram> ShaderCache::create(const std::string& name, const std::vector<ShaderStage>& stages, const std::vector<std::string>& defines, bool background)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::string prelude = SHADER_VERSION_STRING;
+
+    for (auto& define : defines)
+        prelude += "#define " + define + "\n";
+
+    std::vector<std::string> sources(stages.size());
+    uint64_t                 key = shader_hash(m_driver);
+
+    for (int i = 0; i < stages.size(); i++)
+    {
+        std::string body;
+
+        if (!read_text(stages[i].path, body))
+        {
+            DW_LOG_ERROR("Failed to read shader: " + stages[i].path);
+            return nullptr;
+        }
+
+        sources[i] = prelude + body;
+        key        = shader_hash(std::to_string(stages[i].type) + sources[i], key);
+    }
+
+    std::string cache_path;
+
+    if (m_binary_supported)
+    {
+        char key_str[17];
+        snprintf(key_str, sizeof(key_str), "%016llx", (unsigned long long)key);
+
+        cache_path = m_directory + "/" + name + "_" + key_str + ".bin";
+
+        GLuint program = load_program_binary(cache_path);
+
+        if (program)
+        {
+            m_stats.cache_hits++;
+            m_stats.total_time_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            return std::make_unique<ShaderProgram>(program, std::vector<GLuint>(), "", false);
+        }
+    }
+
+    m_stats.cache_misses++;
+
+    std::vector<GLuint> shaders(stages.size());
+    GLuint              program = glCreateProgram();
+
+    if (m_binary_supported)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    for (int i = 0; i < stages.size(); i++)
+    {
+        const GLchar* source = sources[i].c_str();
+
+        shaders[i] = glCreateShader(stages[i].type);
+        glShaderSource(shaders[i], 1, &source, nullptr);
+        glCompileShader(shaders[i]);
+        glAttachShader(program, shaders[i]);
+    }
+
+    glLinkProgram(program);
+
+    // Without the parallel compile extension querying the link status below blocks until the driver is done.
+    bool pending = background && m_parallel_supported;
+
+    if (pending)
+        m_stats.background++;
+
+    std::unique_ptr<ShaderProgram> result = std::make_unique<ShaderProgram>(program, shaders, cache_path, pending);
+
+    m_stats.total_time_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    if (!result->is_valid())
+        return nullptr;
+
+    return result;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
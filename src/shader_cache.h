@@ -0,0 +1,82 @@
+#pragma once
+
+#include <ogl.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+struct ShaderStage
+{
+    GLenum      type;
+    std::string path;
+};
+
+class ShaderProgram
+{
+public:
+    ShaderProgram(GLuint program, std::vector<GLuint> shaders, std::string cache_path, bool pending);
+    ~ShaderProgram();
+
+    // Owns the GL program, a copy would delete it twice.
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    // Returns false while a program compiled through GL_KHR_parallel_shader_compile is still linking.
+    bool   is_ready();
+    bool   is_valid();
+    void   use();
+    void   uniform_block_binding(const std::string& name, int binding);
+    bool   set_uniform(const std::string& name, int value);
+    bool   set_uniform(const std::string& name, float value);
+    bool   set_uniform(const std::string& name, const glm::vec2& value);
+    bool   set_uniform(const std::string& name, const glm::ivec2& value);
+    bool   set_uniform(const std::string& name, const glm::vec3& value);
+    bool   set_uniform(const std::string& name, const glm::vec4& value);
+    bool   set_uniform(const std::string& name, const glm::mat4& value);
+    GLuint id();
+
+private:
+    void  finalize();
+    GLint location(const std::string& name);
+
+private:
+    GLuint                                   m_program;
+    std::vector<GLuint>                      m_shaders;
+    std::string                              m_cache_path;
+    bool                                     m_pending;
+    bool                                     m_valid = true;
+    std::vector<std::pair<std::string, int>> m_block_bindings;
+    std::unordered_map<std::string, GLint>   m_location_map;
+};
+
+struct ShaderCacheStats
+{
+    uint32_t cache_hits    = 0;
+    uint32_t cache_misses  = 0;
+    uint32_t background    = 0;
+    double   total_time_ms = 0.0;
+};
+
+class ShaderCache
+{
+public:
+    ShaderCache(const std::string& directory);
+
+    // Loads the program binary matching the source and driver hash, or compiles and links from source on a miss. Programs
+    // created with background = true are linked asynchronously when GL_KHR_parallel_shader_compile is available.
+    std::unique_ptr<ShaderProgram> create(const std::string& name, const std::vector<ShaderStage>& stages, const std::vector<std::string>& defines = {}, bool background = false);
+
+    inline bool                    binary_supported() { return m_binary_supported; }
+    inline bool                    parallel_supported() { return m_parallel_supported; }
+    inline const ShaderCacheStats& stats() { return m_stats; }
+
+private:
+    std::string      m_directory;
+    std::string      m_driver;
+    bool             m_binary_supported   = false;
+    bool             m_parallel_supported = false;
+    ShaderCacheStats m_stats;
+};
+
+uint64_t shader_hash(const std::string& text, uint64_t seed = 14695981039346656037ull);
@@ -0,0 +1,84 @@
+#include "shader_permutation.h"
+#include <logger.h>
+
+static const char* kPermutationDefines[] = { "NORMAL_MAP", "ALPHA_TEST", "PACKED_G_BUFFER", "VISIBILITY_BUFFER" };
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<std::string> permutation_defines(uint32_t flags)
+{
+    std::vector<std::string> defines;
+
+    for (int i = 0; i < sizeof(kPermutationDefines) / sizeof(kPermutationDefines[0]); i++)
+    {
+        if (flags & (1 << i))
+            defines.push_back(kPermutationDefines[i]);
+    }
+
+    return defines;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::string permutation_name(uint32_t flags)
+{
+    std::string name;
+
+    for (auto& define : permutation_defines(flags))
+        name += (name.empty() ? "" : "|") + define;
+
+    return name.empty() ? "BASE" : name;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderPermutations::ShaderPermutations(ShaderCache* cache, const std::string& name, const std::vector<ShaderStage>& stages, uint32_t supported_flags, bool background) :
+    m_cache(cache), m_name(name), m_stages(stages), m_supported_flags(supported_flags), m_background(background)
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderPermutations::prepare(uint32_t flags)
+{
+    return get(flags) != nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderProgram* ShaderPermutations::get(uint32_t flags)
+{
+    uint32_t k  = key(flags);
+    auto     it = m_programs.find(k);
+
+    if (it != m_programs.end())
+        return it->second.get();
+
+    if (m_failed.count(k) > 0)
+        return nullptr;
+
+    std::unique_ptr<ShaderProgram> program = m_cache->create(m_name + "_" + std::to_string(k), m_stages, permutation_defines(k), m_background);
+
+    if (!program)
+    {
+        DW_LOG_ERROR("Failed to create permutation " + permutation_name(k) + " of " + m_name);
+        m_failed.insert(k);
+        return nullptr;
+    }
+
+    program->uniform_block_binding("GlobalUniforms", 0);
+
+    ShaderProgram* ptr = program.get();
+    m_programs[k]      = std::move(program);
+
+    return ptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t ShaderPermutations::key(uint32_t flags)
+{
+    return flags & m_supported_flags;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "shader_cache.h"
+#include "shader_permutation_flags.h"
+#include <map>
+#include <set>
+
+std::vector<std::string> permutation_defines(uint32_t flags);
+std::string              permutation_name(uint32_t flags);
+
+// Compiles #define-specialized variants of a program on demand. Only the flags a program declares as supported take part in the
+// key, so requesting a flag a shader doesn't use maps to an already compiled variant instead of producing a duplicate.
+class ShaderPermutations
+{
+public:
+    ShaderPermutations(ShaderCache* cache, const std::string& name, const std::vector<ShaderStage>& stages, uint32_t supported_flags, bool background = false);
+
+    // Compiles the variant ahead of time so the first frame that uses it doesn't stall.
+    bool prepare(uint32_t flags);
+
+    // Returns nullptr if the variant failed to compile. Failures are remembered, so a broken variant isn't recompiled every frame.
+    ShaderProgram* get(uint32_t flags);
+    uint32_t       key(uint32_t flags);
+
+    inline uint32_t compiled_count() { return uint32_t(m_programs.size()); }
+
+private:
+    ShaderCache*                                       m_cache;
+    std::string                                        m_name;
+    std::vector<ShaderStage>                           m_stages;
+    uint32_t                                           m_supported_flags;
+    bool                                               m_background;
+    std::map<uint32_t, std::unique_ptr<ShaderProgram>> m_programs;
+    std::set<uint32_t>                                 m_failed;
+};
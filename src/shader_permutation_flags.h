@@ -0,0 +1,13 @@
+#pragma once
+
+// Kept apart from ShaderPermutations so code that only computes keys doesn't depend on GL.
+enum ShaderPermutationFlags
+{
+    PERMUTATION_NORMAL_MAP        = 1 << 0,
+    PERMUTATION_ALPHA_TEST        = 1 << 1,
+    PERMUTATION_PACKED_G_BUFFER   = 1 << 2,
+    PERMUTATION_VISIBILITY_BUFFER = 1 << 3
+};
+
+// Flags that follow renderer settings rather than what is being drawn.
+#define PERMUTATION_GLOBAL_FLAGS (PERMUTATION_PACKED_G_BUFFER | PERMUTATION_VISIBILITY_BUFFER)
@@ -0,0 +1,257 @@
+#include "task_graph.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t TaskGraph::add_task(const std::string& name, TaskAffinity affinity, std::function<bool()> function, const std::vector<uint32_t>& dependencies)
+{
+    uint32_t index = uint32_t(m_tasks.size());
+
+    Task task;
+
+    task.name         = name;
+    task.affinity     = affinity;
+    task.function     = function;
+    task.dependencies = dependencies;
+
+    for (auto dependency : dependencies)
+        m_tasks[dependency].dependents.push_back(index);
+
+    m_tasks.push_back(task);
+
+    return index;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool TaskGraph::run(uint32_t worker_count)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    if (worker_count == 0)
+        worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    uint32_t worker_tasks = uint32_t(std::count_if(m_tasks.begin(), m_tasks.end(), [](const Task& task) { return task.affinity == TASK_AFFINITY_WORKER; }));
+
+    worker_count = std::min(worker_count, worker_tasks);
+
+    std::mutex              mutex;
+    std::condition_variable main_wake;
+    std::condition_variable worker_wake;
+    std::vector<uint32_t>   pending(m_tasks.size());
+    std::vector<uint32_t>   main_ready;
+    std::deque<uint32_t>    worker_ready;
+    uint32_t                remaining = uint32_t(m_tasks.size());
+    uint32_t                running   = 0;
+    bool                    failed    = false;
+    bool                    quit      = false;
+    Clock::time_point       start     = Clock::now();
+
+    auto elapsed_ms = [&]() { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+    auto make_ready = [&](uint32_t index) {
+        if (m_tasks[index].affinity == TASK_AFFINITY_MAIN_THREAD)
+            main_ready.insert(std::upper_bound(main_ready.begin(), main_ready.end(), index), index);
+        else
+            worker_ready.push_back(index);
+    };
+
+    // Called with the lock held. Anything that became ready wakes both sides, either may be waiting on it.
+    auto complete = [&](uint32_t index, bool success) {
+        Task& task = m_tasks[index];
+
+        task.timing.end_ms = elapsed_ms();
+        task.timing.ran    = true;
+
+        remaining--;
+        running--;
+
+        if (!success)
+            failed = true;
+
+        for (auto dependent : task.dependents)
+        {
+            if (--pending[dependent] == 0)
+                make_ready(dependent);
+        }
+
+        main_wake.notify_one();
+        worker_wake.notify_all();
+    };
+
+    // Executes a task with the lock released.
+    auto execute = [&](std::unique_lock<std::mutex>& lock, uint32_t index, uint32_t thread) {
+        Task& task = m_tasks[index];
+
+        running++;
+        task.timing.start_ms = elapsed_ms();
+        task.timing.thread   = thread;
+
+        lock.unlock();
+        bool success = task.function();
+        lock.lock();
+
+        complete(index, success);
+    };
+
+    for (uint32_t i = 0; i < m_tasks.size(); i++)
+    {
+        m_tasks[i].timing = TaskTiming();
+        pending[i]        = uint32_t(m_tasks[i].dependencies.size());
+
+        if (pending[i] == 0)
+            make_ready(i);
+    }
+
+    std::vector<std::thread> workers;
+
+    for (uint32_t i = 0; i < worker_count; i++)
+    {
+        workers.push_back(std::thread([&, i]() {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (true)
+            {
+                worker_wake.wait(lock, [&]() { return quit || failed || !worker_ready.empty(); });
+
+                if (quit || failed)
+                    break;
+
+                uint32_t index = worker_ready.front();
+                worker_ready.pop_front();
+
+                execute(lock, index, i + 1);
+            }
+        }));
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (remaining > 0 && !(failed && running == 0))
+        {
+            if (!failed && !main_ready.empty())
+            {
+                uint32_t index = main_ready.front();
+                main_ready.erase(main_ready.begin());
+
+                execute(lock, index, 0);
+            }
+            else
+                main_wake.wait(lock);
+        }
+
+        quit = true;
+        worker_wake.notify_all();
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+
+    m_wall_ms = elapsed_ms();
+
+    return !failed;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<uint32_t> TaskGraph::critical_path() const
+{
+    std::vector<double>   finish(m_tasks.size(), 0.0);
+    std::vector<uint32_t> previous(m_tasks.size(), UINT32_MAX);
+    uint32_t              last = UINT32_MAX;
+
+    // Dependencies always come first, so one pass in order sees every chain.
+    for (uint32_t i = 0; i < m_tasks.size(); i++)
+    {
+        const Task& task = m_tasks[i];
+
+        for (auto dependency : task.dependencies)
+        {
+            if (finish[dependency] > finish[i])
+            {
+                finish[i]   = finish[dependency];
+                previous[i] = dependency;
+            }
+        }
+
+        finish[i] += task.timing.end_ms - task.timing.start_ms;
+
+        if (last == UINT32_MAX || finish[i] > finish[last])
+            last = i;
+    }
+
+    std::vector<uint32_t> path;
+
+    for (uint32_t i = last; i != UINT32_MAX; i = previous[i])
+        path.push_back(i);
+
+    std::reverse(path.begin(), path.end());
+
+    return path;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+double TaskGraph::critical_path_ms() const
+{
+    double total = 0.0;
+
+    for (auto task : critical_path())
+        total += m_tasks[task].timing.end_ms - m_tasks[task].timing.start_ms;
+
+    return total;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+double TaskGraph::task_ms() const
+{
+    double total = 0.0;
+
+    for (auto& task : m_tasks)
+        total += task.timing.end_ms - task.timing.start_ms;
+
+    return total;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::string TaskGraph::report() const
+{
+    std::string path;
+
+    for (auto task : critical_path())
+        path += (path.empty() ? "" : " > ") + m_tasks[task].name;
+
+    char line[256];
+
+    snprintf(line, sizeof(line), "%.2f ms wall, %.2f ms of tasks, critical path %.2f ms: ", m_wall_ms, task_ms(), critical_path_ms());
+
+    std::string report = line + path;
+
+    for (auto& task : m_tasks)
+    {
+        if (!task.timing.ran)
+        {
+            report += "\n  " + task.name + ": not run";
+            continue;
+        }
+
+        std::string thread = task.timing.thread == 0 ? std::string("main") : "worker " + std::to_string(task.timing.thread);
+
+        snprintf(line, sizeof(line), ": %.2f ms (%s, %.2f - %.2f ms)", task.timing.end_ms - task.timing.start_ms, thread.c_str(), task.timing.start_ms, task.timing.end_ms);
+
+        report += "\n  " + task.name + line;
+    }
+
+    return report;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
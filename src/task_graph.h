@@ -0,0 +1,60 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+enum TaskAffinity
+{
+    TASK_AFFINITY_MAIN_THREAD = 0, // Anything touching the GL context.
+    TASK_AFFINITY_WORKER
+};
+
+struct TaskTiming
+{
+    double   start_ms = 0.0; // Relative to the start of TaskGraph::run().
+    double   end_ms   = 0.0;
+    uint32_t thread   = 0; // 0 is the main thread, workers count from 1.
+    bool     ran      = false;
+};
+
+// Tasks and the tasks they depend on, run once with main thread tasks on the calling thread and the rest spread over a pool of
+// workers. Built for startup, where GL work has to stay on the context thread but CPU work can overlap it.
+class TaskGraph
+{
+public:
+    // Dependencies have to be added before the task, so tasks are always in a valid order as added.
+    uint32_t add_task(const std::string& name, TaskAffinity affinity, std::function<bool()> function, const std::vector<uint32_t>& dependencies = std::vector<uint32_t>());
+
+    // Main thread tasks run in the order they were added as soon as their dependencies are done. A worker_count of 0 picks one less
+    // than the hardware threads. Once a task fails nothing new is started, and false is returned after the running tasks finish.
+    bool run(uint32_t worker_count = 0);
+
+    // Longest chain of dependent tasks by measured time. Main thread tasks also wait on each other, so the wall time can be longer.
+    std::vector<uint32_t> critical_path() const;
+    double                critical_path_ms() const;
+    double                task_ms() const;
+
+    // Wall time, total task time, the critical path and a line per task.
+    std::string report() const;
+
+    inline uint32_t           task_count() const { return uint32_t(m_tasks.size()); }
+    inline const std::string& name(uint32_t task) const { return m_tasks[task].name; }
+    inline const TaskTiming&  timing(uint32_t task) const { return m_tasks[task].timing; }
+    inline double             wall_ms() const { return m_wall_ms; }
+
+private:
+    struct Task
+    {
+        std::string           name;
+        TaskAffinity          affinity;
+        std::function<bool()> function;
+        std::vector<uint32_t> dependencies;
+        std::vector<uint32_t> dependents;
+        TaskTiming            timing;
+    };
+
+    std::vector<Task> m_tasks;
+    double            m_wall_ms = 0.0;
+};
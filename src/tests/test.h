@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Minimal self-registering test harness, so the tests build from the same tree as the sample without another dependency. A failed
+// check reports its location and lets the test carry on, main() exits non-zero if any check failed.
+
+typedef void (*TestFunction)();
+
+struct TestCase
+{
+    const char*  name;
+    TestFunction function;
+};
+
+std::vector<TestCase>& test_registry();
+void                   test_failed(const char* file, int line, const std::string& message);
+void                   check_near(double a, double b, double epsilon, const char* expression, const char* file, int line);
+
+struct TestRegistrar
+{
+    TestRegistrar(const char* name, TestFunction function) { test_registry().push_back({ name, function }); }
+};
+
+#define TEST(name)                                                  \
+    static void          test_##name();                             \
+    static TestRegistrar test_registrar_##name(#name, test_##name); \
+    static void          test_##name()
+
+#define CHECK(condition)                                 \
+    do                                                   \
+    {                                                    \
+        if (!(condition))                                \
+            test_failed(__FILE__, __LINE__, #condition); \
+    } while (0)
+
+#define CHECK_NEAR(a, b, epsilon) check_near(double(a), double(b), double(epsilon), #a " ~= " #b, __FILE__, __LINE__)
@@ -0,0 +1,228 @@
+#include "test.h"
+#include "depth_pyramid.h"
+#include "light_culling.h"
+#include <gtc/matrix_transform.hpp>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void box_corners(const glm::vec3& min, const glm::vec3& max, glm::vec3 corners[8])
+{
+    for (int i = 0; i < 8; i++)
+        corners[i] = glm::vec3((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(downsample_min_max_covers_odd_texels)
+{
+    DepthPyramidLevel src;
+
+    src.width  = 3;
+    src.height = 2;
+    src.texels = { glm::vec2(0.5f), glm::vec2(0.4f), glm::vec2(0.9f), glm::vec2(0.6f), glm::vec2(0.7f), glm::vec2(0.1f) };
+
+    DepthPyramidLevel dst;
+    downsample_min_max(src, dst);
+
+    // The odd column folds into the last texel.
+    CHECK(dst.width == 1 && dst.height == 1);
+    CHECK_NEAR(dst.texels[0].x, 0.1f, 1e-6f);
+    CHECK_NEAR(dst.texels[0].y, 0.9f, 1e-6f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(depth_pyramid_occlusion)
+{
+    glm::mat4 view_proj = glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 100.0f) * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // A wall 10 units away filling the screen.
+    glm::vec4 wall  = view_proj * glm::vec4(0.0f, 0.0f, -10.0f, 1.0f);
+    float     depth = (wall.z / wall.w) * 0.5f + 0.5f;
+
+    std::vector<float> depth_buffer(64 * 64, depth);
+
+    DepthPyramid pyramid;
+    pyramid.build(depth_buffer.data(), 64, 64);
+
+    CHECK(pyramid.level_count() == 6);
+    CHECK(pyramid.level(pyramid.level_count() - 1).width == 1);
+
+    glm::vec3 corners[8];
+
+    box_corners(glm::vec3(-1.0f, -1.0f, -22.0f), glm::vec3(1.0f, 1.0f, -20.0f), corners);
+    CHECK(pyramid.is_occluded(view_proj, corners));
+
+    box_corners(glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -4.0f), corners);
+    CHECK(!pyramid.is_occluded(view_proj, corners));
+
+    // Straddling the wall is visible.
+    box_corners(glm::vec3(-1.0f, -1.0f, -12.0f), glm::vec3(1.0f, 1.0f, -8.0f), corners);
+    CHECK(!pyramid.is_occluded(view_proj, corners));
+
+    // Crossing the near plane is never culled.
+    box_corners(glm::vec3(-1.0f, -1.0f, -22.0f), glm::vec3(1.0f, 1.0f, 2.0f), corners);
+    CHECK(!pyramid.is_occluded(view_proj, corners));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(depth_pyramid_tile_depth_bounds)
+{
+    // Left half at 0.3, right half at 0.8 and a single nearer pixel in the bottom-left tile.
+    std::vector<float> depth_buffer(40 * 24);
+
+    for (uint32_t y = 0; y < 24; y++)
+    {
+        for (uint32_t x = 0; x < 40; x++)
+            depth_buffer[y * 40 + x] = x < 20 ? 0.3f : 0.8f;
+    }
+
+    depth_buffer[5 * 40 + 7] = 0.1f;
+
+    DepthPyramid pyramid;
+    pyramid.build(depth_buffer.data(), 40, 24);
+
+    std::vector<glm::vec2> bounds;
+    pyramid.tile_depth_bounds(16, bounds);
+
+    // Partial tiles at the right and top edges still get their own bounds.
+    CHECK(bounds.size() == 3 * 2);
+    CHECK_NEAR(bounds[0].x, 0.1f, 1e-6f);
+    CHECK_NEAR(bounds[0].y, 0.3f, 1e-6f);
+    CHECK_NEAR(bounds[1].x, 0.3f, 1e-6f);
+    CHECK_NEAR(bounds[1].y, 0.8f, 1e-6f);
+    CHECK_NEAR(bounds[2].x, 0.8f, 1e-6f);
+    CHECK_NEAR(bounds[3].x, 0.3f, 1e-6f);
+    CHECK_NEAR(bounds[3].y, 0.3f, 1e-6f);
+    CHECK_NEAR(bounds[5].y, 0.8f, 1e-6f);
+
+    // A read back level whose single texel covers the whole screen bounds every tile with its range.
+    glm::vec2 texel = glm::vec2(0.2f, 0.6f);
+
+    pyramid.build_from_level(&texel, 1, 1, 4, 40, 24);
+    pyramid.tile_depth_bounds(16, bounds);
+
+    CHECK(bounds.size() == 6);
+
+    for (auto& tile : bounds)
+        CHECK(tile == texel);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(outside_frustum)
+{
+    glm::mat4 view_proj = glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 100.0f) * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    glm::vec3 corners[8];
+
+    box_corners(glm::vec3(-1.0f, -1.0f, -11.0f), glm::vec3(1.0f, 1.0f, -9.0f), corners);
+    CHECK(!outside_frustum(view_proj, corners));
+
+    box_corners(glm::vec3(-1.0f, -1.0f, 4.0f), glm::vec3(1.0f, 1.0f, 6.0f), corners);
+    CHECK(outside_frustum(view_proj, corners));
+
+    box_corners(glm::vec3(30.0f, -1.0f, -11.0f), glm::vec3(32.0f, 1.0f, -9.0f), corners);
+    CHECK(outside_frustum(view_proj, corners));
+
+    box_corners(glm::vec3(-1.0f, -1.0f, -200.0f), glm::vec3(1.0f, 1.0f, -150.0f), corners);
+    CHECK(outside_frustum(view_proj, corners));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(sphere_screen_rect)
+{
+    glm::mat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 100.0f);
+    glm::vec4 rect;
+
+    CHECK(sphere_screen_rect(glm::vec3(0.0f, 0.0f, -10.0f), 1.0f, proj, rect));
+    CHECK(rect.x < 0.0f && rect.z > 0.0f && rect.y < 0.0f && rect.w > 0.0f);
+    CHECK(rect.z - rect.x < 0.5f);
+
+    CHECK(!sphere_screen_rect(glm::vec3(0.0f, 0.0f, 10.0f), 1.0f, proj, rect));
+    CHECK(!sphere_screen_rect(glm::vec3(100.0f, 0.0f, -10.0f), 1.0f, proj, rect));
+
+    // Off screen on every side, the rectangle must not be pulled back to the screen by its initial value.
+    CHECK(!sphere_screen_rect(glm::vec3(-100.0f, 0.0f, -10.0f), 1.0f, proj, rect));
+    CHECK(!sphere_screen_rect(glm::vec3(0.0f, 100.0f, -10.0f), 1.0f, proj, rect));
+    CHECK(!sphere_screen_rect(glm::vec3(0.0f, -100.0f, -10.0f), 1.0f, proj, rect));
+
+    // Crossing the near plane covers the whole screen.
+    CHECK(sphere_screen_rect(glm::vec3(0.0f, 0.0f, -1.5f), 1.0f, proj, rect));
+    CHECK(rect.x == -1.0f && rect.w == 1.0f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(build_light_grid)
+{
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 100.0f);
+
+    Light lights[3];
+
+    lights[0].position_range = glm::vec4(0.0f, 0.0f, -10.0f, 0.5f); // Center of the screen.
+    lights[1].position_range = glm::vec4(0.0f, 0.0f, 10.0f, 0.5f);  // Behind the camera.
+    lights[2].position_range = glm::vec4(0.0f, 0.0f, -50.0f, 0.5f); // Behind the depth bounds.
+
+    LightGrid grid;
+    build_light_grid(lights, 3, view, proj, 64, 64, nullptr, grid);
+
+    CHECK(grid.tiles_x == 4 && grid.tiles_y == 4);
+    CHECK(grid.tiles.size() == 16);
+
+    // Without depth bounds both visible lights land in the tiles around the center, in light order.
+    uint32_t center = 2 * grid.tiles_x + 2;
+
+    CHECK(grid.tiles[center].y == 2);
+    CHECK(grid.indices[grid.tiles[center].x] == 0 && grid.indices[grid.tiles[center].x + 1] == 2);
+    CHECK(grid.tiles[0].y == 0);
+
+    // Tiles whose depth only reaches 20 units reject the far light.
+    glm::vec4 near_clip = proj * glm::vec4(0.0f, 0.0f, -5.0f, 1.0f);
+    glm::vec4 far_clip  = proj * glm::vec4(0.0f, 0.0f, -20.0f, 1.0f);
+    glm::vec2 bounds    = glm::vec2(near_clip.z / near_clip.w, far_clip.z / far_clip.w) * 0.5f + 0.5f;
+
+    std::vector<glm::vec2> tile_bounds(16, bounds);
+
+    build_light_grid(lights, 3, view, proj, 64, 64, tile_bounds.data(), grid);
+
+    CHECK(grid.tiles[center].y == 1);
+    CHECK(grid.indices[grid.tiles[center].x] == 0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(build_light_grid_caps_tiles)
+{
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 100.0f);
+
+    // Large enough to cover every tile.
+    std::vector<Light> lights(MAX_LIGHTS_PER_TILE + 10);
+
+    for (auto& light : lights)
+        light.position_range = glm::vec4(0.0f, 0.0f, -10.0f, 50.0f);
+
+    LightGrid grid;
+    build_light_grid(lights.data(), uint32_t(lights.size()), view, proj, 64, 64, nullptr, grid);
+
+    CHECK(grid.overflow_tiles == 16);
+    CHECK(grid.indices.size() == 16 * MAX_LIGHTS_PER_TILE);
+
+    for (auto& tile : grid.tiles)
+    {
+        CHECK(tile.y == MAX_LIGHTS_PER_TILE);
+        CHECK(grid.indices[tile.x] == 0 && grid.indices[tile.x + tile.y - 1] == MAX_LIGHTS_PER_TILE - 1);
+    }
+
+    lights.resize(MAX_LIGHTS_PER_TILE);
+    build_light_grid(lights.data(), uint32_t(lights.size()), view, proj, 64, 64, nullptr, grid);
+
+    CHECK(grid.overflow_tiles == 0);
+    CHECK(grid.tiles[0].y == MAX_LIGHTS_PER_TILE);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,229 @@
+#include "test.h"
+#include "decal.h"
+#include "frame_snapshot.h"
+#include "shader_permutation_flags.h"
+#include <gtc/matrix_transform.hpp>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static glm::vec3 project(const glm::mat4& view_proj, const glm::vec3& p)
+{
+    glm::vec4 clip = view_proj * glm::vec4(p, 1.0f);
+    return glm::vec3(clip) / clip.w;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static DecalInstance make_decal(const glm::vec3& hit_pos, int32_t type)
+{
+    DecalProjector projector = build_decal_projector(hit_pos, glm::vec3(0.0f, 1.0f, 0.0f), 0.0f, 5.0f, 2.0f, 2.0f);
+    DecalInstance  instance;
+
+    instance.m_hit_pos             = hit_pos;
+    instance.m_hit_normal          = glm::vec3(0.0f, 1.0f, 0.0f);
+    instance.m_projector_pos       = projector.position;
+    instance.m_projector_dir       = projector.direction;
+    instance.m_projector_view      = projector.view;
+    instance.m_projector_proj      = projector.proj;
+    instance.m_projector_view_proj = projector.view_proj;
+    instance.m_decal_overlay_color = glm::vec4(1.0f);
+    instance.m_aspect_ratio        = glm::vec2(1.0f);
+    instance.m_selected_decal      = type;
+
+    return instance;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(decal_projector_centers_on_hit)
+{
+    glm::vec3 hit_pos = glm::vec3(1.0f, 2.0f, 3.0f);
+    glm::vec3 normal  = glm::vec3(0.0f, 1.0f, 0.0f);
+
+    DecalProjector projector = build_decal_projector(hit_pos, normal, 30.0f, 5.0f, 2.0f, 3.0f);
+
+    CHECK_NEAR(projector.position.y, 4.0f, 1e-5f);
+    CHECK_NEAR(projector.direction.y, -1.0f, 1e-6f);
+
+    glm::vec3 center = project(projector.view_proj, hit_pos);
+
+    // The hit is outer_depth into a [0.1, outer + inner] depth range.
+    CHECK_NEAR(center.x, 0.0f, 1e-4f);
+    CHECK_NEAR(center.y, 0.0f, 1e-4f);
+    CHECK_NEAR(center.z, (2.0f * 2.0f - 5.1f) / 4.9f, 1e-4f);
+
+    CHECK(project(projector.view_proj, hit_pos - normal * 2.9f).z < 1.0f);
+    CHECK(project(projector.view_proj, hit_pos - normal * 3.2f).z > 1.0f);
+
+    // Anything inside the circle inscribed in the footprint is covered whatever the rotation.
+    glm::vec3 edge = project(projector.view_proj, hit_pos + glm::normalize(glm::vec3(1.0f, 0.0f, 1.0f)) * 4.9f);
+
+    CHECK(std::abs(edge.x) <= 1.0f && std::abs(edge.y) <= 1.0f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(decal_projector_rotates_around_normal)
+{
+    glm::vec3 hit_pos = glm::vec3(0.0f);
+    glm::vec3 normal  = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 offset  = glm::vec3(2.0f, 0.0f, 0.0f);
+
+    glm::vec3 a = project(build_decal_projector(hit_pos, normal, 0.0f, 5.0f, 1.0f, 1.0f).view_proj, hit_pos + offset);
+    glm::vec3 b = project(build_decal_projector(hit_pos, normal, 90.0f, 5.0f, 1.0f, 1.0f).view_proj, hit_pos + offset);
+
+    CHECK_NEAR(glm::length(glm::vec2(a.x, a.y)), 0.4f, 1e-3f);
+    CHECK_NEAR(glm::length(glm::vec2(b.x, b.y)), 0.4f, 1e-3f);
+    CHECK_NEAR(glm::dot(glm::vec2(a.x, a.y), glm::vec2(b.x, b.y)), 0.0f, 1e-3f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(decal_box_corners_span_clip_volume)
+{
+    DecalProjector projector = build_decal_projector(glm::vec3(3.0f, 0.0f, -2.0f), glm::vec3(1.0f, 0.0f, 0.0f), 45.0f, 2.0f, 1.0f, 1.0f);
+
+    glm::vec3 corners[8];
+    decal_box_corners(projector.view_proj, corners);
+
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 ndc = project(projector.view_proj, corners[i]);
+
+        CHECK_NEAR(ndc.x, (i & 1) ? 1.0f : -1.0f, 1e-4f);
+        CHECK_NEAR(ndc.y, (i & 2) ? 1.0f : -1.0f, 1e-4f);
+        CHECK_NEAR(ndc.z, (i & 4) ? 1.0f : -1.0f, 1e-4f);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(decal_screen_area)
+{
+    glm::mat4 view_proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f) * glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+
+    glm::vec3 corners[8];
+    decal_box_corners(make_decal(glm::vec3(0.0f), 0).m_projector_view_proj, corners);
+
+    // A 10 x 10 footprint 10 units in front of a 90 degree camera covers more than half the width of the screen.
+    float area = decal_screen_area(view_proj, corners, 1000, 1000);
+
+    CHECK(area > 500.0f * 500.0f && area < 1000.0f * 1000.0f);
+
+    // Behind the camera it crosses the near plane and counts as the whole screen.
+    decal_box_corners(make_decal(glm::vec3(0.0f, 10.0f, 0.0f), 0).m_projector_view_proj, corners);
+
+    CHECK_NEAR(decal_screen_area(view_proj, corners, 1000, 1000), 1000.0f * 1000.0f, 1e-3f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(select_decal_lod)
+{
+    CHECK(select_decal_lod(1.0f, 4.0f, 4096.0f) == DECAL_LOD_DROPPED);
+    CHECK(select_decal_lod(4.0f, 4.0f, 4096.0f) == DECAL_LOD_ALBEDO);
+    CHECK(select_decal_lod(4095.0f, 4.0f, 4096.0f) == DECAL_LOD_ALBEDO);
+    CHECK(select_decal_lod(4096.0f, 4.0f, 4096.0f) == DECAL_LOD_FULL);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(decal_draws_appended)
+{
+    std::vector<std::pair<uint32_t, int>> previous = { { 1, 0 }, { 1, 2 }, { 3, 1 } };
+
+    CHECK(decal_draws_appended(previous, { { 1, 0 }, { 1, 2 }, { 1, 3 }, { 3, 1 } }, 3));
+    CHECK(decal_draws_appended(previous, previous, 3));
+
+    // Removed, reordered or re-keyed draws are not appends.
+    CHECK(!decal_draws_appended(previous, { { 1, 0 }, { 3, 1 } }, 3));
+    CHECK(!decal_draws_appended(previous, { { 1, 2 }, { 1, 0 }, { 3, 1 } }, 3));
+    CHECK(!decal_draws_appended(previous, { { 1, 0 }, { 3, 2 }, { 3, 1 } }, 3));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(build_decal_draws_culls_and_sorts)
+{
+    glm::mat4 view_proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f) * glm::lookAt(glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+
+    std::vector<DecalInstance> instances = { make_decal(glm::vec3(-5.0f, 0.0f, 0.0f), 0),
+                                             make_decal(glm::vec3(0.0f, 0.0f, 0.0f), 1),
+                                             make_decal(glm::vec3(500.0f, 0.0f, 0.0f), 1),
+                                             make_decal(glm::vec3(5.0f, 0.0f, 0.0f), 0),
+                                             make_decal(glm::vec3(0.0f, 0.0f, 5.0f), 1) };
+
+    std::vector<uint32_t> type_permutations = { PERMUTATION_NORMAL_MAP | PERMUTATION_ALPHA_TEST, PERMUTATION_ALPHA_TEST };
+
+    SimulationInput input;
+
+    input.width            = 1024;
+    input.height           = 1024;
+    input.culling.lod      = false;
+    input.decal_key_mask   = PERMUTATION_NORMAL_MAP | PERMUTATION_ALPHA_TEST;
+    input.ready_decal_keys = ~uint64_t(0);
+
+    FrameSnapshot snapshot;
+    build_decal_draws(instances, type_permutations, input, view_proj, snapshot);
+
+    CHECK(snapshot.decal_count == 5);
+    CHECK(snapshot.decals_frustum_culled == 1);
+    CHECK(snapshot.draw_order.size() == 4);
+    CHECK(snapshot.draws.size() == snapshot.draw_order.size());
+
+    // Sorted by key, instance order kept within a key.
+    std::vector<std::pair<uint32_t, int>> expected = { { PERMUTATION_ALPHA_TEST, 1 },
+                                                       { PERMUTATION_ALPHA_TEST, 4 },
+                                                       { PERMUTATION_NORMAL_MAP | PERMUTATION_ALPHA_TEST, 0 },
+                                                       { PERMUTATION_NORMAL_MAP | PERMUTATION_ALPHA_TEST, 3 } };
+
+    CHECK(snapshot.draw_order == expected);
+
+    for (int i = 0; i < snapshot.draws.size(); i++)
+    {
+        const DecalInstance& instance = instances[snapshot.draw_order[i].second];
+
+        CHECK(snapshot.draws[i].type == instance.m_selected_decal);
+        CHECK_NEAR((snapshot.draws[i].inv_view_proj * instance.m_projector_view_proj)[2][2], 1.0f, 1e-4f);
+    }
+
+    // Variants that are still compiling are skipped rather than drawn with the wrong program.
+    input.ready_decal_keys = uint64_t(1) << PERMUTATION_ALPHA_TEST;
+
+    build_decal_draws(instances, type_permutations, input, view_proj, snapshot);
+
+    CHECK(snapshot.draw_order.size() == 2);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(build_decal_draws_lod_drops_normal_map)
+{
+    glm::mat4 view_proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 1000.0f) * glm::lookAt(glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+
+    std::vector<DecalInstance> instances         = { make_decal(glm::vec3(0.0f), 0) };
+    std::vector<uint32_t>      type_permutations = { PERMUTATION_NORMAL_MAP };
+
+    SimulationInput input;
+
+    input.width               = 64;
+    input.height              = 64;
+    input.culling.albedo_area = 64.0f * 64.0f;
+    input.decal_key_mask      = PERMUTATION_NORMAL_MAP | PERMUTATION_ALPHA_TEST;
+    input.ready_decal_keys    = ~uint64_t(0);
+
+    FrameSnapshot snapshot;
+    build_decal_draws(instances, type_permutations, input, view_proj, snapshot);
+
+    CHECK(snapshot.lod_counts[DECAL_LOD_ALBEDO] == 1);
+    CHECK(snapshot.draw_order.size() == 1 && snapshot.draw_order[0].first == 0);
+
+    input.culling.drop_area = 64.0f * 64.0f;
+
+    build_decal_draws(instances, type_permutations, input, view_proj, snapshot);
+
+    CHECK(snapshot.lod_counts[DECAL_LOD_DROPPED] == 1);
+    CHECK(snapshot.draw_order.empty());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
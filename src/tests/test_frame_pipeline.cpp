@@ -0,0 +1,287 @@
+#include "test.h"
+#include "readback_ring.h"
+#include "triple_buffer.h"
+#include "frame_pipeline.h"
+#include "frame_snapshot.h"
+
+// Stands in for GLReadbackBackend: buffers hold their own id as data and fences signal when the test says so.
+struct FakeReadbackBackend
+{
+    typedef uint32_t Buffer;
+    typedef uint32_t Fence;
+
+    uint32_t          next_handle   = 1;
+    int32_t           live_buffers  = 0;
+    int32_t           live_fences   = 0;
+    uint32_t          mapped_buffer = 0;
+    std::vector<bool> signaled      = std::vector<bool>(64, false);
+
+    Buffer create_buffer(size_t size)
+    {
+        live_buffers++;
+        return next_handle++;
+    }
+
+    void destroy_buffer(Buffer buffer) { live_buffers--; }
+
+    Fence insert_fence()
+    {
+        live_fences++;
+        return next_handle++;
+    }
+
+    bool is_signaled(Fence fence) { return signaled[fence]; }
+    void destroy_fence(Fence fence) { live_fences--; }
+
+    const void* map(Buffer buffer, size_t size)
+    {
+        mapped_buffer = buffer;
+        return &mapped_buffer;
+    }
+
+    void unmap(Buffer buffer) {}
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(readback_ring_consumes_newest_signaled)
+{
+    ReadbackRing<FakeReadbackBackend, int> ring(FakeReadbackBackend(), 3, 4);
+
+    FakeReadbackBackend::Buffer buffer;
+
+    // Buffers are handles 1 to 3, so the fences of the three writes are 4 to 6.
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK(ring.begin_write(buffer));
+        CHECK(buffer == uint32_t(i + 1));
+        ring.end_write(10 + i);
+    }
+
+    // Every slot is in flight, the next write is skipped instead of stalling.
+    CHECK(!ring.begin_write(buffer));
+    CHECK(ring.skipped_writes() == 1);
+    CHECK(ring.in_flight() == 3);
+
+    int payload = -1;
+
+    CHECK(!ring.consume_latest([&](const void* data, const int& p) { payload = p; }));
+
+    ring.backend().signaled[4] = true;
+    ring.backend().signaled[5] = true;
+
+    uint32_t data_buffer = 0;
+
+    CHECK(ring.consume_latest([&](const void* data, const int& p) {
+        payload     = p;
+        data_buffer = *(const uint32_t*)data;
+    }));
+
+    // The second copy is the newest complete one, the first is freed along with it.
+    CHECK(payload == 11);
+    CHECK(data_buffer == 2);
+    CHECK(ring.in_flight() == 1);
+    CHECK(ring.consumed() == 1);
+    CHECK(ring.backend().live_fences == 1);
+
+    CHECK(ring.begin_write(buffer));
+    CHECK(buffer == 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(readback_ring_newest_wins_after_wrap)
+{
+    ReadbackRing<FakeReadbackBackend, int> ring(FakeReadbackBackend(), 3, 4);
+
+    FakeReadbackBackend::Buffer buffer;
+
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK(ring.begin_write(buffer));
+        ring.end_write(i);
+    }
+
+    // Only the first copy lands and its slot is written again, so the newest copy now sits in the lowest slot.
+    ring.backend().signaled[4] = true;
+
+    CHECK(ring.consume_latest([](const void* data, const int& p) {}));
+    CHECK(ring.begin_write(buffer));
+    CHECK(buffer == 1);
+    ring.end_write(3);
+
+    for (uint32_t fence = 5; fence < 8; fence++)
+        ring.backend().signaled[fence] = true;
+
+    int payload = -1;
+
+    CHECK(ring.consume_latest([&](const void* data, const int& p) { payload = p; }));
+    CHECK(payload == 3);
+    CHECK(ring.in_flight() == 0);
+    CHECK(ring.backend().live_fences == 0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(readback_ring_wraps_around)
+{
+    ReadbackRing<FakeReadbackBackend, int> ring(FakeReadbackBackend(), 3, 4);
+
+    FakeReadbackBackend::Buffer buffer;
+
+    // Each copy lands before the next one is issued, so the ring cycles through its buffers in order several times over.
+    for (int i = 0; i < 10; i++)
+    {
+        CHECK(ring.begin_write(buffer));
+        CHECK(buffer == uint32_t(i % 3 + 1));
+
+        ring.end_write(i);
+        ring.backend().signaled[ring.backend().next_handle - 1] = true;
+
+        int payload = -1;
+
+        CHECK(ring.consume_latest([&](const void* data, const int& p) { payload = p; }));
+        CHECK(payload == i);
+        CHECK(ring.in_flight() == 0);
+    }
+
+    CHECK(ring.consumed() == 10);
+    CHECK(ring.skipped_writes() == 0);
+    CHECK(ring.backend().live_fences == 0);
+    CHECK(ring.backend().live_buffers == 3);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(readback_ring_drops_stale_requests)
+{
+    ReadbackRing<FakeReadbackBackend, int> ring(FakeReadbackBackend(), 4, 4);
+
+    FakeReadbackBackend::Buffer buffer;
+    std::vector<int>            payloads;
+
+    auto consume = [&](const void* data, const int& p) { payloads.push_back(p); };
+
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK(ring.begin_write(buffer));
+        ring.end_write(i);
+    }
+
+    // All three land between two polls, only the newest reaches the consumer and the older two are released unseen.
+    for (uint32_t fence = 5; fence < 8; fence++)
+        ring.backend().signaled[fence] = true;
+
+    CHECK(ring.consume_latest(consume));
+    CHECK(!ring.consume_latest(consume));
+    CHECK(payloads == std::vector<int>({ 2 }));
+    CHECK(ring.in_flight() == 0);
+    CHECK(ring.backend().live_fences == 0);
+
+    // A newer request still in flight is kept when an older one lands.
+    CHECK(ring.begin_write(buffer));
+    ring.end_write(3);
+    CHECK(ring.begin_write(buffer));
+    ring.end_write(4);
+
+    ring.backend().signaled[8] = true;
+
+    CHECK(ring.consume_latest(consume));
+    CHECK(payloads == std::vector<int>({ 2, 3 }));
+    CHECK(ring.in_flight() == 1);
+    CHECK(ring.backend().live_fences == 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(triple_buffer_reads_latest)
+{
+    TripleBuffer<int> buffer;
+
+    CHECK(!buffer.update());
+
+    buffer.write() = 1;
+    buffer.publish();
+    buffer.write() = 2;
+    buffer.publish();
+
+    // Only the newest of several publishes is seen.
+    CHECK(buffer.update());
+    CHECK(buffer.read() == 2);
+    CHECK(!buffer.update());
+    CHECK(buffer.read() == 2);
+
+    // The writer never gets the buffer being read.
+    buffer.write() = 3;
+    CHECK(buffer.read() == 2);
+
+    buffer.publish();
+
+    CHECK(buffer.update());
+    CHECK(buffer.read() == 3);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(skipped_inputs_keep_camera_motion)
+{
+    TripleBuffer<SimulationInput> inputs;
+    CameraMotion                  total;
+
+    // Five frames are published while the simulation is busy, mouse-look is only held for the last three.
+    for (int i = 0; i < 5; i++)
+    {
+        accumulate_camera_motion(total, 2.0f, -1.0f, 10.0f, 4.0f, 0.5f, i >= 2, 16.0f);
+
+        inputs.write().camera_motion = total;
+        inputs.publish();
+    }
+
+    CameraMotion simulated;
+
+    CHECK(inputs.update());
+
+    CameraMotion motion = camera_motion_delta(simulated, inputs.read().camera_motion);
+    simulated           = inputs.read().camera_motion;
+
+    // The one step that runs applies the movement of all five frames.
+    CHECK_NEAR(motion.forward, 5 * 2.0 * 16.0, 1e-6);
+    CHECK_NEAR(motion.right, 5 * -1.0 * 16.0, 1e-6);
+    CHECK_NEAR(motion.yaw, 3 * 10.0 * 0.5, 1e-6);
+    CHECK_NEAR(motion.pitch, 3 * 4.0 * 0.5, 1e-6);
+
+    // Standing still afterwards applies nothing more.
+    accumulate_camera_motion(total, 0.0f, 0.0f, 0.0f, 0.0f, 0.5f, true, 16.0f);
+
+    inputs.write().camera_motion = total;
+    inputs.publish();
+
+    CHECK(inputs.update());
+
+    motion = camera_motion_delta(simulated, inputs.read().camera_motion);
+
+    CHECK(motion.forward == 0.0 && motion.right == 0.0 && motion.pitch == 0.0 && motion.yaw == 0.0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(frame_worker_runs_steps)
+{
+    std::atomic<int> steps(0);
+
+    {
+        FrameWorker worker([&]() { steps++; });
+
+        worker.kick();
+        worker.wait_idle();
+
+        CHECK(steps == 1);
+
+        worker.kick();
+        worker.wait_idle();
+    }
+
+    CHECK(steps == 2);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,145 @@
+#include "test.h"
+#include "gpu_memory.h"
+
+#define TEST_GL_RGBA8 0x8058
+#define TEST_GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(texture_bytes)
+{
+    bool compressed = true;
+
+    CHECK(texture_format_bytes(TEST_GL_RGBA8, &compressed) == 4 && !compressed);
+    CHECK(texture_format_bytes(TEST_GL_COMPRESSED_RGBA_BPTC_UNORM, &compressed) == 16 && compressed);
+    CHECK(texture_format_bytes(0) == 0);
+
+    TextureDesc desc;
+
+    desc.internal_format = TEST_GL_RGBA8;
+    desc.width           = 256;
+    desc.height          = 128;
+    desc.mip_levels      = 9;
+
+    // 256x128 + 128x64 + ... + 2x1 + 1x1.
+    CHECK(texture_bytes(desc) == (32768 + 8192 + 2048 + 512 + 128 + 32 + 8 + 2 + 1) * 4);
+    CHECK(texture_bytes(desc, 1) == (8192 + 2048 + 512 + 128 + 32 + 8 + 2 + 1) * 4);
+
+    desc.array_size = 3;
+
+    CHECK(texture_bytes(desc, 8) == 3 * 4);
+
+    // Compressed levels round up to whole blocks.
+    desc.internal_format = TEST_GL_COMPRESSED_RGBA_BPTC_UNORM;
+    desc.array_size      = 1;
+
+    CHECK(texture_bytes(desc, 7) == 2 * 16);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(select_mip_bias)
+{
+    TextureDesc desc;
+
+    desc.internal_format = TEST_GL_RGBA8;
+    desc.width           = 1024;
+    desc.height          = 1024;
+    desc.mip_levels      = 11;
+
+    std::vector<TextureDesc> textures(4, desc);
+
+    uint64_t full    = texture_bytes(desc) * 4;
+    uint64_t dropped = texture_bytes(desc, 1) * 4;
+
+    CHECK(select_mip_bias(textures, 0, 0, 4) == 0);
+    CHECK(select_mip_bias(textures, 0, full, 4) == 0);
+    CHECK(select_mip_bias(textures, 0, full - 1, 4) == 1);
+    CHECK(select_mip_bias(textures, 1000, dropped + 999, 4) == 2);
+
+    // Nothing fits, the largest bias allowed is returned.
+    CHECK(select_mip_bias(textures, full, full, 4) == 4);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(texture_level_bytes)
+{
+    TextureDesc desc;
+
+    desc.internal_format = TEST_GL_COMPRESSED_RGBA_BPTC_UNORM;
+    desc.width           = 64;
+    desc.height          = 32;
+    desc.mip_levels      = 7;
+
+    // A trimmed texture is read back and uploaded a level at a time, so the levels have to add up to the whole chain.
+    uint64_t total = 0;
+
+    for (uint32_t i = 0; i < desc.mip_levels; i++)
+        total += texture_level_bytes(desc, i);
+
+    CHECK(total == texture_bytes(desc));
+    CHECK(texture_level_bytes(desc, 0) == 16 * 8 * 16);
+    CHECK(texture_level_bytes(desc, 6) == 16);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(select_mip_bias_keeps_last_level)
+{
+    TextureDesc large;
+
+    large.internal_format = TEST_GL_RGBA8;
+    large.width           = 256;
+    large.height          = 256;
+    large.mip_levels      = 9;
+
+    TextureDesc single;
+
+    single.internal_format = TEST_GL_RGBA8;
+    single.width           = 64;
+    single.height          = 64;
+
+    std::vector<TextureDesc> textures = { large, single };
+
+    // The single level texture can't shrink, so every bias still pays for all of it.
+    uint64_t budget = texture_bytes(large, 3) + texture_bytes(single);
+
+    CHECK(select_mip_bias(textures, 0, budget, 8) == 3);
+    CHECK(select_mip_bias(textures, 0, budget - 1, 8) == 4);
+
+    // Even the largest bias keeps the last level of each texture.
+    CHECK(select_mip_bias(textures, 0, texture_bytes(single), 8) == 8);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(gpu_memory_registry)
+{
+    GpuMemoryRegistry registry;
+
+    registry.track("G-Buffer", GPU_MEMORY_RENDER_TARGETS, 1000);
+    registry.track("Decal", GPU_MEMORY_DECAL_TEXTURES, 500);
+
+    CHECK(registry.total_bytes() == 1500);
+    CHECK(registry.allocation_count() == 2);
+
+    // Tracking a name again replaces it, e.g. render targets recreated on resize.
+    registry.track("G-Buffer", GPU_MEMORY_RENDER_TARGETS, 2000);
+
+    CHECK(registry.category_bytes(GPU_MEMORY_RENDER_TARGETS) == 2000);
+    CHECK(registry.total_bytes() == 2500);
+    CHECK(registry.peak_bytes() == 2500);
+
+    registry.untrack("G-Buffer");
+
+    CHECK(registry.total_bytes() == 500);
+    CHECK(registry.peak_bytes() == 2500);
+    CHECK(registry.allocation_count() == 1);
+
+    CHECK(format_bytes(512) == "512 B");
+    CHECK(format_bytes(2048) == "2.00 KB");
+    CHECK(format_bytes(3 * 1024 * 1024) == "3.00 MB");
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,66 @@
+#include "test.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+static const char* g_current_test  = nullptr;
+static int         g_failed_checks = 0;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<TestCase>& test_registry()
+{
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void test_failed(const char* file, int line, const std::string& message)
+{
+    printf("%s:%d: %s: check failed: %s\n", file, line, g_current_test, message.c_str());
+    g_failed_checks++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void check_near(double a, double b, double epsilon, const char* expression, const char* file, int line)
+{
+    if (!(std::abs(a - b) <= epsilon))
+        test_failed(file, line, std::string(expression) + ", got " + std::to_string(a) + " and " + std::to_string(b));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Runs every registered test, or only those whose name contains the first argument.
+int main(int argc, char* argv[])
+{
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+
+    int run    = 0;
+    int failed = 0;
+
+    for (auto& test : test_registry())
+    {
+        if (filter && !strstr(test.name, filter))
+            continue;
+
+        int failed_before = g_failed_checks;
+
+        g_current_test = test.name;
+        test.function();
+
+        bool passed = g_failed_checks == failed_before;
+
+        printf("[%s] %s\n", passed ? "PASS" : "FAIL", test.name);
+
+        run++;
+        failed += passed ? 0 : 1;
+    }
+
+    printf("%d of %d tests passed\n", run - failed, run);
+
+    return failed == 0 && run > 0 ? 0 : 1;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,166 @@
+#include "test.h"
+#include "picking.h"
+#include "visibility_buffer.h"
+#include <gtc/matrix_transform.hpp>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static glm::vec2 octahedral_encode(glm::vec3 n)
+{
+    n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+
+    if (n.z >= 0.0f)
+        return glm::vec2(n.x, n.y);
+
+    return glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static VisibilityVertex make_vertex(const glm::vec3& position, const glm::vec2& uv)
+{
+    VisibilityVertex vertex;
+
+    vertex.position  = position;
+    vertex.u         = uv.x;
+    vertex.normal    = glm::vec3(0.0f, 0.0f, 1.0f);
+    vertex.v         = uv.y;
+    vertex.tangent   = glm::vec3(1.0f, 0.0f, 0.0f);
+    vertex.padding0  = 0.0f;
+    vertex.bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
+    vertex.padding1  = 0.0f;
+
+    return vertex;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(octahedral_decode)
+{
+    glm::vec3 normals[] = { glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f)), glm::normalize(glm::vec3(-1.0f, 0.5f, -3.0f)), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f) };
+
+    for (auto& n : normals)
+        CHECK_NEAR(glm::dot(octahedral_decode(octahedral_encode(n)), n), 1.0f, 1e-5f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(resolve_pick)
+{
+    glm::mat4 view_proj = glm::perspective(glm::radians(60.0f), 1.0f, 1.0f, 100.0f) * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec4 clip      = view_proj * glm::vec4(0.0f, 0.0f, -10.0f, 1.0f);
+
+    PickRequest request;
+
+    request.ndc           = glm::vec2(0.0f);
+    request.inv_view_proj = glm::inverse(view_proj);
+    request.camera_pos    = glm::vec3(0.0f);
+    request.packed_normal = true;
+    request.visibility_id = false;
+
+    glm::vec2 encoded = octahedral_encode(glm::vec3(0.0f, 0.0f, 1.0f));
+
+    PickTexel texel = {};
+
+    texel.depth     = (clip.z / clip.w) * 0.5f + 0.5f;
+    texel.normal[0] = encoded.x;
+    texel.normal[1] = encoded.y;
+
+    PickResult result;
+
+    CHECK(resolve_pick(texel, request, result));
+    CHECK_NEAR(result.distance, 10.0f, 1e-3f);
+    CHECK_NEAR(result.position.z, -10.0f, 1e-3f);
+    CHECK_NEAR(result.normal.z, 1.0f, 1e-5f);
+
+    texel.depth = 1.0f;
+
+    CHECK(!resolve_pick(texel, request, result));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(visibility_id_round_trip)
+{
+    uint32_t instance = 0;
+    uint32_t triangle = 0;
+
+    CHECK(!decode_visibility_id(glm::uvec2(0, 7), instance, triangle));
+    CHECK(decode_visibility_id(encode_visibility_id(0, 7), instance, triangle));
+    CHECK(instance == 0 && triangle == 7);
+    CHECK(decode_visibility_id(encode_visibility_id(41, 123456), instance, triangle));
+    CHECK(instance == 41 && triangle == 123456);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(compute_barycentrics)
+{
+    glm::mat4 view_proj = glm::perspective(glm::radians(60.0f), 1.0f, 1.0f, 100.0f) * glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    glm::vec3 p[3] = { glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, -1.0f, -2.0f), glm::vec3(0.0f, 1.0f, -1.0f) };
+    glm::vec4 clip[3];
+
+    for (int i = 0; i < 3; i++)
+        clip[i] = view_proj * glm::vec4(p[i], 1.0f);
+
+    glm::vec2 screen_size = glm::vec2(512.0f);
+
+    // Projecting the interpolated position gives back the pixel, i.e. the weights are perspective correct.
+    glm::vec3 weights = glm::vec3(0.2f, 0.3f, 0.5f);
+    glm::vec4 point   = view_proj * glm::vec4(p[0] * weights.x + p[1] * weights.y + p[2] * weights.z, 1.0f);
+    glm::vec2 ndc     = glm::vec2(point.x, point.y) / point.w;
+
+    VisibilityBarycentrics b = compute_barycentrics(clip[0], clip[1], clip[2], ndc, screen_size);
+
+    CHECK_NEAR(b.lambda.x, weights.x, 1e-4f);
+    CHECK_NEAR(b.lambda.y, weights.y, 1e-4f);
+    CHECK_NEAR(b.lambda.z, weights.z, 1e-4f);
+
+    // Derivatives match a one pixel finite difference.
+    VisibilityBarycentrics right = compute_barycentrics(clip[0], clip[1], clip[2], ndc + glm::vec2(2.0f / screen_size.x, 0.0f), screen_size);
+    VisibilityBarycentrics up    = compute_barycentrics(clip[0], clip[1], clip[2], ndc + glm::vec2(0.0f, 2.0f / screen_size.y), screen_size);
+
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK_NEAR(b.ddx[i], right.lambda[i] - b.lambda[i], 1e-5f);
+        CHECK_NEAR(b.ddy[i], up.lambda[i] - b.lambda[i], 1e-5f);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(resolve_visibility)
+{
+    VisibilityGeometry geometry;
+
+    geometry.vertices = { make_vertex(glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec2(0.0f, 0.0f)),
+                          make_vertex(glm::vec3(1.0f, -1.0f, 0.0f), glm::vec2(1.0f, 0.0f)),
+                          make_vertex(glm::vec3(-1.0f, 1.0f, 0.0f), glm::vec2(0.0f, 1.0f)) };
+    geometry.indices  = { 0, 1, 2 };
+
+    std::vector<glm::mat4> transforms = { glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -5.0f)) };
+
+    glm::mat4 view_proj   = glm::perspective(glm::radians(60.0f), 1.0f, 1.0f, 100.0f);
+    glm::vec2 screen_size = glm::vec2(256.0f);
+
+    glm::vec4 point = view_proj * glm::vec4(-0.5f, -0.5f, -5.0f, 1.0f);
+    glm::vec2 ndc   = glm::vec2(point.x, point.y) / point.w;
+
+    VisibilityAttributes attributes;
+
+    CHECK(resolve_visibility(geometry, transforms, view_proj, encode_visibility_id(0, 0), ndc, screen_size, attributes));
+    CHECK_NEAR(attributes.position.x, -0.5f, 1e-4f);
+    CHECK_NEAR(attributes.position.z, -5.0f, 1e-4f);
+    CHECK_NEAR(attributes.tex_coord.x, 0.25f, 1e-4f);
+    CHECK_NEAR(attributes.tex_coord.y, 0.25f, 1e-4f);
+    CHECK_NEAR(attributes.normal.z, 1.0f, 1e-5f);
+    CHECK(attributes.tex_coord_ddx.x > 0.0f && attributes.tex_coord_ddy.y > 0.0f);
+
+    // Background and ids past the end of the buffers are rejected.
+    CHECK(!resolve_visibility(geometry, transforms, view_proj, glm::uvec2(0), ndc, screen_size, attributes));
+    CHECK(!resolve_visibility(geometry, transforms, view_proj, encode_visibility_id(1, 0), ndc, screen_size, attributes));
+    CHECK(!resolve_visibility(geometry, transforms, view_proj, encode_visibility_id(0, 1), ndc, screen_size, attributes));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,67 @@
+#include "test.h"
+#include "ray_scene.h"
+#include <gtc/matrix_transform.hpp>
+
+struct TestSubMesh
+{
+    uint32_t base_index;
+    uint32_t index_count;
+    uint32_t base_vertex;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(flatten_submesh_indices)
+{
+    // Two submeshes of one triangle each, both indexing relative to their own base vertex.
+    uint32_t    indices[]   = { 0, 1, 2, 2, 1, 0 };
+    TestSubMesh submeshes[] = { { 0, 3, 0 }, { 3, 3, 4 } };
+    uint32_t    flattened[6];
+
+    CHECK(flatten_submesh_indices(indices, submeshes, 2, flattened) == 6);
+
+    uint32_t expected[] = { 0, 1, 2, 6, 5, 4 };
+
+    for (int i = 0; i < 6; i++)
+        CHECK(flattened[i] == expected[i]);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(ray_scene_instances)
+{
+    // Unit quad in the XZ plane facing up.
+    glm::vec3 positions[] = { glm::vec3(-1.0f, 0.0f, -1.0f), glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(-1.0f, 0.0f, 1.0f) };
+    uint32_t  indices[]   = { 0, 2, 1, 0, 3, 2 };
+
+    RayScene scene;
+
+    uint32_t mesh   = scene.add_mesh(positions, 4, indices, 2);
+    uint32_t first  = scene.add_instance(mesh, glm::mat4(1.0f));
+    uint32_t second = scene.add_instance(mesh, glm::translate(glm::mat4(1.0f), glm::vec3(10.0f, 2.0f, 0.0f)));
+
+    scene.commit();
+
+    CHECK(scene.mesh_count() == 1 && scene.instance_count() == 2);
+
+    RayHit hit;
+
+    CHECK(scene.intersect(glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), hit));
+    CHECK(hit.instance == first);
+    CHECK_NEAR(hit.distance, 5.0f, 1e-4f);
+    CHECK_NEAR(std::abs(hit.normal.y), 1.0f, 1e-4f);
+
+    CHECK(scene.intersect(glm::vec3(10.0f, 5.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), hit));
+    CHECK(hit.instance == second);
+    CHECK_NEAR(hit.distance, 3.0f, 1e-4f);
+
+    // Moving an instance only takes a top-level rebuild to show up.
+    scene.set_instance_transform(second, glm::translate(glm::mat4(1.0f), glm::vec3(20.0f, 0.0f, 0.0f)));
+    scene.commit();
+
+    CHECK(!scene.intersect(glm::vec3(10.0f, 5.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), hit));
+    CHECK(scene.intersect(glm::vec3(20.0f, 5.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), hit));
+    CHECK(hit.instance == second);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,169 @@
+#include "test.h"
+#include "render_graph.h"
+
+#define TEST_GL_RG16F 0x822F
+#define TEST_GL_RGBA8 0x8058
+
+static TextureDesc target_desc(uint32_t internal_format, uint32_t width = 64, uint32_t height = 64)
+{
+    TextureDesc desc;
+
+    desc.internal_format = internal_format;
+    desc.width           = width;
+    desc.height          = height;
+
+    return desc;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(render_graph_culls_unused_passes)
+{
+    RenderGraph graph;
+
+    uint32_t output = graph.import_texture("Output", target_desc(TEST_GL_RGBA8));
+    uint32_t used   = graph.create_texture("Used", target_desc(TEST_GL_RG16F));
+    uint32_t unused = graph.create_texture("Unused", target_desc(TEST_GL_RG16F));
+
+    uint32_t producer = graph.add_pass("Producer", nullptr);
+    uint32_t orphan   = graph.add_pass("Orphan", nullptr);
+    uint32_t consumer = graph.add_pass("Consumer", nullptr);
+    uint32_t readback = graph.add_pass("Readback", nullptr, true);
+
+    graph.write(producer, used);
+    graph.write(orphan, unused);
+    graph.read(consumer, used);
+    graph.write(consumer, output);
+    graph.read(readback, used);
+
+    CHECK(graph.compile());
+
+    CHECK(graph.is_culled(orphan));
+    CHECK(!graph.is_culled(producer) && !graph.is_culled(consumer) && !graph.is_culled(readback));
+    CHECK(graph.order().size() == 3);
+    CHECK(graph.first_use(unused) == RENDER_GRAPH_INVALID);
+    CHECK(graph.physical_slot(unused) == RENDER_GRAPH_INVALID);
+    CHECK(graph.physical_slot(output) == RENDER_GRAPH_INVALID);
+    CHECK(graph.stats().culled_passes == 1 && graph.stats().culled_resources == 1);
+
+    // Overwritten before anything reads it, the first write is dead.
+    RenderGraph overwrite;
+
+    uint32_t target = overwrite.create_texture("Target", target_desc(TEST_GL_RGBA8));
+    uint32_t dead   = overwrite.add_pass("Dead", nullptr);
+    uint32_t live   = overwrite.add_pass("Live", nullptr);
+    uint32_t blit   = overwrite.add_pass("Blit", nullptr, true);
+
+    overwrite.write(dead, target);
+    overwrite.write(live, target);
+    overwrite.read(blit, target);
+
+    CHECK(overwrite.compile());
+    CHECK(overwrite.is_culled(dead) && !overwrite.is_culled(live));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(render_graph_orders_and_aliases)
+{
+    RenderGraph graph;
+
+    std::vector<uint32_t> executed;
+
+    uint32_t depth   = graph.import_texture("Depth", target_desc(TEST_GL_RGBA8));
+    uint32_t albedo  = graph.import_texture("Albedo", target_desc(TEST_GL_RGBA8));
+    uint32_t shaded  = graph.import_texture("Shaded", target_desc(TEST_GL_RGBA8));
+    uint32_t tangent = graph.create_texture("Tangent", target_desc(TEST_GL_RG16F));
+    uint32_t scratch = graph.create_texture("Scratch", target_desc(TEST_GL_RG16F));
+    uint32_t small   = graph.create_texture("Small", target_desc(TEST_GL_RG16F, 32, 32));
+
+    uint32_t g_buffer = graph.add_pass("G-Buffer", [&]() { executed.push_back(0); });
+    uint32_t hiz      = graph.add_pass("Hi-Z", [&]() { executed.push_back(1); }, true);
+    uint32_t decals   = graph.add_pass("Decals", [&]() { executed.push_back(2); });
+    uint32_t blur     = graph.add_pass("Blur", [&]() { executed.push_back(3); });
+    uint32_t shading  = graph.add_pass("Shading", [&]() { executed.push_back(4); });
+
+    graph.write(g_buffer, depth);
+    graph.write(g_buffer, albedo);
+    graph.write(g_buffer, tangent);
+    graph.read(hiz, depth);
+    graph.read(hiz, small);
+    graph.write(hiz, small);
+    graph.read(decals, tangent);
+    graph.read(decals, albedo);
+    graph.write(decals, albedo);
+    graph.write(blur, scratch);
+    graph.read(shading, scratch);
+    graph.read(shading, albedo);
+    graph.write(shading, shaded);
+
+    CHECK(graph.compile());
+
+    // Decals end the tangent's lifetime, so they move ahead of Hi-Z, which doesn't depend on them.
+    std::vector<uint32_t> expected = { g_buffer, decals, hiz, blur, shading };
+
+    CHECK(graph.order() == expected);
+
+    graph.execute();
+
+    CHECK(executed == std::vector<uint32_t>({ 0, 2, 1, 3, 4 }));
+
+    CHECK(graph.first_use(tangent) == 0 && graph.last_use(tangent) == 1);
+    CHECK(graph.first_use(scratch) == 3 && graph.last_use(scratch) == 4);
+
+    // The scratch target starts after the tangent's last use and shares its slot. The smaller target can't.
+    CHECK(graph.physical_slot(tangent) == graph.physical_slot(scratch));
+    CHECK(graph.physical_slot(small) != graph.physical_slot(tangent));
+    CHECK(graph.slot_count() == 2);
+    CHECK(graph.slot_desc(graph.physical_slot(small)).width == 32);
+
+    const RenderGraphStats& stats = graph.stats();
+
+    CHECK(stats.transient_textures == 3 && stats.physical_slots == 2);
+    CHECK(stats.transient_bytes == 64 * 64 * 4 * 2 + 32 * 32 * 4);
+    CHECK(stats.allocated_bytes == 64 * 64 * 4 + 32 * 32 * 4);
+
+    graph.clear();
+
+    CHECK(graph.order().empty() && graph.slot_count() == 0 && graph.stats().passes == 0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(render_graph_overlapping_lifetimes)
+{
+    RenderGraph graph;
+
+    uint32_t output = graph.import_texture("Output", target_desc(TEST_GL_RGBA8));
+    uint32_t a      = graph.create_texture("A", target_desc(TEST_GL_RG16F));
+    uint32_t b      = graph.create_texture("B", target_desc(TEST_GL_RG16F));
+
+    uint32_t write_a = graph.add_pass("Write A", nullptr);
+    uint32_t write_b = graph.add_pass("Write B", nullptr);
+    uint32_t combine = graph.add_pass("Combine", nullptr);
+
+    graph.write(write_a, a);
+    graph.write(write_b, b);
+    graph.read(combine, a);
+    graph.read(combine, b);
+    graph.write(combine, output);
+
+    CHECK(graph.compile());
+
+    // Both are alive when they are combined.
+    CHECK(graph.physical_slot(a) != graph.physical_slot(b));
+    CHECK(graph.stats().transient_bytes == graph.stats().allocated_bytes);
+
+    // Reading a transient nothing wrote is an error rather than undefined contents.
+    RenderGraph invalid;
+
+    uint32_t missing = invalid.create_texture("Missing", target_desc(TEST_GL_RG16F));
+    uint32_t reader  = invalid.add_pass("Reader", nullptr, true);
+
+    invalid.read(reader, missing);
+
+    CHECK(!invalid.compile());
+    CHECK(!invalid.error().empty());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,140 @@
+#include "test.h"
+#include "task_graph.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+static void sleep_ms(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(task_graph_respects_dependencies)
+{
+    TaskGraph graph;
+
+    std::mutex            mutex;
+    std::vector<uint32_t> finished;
+    std::thread::id       main_id = std::this_thread::get_id();
+    std::atomic<bool>     main_on_caller(true);
+
+    auto task = [&](uint32_t id, bool main_thread) {
+        return [&, id, main_thread]() {
+            if (main_thread && std::this_thread::get_id() != main_id)
+                main_on_caller = false;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(id);
+            return true;
+        };
+    };
+
+    uint32_t scene    = graph.add_task("Scene", TASK_AFFINITY_MAIN_THREAD, task(0, true));
+    uint32_t bvh      = graph.add_task("BVH", TASK_AFFINITY_WORKER, task(1, false), { scene });
+    uint32_t flatten  = graph.add_task("Flatten", TASK_AFFINITY_WORKER, task(2, false), { scene });
+    uint32_t upload   = graph.add_task("Upload", TASK_AFFINITY_MAIN_THREAD, task(3, true), { flatten });
+    uint32_t instance = graph.add_task("Instances", TASK_AFFINITY_MAIN_THREAD, task(4, true), { bvh, upload });
+
+    CHECK(graph.run(2));
+    CHECK(main_on_caller);
+    CHECK(finished.size() == 5);
+
+    auto position = [&](uint32_t id) { return std::find(finished.begin(), finished.end(), id) - finished.begin(); };
+
+    CHECK(position(scene) < position(bvh) && position(scene) < position(flatten));
+    CHECK(position(flatten) < position(upload));
+    CHECK(position(bvh) < position(instance) && position(upload) < position(instance));
+
+    for (uint32_t i = 0; i < graph.task_count(); i++)
+    {
+        CHECK(graph.timing(i).ran);
+        CHECK(graph.timing(i).end_ms >= graph.timing(i).start_ms);
+        CHECK((graph.timing(i).thread == 0) == (i == scene || i == upload || i == instance));
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(task_graph_overlaps_workers_with_main)
+{
+    TaskGraph graph;
+
+    std::atomic<bool> worker_started(false);
+    std::atomic<bool> main_saw_worker(false);
+
+    graph.add_task("Worker", TASK_AFFINITY_WORKER, [&]() {
+        worker_started = true;
+        sleep_ms(50);
+        return true;
+    });
+
+    // Runs while the worker task is still going, otherwise nothing overlapped.
+    graph.add_task("Main", TASK_AFFINITY_MAIN_THREAD, [&]() {
+        for (int i = 0; i < 1000 && !worker_started; i++)
+            sleep_ms(1);
+
+        main_saw_worker = worker_started.load();
+        return true;
+    });
+
+    CHECK(graph.run(1));
+    CHECK(main_saw_worker);
+    CHECK(graph.wall_ms() < graph.task_ms());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(task_graph_critical_path)
+{
+    TaskGraph graph;
+
+    auto sleeper = [](int ms) {
+        return [ms]() {
+            sleep_ms(ms);
+            return true;
+        };
+    };
+
+    uint32_t load  = graph.add_task("Load", TASK_AFFINITY_MAIN_THREAD, sleeper(20));
+    uint32_t quick = graph.add_task("Quick", TASK_AFFINITY_WORKER, sleeper(1));
+    uint32_t build = graph.add_task("Build", TASK_AFFINITY_WORKER, sleeper(40), { load });
+    uint32_t done  = graph.add_task("Done", TASK_AFFINITY_MAIN_THREAD, sleeper(1), { quick, build });
+
+    CHECK(graph.run(2));
+
+    std::vector<uint32_t> path = graph.critical_path();
+
+    CHECK(path == std::vector<uint32_t>({ load, build, done }));
+    CHECK(graph.critical_path_ms() >= 60.0);
+    CHECK(graph.critical_path_ms() <= graph.wall_ms());
+    CHECK(graph.report().find("Load > Build > Done") != std::string::npos);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(task_graph_stops_on_failure)
+{
+    TaskGraph graph;
+
+    std::atomic<int> runs(0);
+
+    uint32_t failing   = graph.add_task("Failing", TASK_AFFINITY_WORKER, [&]() {
+        runs++;
+        return false;
+    });
+    uint32_t dependent = graph.add_task("Dependent", TASK_AFFINITY_MAIN_THREAD, [&]() {
+        runs++;
+        return true;
+    }, { failing });
+
+    CHECK(!graph.run(1));
+    CHECK(runs == 1);
+    CHECK(graph.timing(failing).ran && !graph.timing(dependent).ran);
+    CHECK(graph.report().find("Dependent: not run") != std::string::npos);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
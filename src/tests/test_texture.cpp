@@ -0,0 +1,174 @@
+#include "test.h"
+#include "texture_compression.h"
+#include "texture_container.h"
+#include <cstdio>
+#include <cstring>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Smooth gradients with a hard edge through the middle, roughly what a decal looks like.
+static std::vector<uint8_t> make_image(uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> rgba(width * height * 4);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            uint8_t* texel = &rgba[(y * width + x) * 4];
+
+            texel[0] = uint8_t(x * 255 / (width - 1));
+            texel[1] = uint8_t(y * 255 / (height - 1));
+            texel[2] = x > y ? 200 : 40;
+            texel[3] = 255;
+        }
+    }
+
+    return rgba;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(bc_block_round_trip)
+{
+    uint8_t solid[64];
+
+    for (int i = 0; i < 16; i++)
+    {
+        solid[i * 4]     = 90;
+        solid[i * 4 + 1] = 160;
+        solid[i * 4 + 2] = 30;
+        solid[i * 4 + 3] = 255;
+    }
+
+    uint8_t block[16];
+    uint8_t decoded[64];
+
+    // A single color is reproduced within the endpoint precision of each codec.
+    encode_bc7_block(solid, block);
+    decode_bc7_block(block, decoded);
+
+    for (int i = 0; i < 64; i++)
+        CHECK(std::abs(int(decoded[i]) - int(solid[i])) <= 1);
+
+    encode_bc1_block(solid, block);
+    decode_bc1_block(block, decoded);
+
+    for (int i = 0; i < 16; i++)
+        CHECK(std::abs(int(decoded[i * 4 + 1]) - int(solid[i * 4 + 1])) <= 4);
+
+    encode_bc5_block(solid, block);
+    decode_bc5_block(block, decoded);
+
+    for (int i = 0; i < 16; i++)
+        CHECK(decoded[i * 4] == solid[i * 4] && decoded[i * 4 + 1] == solid[i * 4 + 1]);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(compress_texture_quality)
+{
+    const uint32_t size = 64;
+
+    std::vector<uint8_t> rgba = make_image(size, size);
+
+    double min_psnr[TEXTURE_CODEC_COUNT] = { 30.0, 35.0, 38.0 };
+
+    for (int codec = 0; codec < TEXTURE_CODEC_COUNT; codec++)
+    {
+        CompressedTexture       texture;
+        TextureCompressionStats stats = compress_texture(rgba.data(), size, size, TextureCodec(codec), 2, texture);
+
+        CHECK(texture.mips.size() == 7);
+        CHECK(texture.mips.back().width == 1 && texture.mips.back().height == 1);
+        CHECK(texture.mips[0].data.size() == (size / 4) * (size / 4) * texture_codec_block_bytes(TextureCodec(codec)));
+        CHECK(stats.encoded_bytes < stats.source_bytes);
+
+        if (stats.psnr < min_psnr[codec])
+            test_failed(__FILE__, __LINE__, std::string(kTextureCodecNames[codec]) + " PSNR " + std::to_string(stats.psnr));
+
+        // Thread count only splits the work, the result is identical.
+        CompressedTexture single;
+        compress_texture(rgba.data(), size, size, TextureCodec(codec), 1, single);
+
+        CHECK(single.mips[0].data == texture.mips[0].data);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TEST(texture_container_round_trip)
+{
+    std::vector<uint8_t> rgba = make_image(32, 32);
+
+    CompressedTexture texture;
+
+    texture.srgb = true;
+    compress_texture(rgba.data(), 32, 32, TEXTURE_CODEC_BC7, 1, texture);
+
+    std::string path = "dd_test_texture.ddtex";
+
+    CHECK(write_texture_container(path, texture));
+
+    {
+        MappedTextureContainer container;
+
+        CHECK(container.open(path));
+        CHECK(container.header().internal_format == texture_codec_format(TEXTURE_CODEC_BC7, true));
+        CHECK(container.header().width == 32 && container.header().mip_count == texture.mips.size());
+
+        for (uint32_t i = 0; i < container.header().mip_count; i++)
+        {
+            CHECK(container.mip(i).offset % TEXTURE_CONTAINER_ALIGNMENT == 0);
+            CHECK(container.mip(i).size == texture.mips[i].data.size());
+            CHECK(memcmp(container.mip_data(i), texture.mips[i].data.data(), texture.mips[i].data.size()) == 0);
+        }
+
+        // Loaded into a slot expecting another codec, the cache is stale.
+        CHECK(container.matches(TEXTURE_CODEC_BC7));
+        CHECK(!container.matches(TEXTURE_CODEC_BC5));
+        CHECK(!container.matches(TEXTURE_CODEC_BC1));
+    }
+
+    // A mip whose size doesn't match its block count is rejected, even though it still lies inside the file.
+    TextureContainerMip first_mip;
+
+    FILE* file = fopen(path.c_str(), "r+b");
+
+    if (file)
+    {
+        fseek(file, sizeof(TextureContainerHeader), SEEK_SET);
+        fread(&first_mip, sizeof(first_mip), 1, file);
+
+        first_mip.size -= 16;
+
+        fseek(file, sizeof(TextureContainerHeader), SEEK_SET);
+        fwrite(&first_mip, sizeof(first_mip), 1, file);
+        fclose(file);
+    }
+
+    {
+        MappedTextureContainer container;
+
+        CHECK(container.open(path));
+        CHECK(!container.matches(TEXTURE_CODEC_BC7));
+    }
+
+    // A truncated file is rejected instead of mapped.
+    file = fopen(path.c_str(), "wb");
+
+    if (file)
+    {
+        uint32_t magic = TEXTURE_CONTAINER_MAGIC;
+        fwrite(&magic, sizeof(magic), 1, file);
+        fclose(file);
+    }
+
+    MappedTextureContainer container;
+
+    CHECK(!container.open(path));
+
+    remove(path.c_str());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,741 @@
+#include "texture_compression.h"
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+const char* kTextureCodecNames[TEXTURE_CODEC_COUNT] = { "BC1", "BC5", "BC7" };
+
+// GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_RG_RGTC2 and GL_COMPRESSED_RGBA_BPTC_UNORM, followed by their sRGB variants.
+static const uint32_t kTextureCodecFormats[TEXTURE_CODEC_COUNT]     = { 0x83F1, 0x8DBD, 0x8E8C };
+static const uint32_t kTextureCodecSRGBFormats[TEXTURE_CODEC_COUNT] = { 0x8C4D, 0x8DBD, 0x8E8D };
+static const uint32_t kTextureCodecBlockBytes[TEXTURE_CODEC_COUNT]  = { 8, 16, 16 };
+static const uint32_t kBC7Weights4[16]                              = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t texture_codec_format(TextureCodec codec, bool srgb)
+{
+    return srgb ? kTextureCodecSRGBFormats[codec] : kTextureCodecFormats[codec];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t texture_codec_block_bytes(TextureCodec codec)
+{
+    return kTextureCodecBlockBytes[codec];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Endpoints of the line through the block's first 'channels' channels that best fits it: the principal axis found by power
+// iteration, clipped to the extent of the texels projected onto it. The loops run over fixed size arrays so they vectorize.
+static void fit_endpoints(const uint8_t* rgba, uint32_t channels, float* e0, float* e1)
+{
+    float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < 16; i++)
+    {
+        for (uint32_t c = 0; c < channels; c++)
+            mean[c] += rgba[i * 4 + c];
+    }
+
+    for (uint32_t c = 0; c < channels; c++)
+        mean[c] /= 16.0f;
+
+    float covariance[4][4] = {};
+
+    for (int i = 0; i < 16; i++)
+    {
+        float d[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+        for (uint32_t c = 0; c < channels; c++)
+            d[c] = rgba[i * 4 + c] - mean[c];
+
+        for (uint32_t a = 0; a < channels; a++)
+        {
+            for (uint32_t b = 0; b < channels; b++)
+                covariance[a][b] += d[a] * d[b];
+        }
+    }
+
+    float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float length  = 0.0f;
+
+        for (uint32_t a = 0; a < channels; a++)
+        {
+            for (uint32_t b = 0; b < channels; b++)
+                next[a] += covariance[a][b] * axis[b];
+
+            length = std::max(length, fabsf(next[a]));
+        }
+
+        // A flat block has no axis, any direction gives the same endpoints.
+        if (length < 1e-6f)
+            break;
+
+        for (uint32_t c = 0; c < channels; c++)
+            axis[c] = next[c] / length;
+    }
+
+    float min_t = INFINITY;
+    float max_t = -INFINITY;
+    float norm  = 0.0f;
+
+    for (uint32_t c = 0; c < channels; c++)
+        norm += axis[c] * axis[c];
+
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+
+        for (uint32_t c = 0; c < channels; c++)
+            t += (rgba[i * 4 + c] - mean[c]) * axis[c];
+
+        min_t = std::min(min_t, t);
+        max_t = std::max(max_t, t);
+    }
+
+    for (uint32_t c = 0; c < channels; c++)
+    {
+        e0[c] = std::min(std::max(mean[c] + axis[c] * min_t / norm, 0.0f), 255.0f);
+        e1[c] = std::min(std::max(mean[c] + axis[c] * max_t / norm, 0.0f), 255.0f);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint16_t pack_565(const float* rgb)
+{
+    uint32_t r = uint32_t(rgb[0] * 31.0f / 255.0f + 0.5f);
+    uint32_t g = uint32_t(rgb[1] * 63.0f / 255.0f + 0.5f);
+    uint32_t b = uint32_t(rgb[2] * 31.0f / 255.0f + 0.5f);
+
+    return uint16_t((r << 11) | (g << 5) | b);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void unpack_565(uint16_t color, uint8_t* rgb)
+{
+    uint32_t r = (color >> 11) & 31;
+    uint32_t g = (color >> 5) & 63;
+    uint32_t b = color & 31;
+
+    rgb[0] = uint8_t((r << 3) | (r >> 2));
+    rgb[1] = uint8_t((g << 2) | (g >> 4));
+    rgb[2] = uint8_t((b << 3) | (b >> 2));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void bc1_palette(uint16_t c0, uint16_t c1, uint8_t palette[4][4])
+{
+    unpack_565(c0, palette[0]);
+    unpack_565(c1, palette[1]);
+
+    palette[0][3] = 255;
+    palette[1][3] = 255;
+
+    for (int c = 0; c < 3; c++)
+    {
+        if (c0 > c1)
+        {
+            palette[2][c] = uint8_t((2 * palette[0][c] + palette[1][c] + 1) / 3);
+            palette[3][c] = uint8_t((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+        }
+        else
+        {
+            palette[2][c] = uint8_t((palette[0][c] + palette[1][c]) / 2);
+            palette[3][c] = 0;
+        }
+    }
+
+    palette[2][3] = 255;
+    palette[3][3] = c0 > c1 ? 255 : 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void encode_bc1_block(const uint8_t* rgba, uint8_t* block)
+{
+    bool transparent = false;
+
+    for (int i = 0; i < 16; i++)
+        transparent |= rgba[i * 4 + 3] < 128;
+
+    float e0[4], e1[4];
+    fit_endpoints(rgba, 3, e0, e1);
+
+    uint16_t c0 = pack_565(e1);
+    uint16_t c1 = pack_565(e0);
+
+    // c0 > c1 selects four colors, c0 <= c1 three colors and transparent black, which is what alpha tested decals need.
+    if ((c0 < c1) != transparent)
+        std::swap(c0, c1);
+
+    uint8_t palette[4][4];
+    bc1_palette(c0, c1, palette);
+
+    uint32_t indices = 0;
+
+    for (int i = 0; i < 16; i++)
+    {
+        const uint8_t* texel = rgba + i * 4;
+        uint32_t       best  = 0;
+
+        if (transparent && texel[3] < 128)
+            best = 3;
+        else
+        {
+            int best_error = INT32_MAX;
+            int candidates = (c0 > c1) ? 4 : 3;
+
+            for (int p = 0; p < candidates; p++)
+            {
+                int error = 0;
+
+                for (int c = 0; c < 3; c++)
+                    error += (int(texel[c]) - palette[p][c]) * (int(texel[c]) - palette[p][c]);
+
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best       = p;
+                }
+            }
+        }
+
+        indices |= best << (i * 2);
+    }
+
+    block[0] = uint8_t(c0);
+    block[1] = uint8_t(c0 >> 8);
+    block[2] = uint8_t(c1);
+    block[3] = uint8_t(c1 >> 8);
+
+    memcpy(block + 4, &indices, 4);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void decode_bc1_block(const uint8_t* block, uint8_t* rgba)
+{
+    uint16_t c0 = uint16_t(block[0] | (block[1] << 8));
+    uint16_t c1 = uint16_t(block[2] | (block[3] << 8));
+
+    uint8_t palette[4][4];
+    bc1_palette(c0, c1, palette);
+
+    uint32_t indices;
+    memcpy(&indices, block + 4, 4);
+
+    for (int i = 0; i < 16; i++)
+        memcpy(rgba + i * 4, palette[(indices >> (i * 2)) & 3], 4);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void bc4_palette(uint8_t a0, uint8_t a1, uint8_t palette[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+
+    for (int i = 1; i < 7; i++)
+        palette[i + 1] = uint8_t(((7 - i) * a0 + i * a1 + 3) / 7);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void encode_bc4_block(const uint8_t* values, uint32_t stride, uint8_t* block)
+{
+    uint8_t a0 = 0;
+    uint8_t a1 = 255;
+
+    for (int i = 0; i < 16; i++)
+    {
+        a0 = std::max(a0, values[i * stride]);
+        a1 = std::min(a1, values[i * stride]);
+    }
+
+    // Always the eight value mode (a0 > a1). A flat block uses index 0 everywhere.
+    uint8_t palette[8];
+    bc4_palette(a0, a1, palette);
+
+    uint64_t indices = 0;
+
+    if (a0 > a1)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            uint64_t best       = 0;
+            int      best_error = INT32_MAX;
+
+            for (int p = 0; p < 8; p++)
+            {
+                int error = abs(int(values[i * stride]) - palette[p]);
+
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best       = p;
+                }
+            }
+
+            indices |= best << (i * 3);
+        }
+    }
+
+    block[0] = a0;
+    block[1] = a1;
+
+    for (int i = 0; i < 6; i++)
+        block[2 + i] = uint8_t(indices >> (i * 8));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void decode_bc4_block(const uint8_t* block, uint8_t* values, uint32_t stride)
+{
+    uint8_t palette[8];
+
+    if (block[0] > block[1])
+        bc4_palette(block[0], block[1], palette);
+    else
+    {
+        // Six value mode with explicit 0 and 255, never produced by the encoder but valid input.
+        palette[0] = block[0];
+        palette[1] = block[1];
+
+        for (int i = 1; i < 5; i++)
+            palette[i + 1] = uint8_t(((5 - i) * block[0] + i * block[1] + 2) / 5);
+
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+
+    for (int i = 0; i < 6; i++)
+        indices |= uint64_t(block[2 + i]) << (i * 8);
+
+    for (int i = 0; i < 16; i++)
+        values[i * stride] = palette[(indices >> (i * 3)) & 7];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void encode_bc5_block(const uint8_t* rgba, uint8_t* block)
+{
+    encode_bc4_block(rgba, 4, block);
+    encode_bc4_block(rgba + 1, 4, block + 8);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void decode_bc5_block(const uint8_t* block, uint8_t* rgba)
+{
+    decode_bc4_block(block, rgba, 4);
+    decode_bc4_block(block + 8, rgba + 1, 4);
+
+    for (int i = 0; i < 16; i++)
+    {
+        rgba[i * 4 + 2] = 0;
+        rgba[i * 4 + 3] = 255;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+struct BitWriter
+{
+    uint8_t* data;
+    uint32_t position;
+
+    void write(uint32_t value, uint32_t bits)
+    {
+        for (uint32_t i = 0; i < bits; i++, position++)
+            data[position >> 3] |= uint8_t(((value >> i) & 1) << (position & 7));
+    }
+};
+
+struct BitReader
+{
+    const uint8_t* data;
+    uint32_t       position;
+
+    uint32_t read(uint32_t bits)
+    {
+        uint32_t value = 0;
+
+        for (uint32_t i = 0; i < bits; i++, position++)
+            value |= uint32_t((data[position >> 3] >> (position & 7)) & 1) << i;
+
+        return value;
+    }
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Picks the 7 bit values and shared p-bit that reproduce an 8 bit RGBA endpoint best.
+static void quantize_bc7_endpoint(const float* endpoint, uint32_t* values, uint32_t& pbit)
+{
+    float best_error = INFINITY;
+
+    for (uint32_t p = 0; p < 2; p++)
+    {
+        uint32_t candidate[4];
+        float    error = 0.0f;
+
+        for (int c = 0; c < 4; c++)
+        {
+            candidate[c] = uint32_t(std::min(std::max((endpoint[c] - p) / 2.0f + 0.5f, 0.0f), 127.0f));
+
+            float d = float((candidate[c] << 1) | p) - endpoint[c];
+            error += d * d;
+        }
+
+        if (error < best_error)
+        {
+            best_error = error;
+            pbit       = p;
+            memcpy(values, candidate, sizeof(candidate));
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void encode_bc7_block(const uint8_t* rgba, uint8_t* block)
+{
+    float e0[4], e1[4];
+    fit_endpoints(rgba, 4, e0, e1);
+
+    uint32_t q0[4], q1[4], p0, p1;
+    quantize_bc7_endpoint(e0, q0, p0);
+    quantize_bc7_endpoint(e1, q1, p1);
+
+    int endpoints[2][4];
+
+    for (int c = 0; c < 4; c++)
+    {
+        endpoints[0][c] = int((q0[c] << 1) | p0);
+        endpoints[1][c] = int((q1[c] << 1) | p1);
+    }
+
+    int palette[16][4];
+
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 4; c++)
+            palette[i][c] = ((64 - kBC7Weights4[i]) * endpoints[0][c] + kBC7Weights4[i] * endpoints[1][c] + 32) >> 6;
+    }
+
+    uint32_t indices[16];
+
+    for (int i = 0; i < 16; i++)
+    {
+        int best_error = INT32_MAX;
+
+        for (int p = 0; p < 16; p++)
+        {
+            int error = 0;
+
+            for (int c = 0; c < 4; c++)
+                error += (int(rgba[i * 4 + c]) - palette[p][c]) * (int(rgba[i * 4 + c]) - palette[p][c]);
+
+            if (error < best_error)
+            {
+                best_error = error;
+                indices[i] = p;
+            }
+        }
+    }
+
+    // The anchor index is stored without its top bit, so swap the endpoints when it would need it.
+    if (indices[0] >= 8)
+    {
+        std::swap(q0, q1);
+        std::swap(p0, p1);
+
+        for (int i = 0; i < 16; i++)
+            indices[i] = 15 - indices[i];
+    }
+
+    memset(block, 0, 16);
+
+    BitWriter writer = { block, 0 };
+
+    writer.write(1 << 6, 7);
+
+    for (int c = 0; c < 4; c++)
+    {
+        writer.write(q0[c], 7);
+        writer.write(q1[c], 7);
+    }
+
+    writer.write(p0, 1);
+    writer.write(p1, 1);
+
+    for (int i = 0; i < 16; i++)
+        writer.write(indices[i], i == 0 ? 3 : 4);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void decode_bc7_block(const uint8_t* block, uint8_t* rgba)
+{
+    BitReader reader = { block, 0 };
+
+    if (reader.read(7) != (1 << 6))
+    {
+        // Only mode 6 is ever written, anything else decodes to black so it shows up in the PSNR.
+        memset(rgba, 0, 64);
+        return;
+    }
+
+    uint32_t q[2][4];
+
+    for (int c = 0; c < 4; c++)
+    {
+        q[0][c] = reader.read(7);
+        q[1][c] = reader.read(7);
+    }
+
+    uint32_t p0 = reader.read(1);
+    uint32_t p1 = reader.read(1);
+
+    for (int i = 0; i < 16; i++)
+    {
+        uint32_t index = reader.read(i == 0 ? 3 : 4);
+
+        for (int c = 0; c < 4; c++)
+        {
+            uint32_t a = (q[0][c] << 1) | p0;
+            uint32_t b = (q[1][c] << 1) | p1;
+
+            rgba[i * 4 + c] = uint8_t(((64 - kBC7Weights4[index]) * a + kBC7Weights4[index] * b + 32) >> 6);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void generate_mips(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<std::vector<uint8_t>>& levels)
+{
+    levels.clear();
+    levels.push_back(std::vector<uint8_t>(rgba, rgba + size_t(width) * height * 4));
+
+    while (width > 1 || height > 1)
+    {
+        uint32_t next_width  = std::max(width / 2, 1u);
+        uint32_t next_height = std::max(height / 2, 1u);
+
+        const std::vector<uint8_t>& src = levels.back();
+        std::vector<uint8_t>        dst(size_t(next_width) * next_height * 4);
+
+        for (uint32_t y = 0; y < next_height; y++)
+        {
+            for (uint32_t x = 0; x < next_width; x++)
+            {
+                // Clamped, so a level with an odd or unit dimension reuses its edge texels.
+                uint32_t x0 = std::min(x * 2, width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, width - 1);
+                uint32_t y0 = std::min(y * 2, height - 1);
+                uint32_t y1 = std::min(y * 2 + 1, height - 1);
+
+                for (int c = 0; c < 4; c++)
+                {
+                    uint32_t sum = src[(y0 * width + x0) * 4 + c] + src[(y0 * width + x1) * 4 + c] + src[(y1 * width + x0) * 4 + c] + src[(y1 * width + x1) * 4 + c];
+                    dst[(y * next_width + x) * 4 + c] = uint8_t((sum + 2) / 4);
+                }
+            }
+        }
+
+        levels.push_back(std::move(dst));
+
+        width  = next_width;
+        height = next_height;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void fetch_block(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y, uint8_t* texels)
+{
+    for (uint32_t y = 0; y < 4; y++)
+    {
+        for (uint32_t x = 0; x < 4; x++)
+        {
+            // Blocks hanging over the edge repeat the last row and column, which the encoder then fits for free.
+            uint32_t sx = std::min(block_x * 4 + x, width - 1);
+            uint32_t sy = std::min(block_y * 4 + y, height - 1);
+
+            memcpy(texels + (y * 4 + x) * 4, rgba + (size_t(sy) * width + sx) * 4, 4);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void compress_level(const uint8_t* rgba, uint32_t width, uint32_t height, TextureCodec codec, uint32_t thread_count, uint8_t* blocks)
+{
+    uint32_t blocks_x    = (width + 3) / 4;
+    uint32_t blocks_y    = (height + 3) / 4;
+    uint32_t block_bytes = texture_codec_block_bytes(codec);
+
+    auto encode_rows = [&](uint32_t first_row, uint32_t last_row) {
+        uint8_t texels[64];
+
+        for (uint32_t by = first_row; by < last_row; by++)
+        {
+            for (uint32_t bx = 0; bx < blocks_x; bx++)
+            {
+                uint8_t* block = blocks + (size_t(by) * blocks_x + bx) * block_bytes;
+
+                fetch_block(rgba, width, height, bx, by, texels);
+
+                if (codec == TEXTURE_CODEC_BC1)
+                    encode_bc1_block(texels, block);
+                else if (codec == TEXTURE_CODEC_BC5)
+                    encode_bc5_block(texels, block);
+                else
+                    encode_bc7_block(texels, block);
+            }
+        }
+    };
+
+    thread_count = std::max(std::min(thread_count, blocks_y), 1u);
+
+    if (thread_count == 1)
+    {
+        encode_rows(0, blocks_y);
+        return;
+    }
+
+    // Blocks are independent, so contiguous row ranges per thread need no synchronization beyond the join.
+    std::vector<std::thread> threads;
+    uint32_t                 rows_per_thread = (blocks_y + thread_count - 1) / thread_count;
+
+    for (uint32_t i = 0; i < thread_count; i++)
+    {
+        uint32_t first_row = i * rows_per_thread;
+        uint32_t last_row  = std::min(first_row + rows_per_thread, blocks_y);
+
+        if (first_row < last_row)
+            threads.push_back(std::thread(encode_rows, first_row, last_row));
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void decompress_level(const uint8_t* blocks, uint32_t width, uint32_t height, TextureCodec codec, uint8_t* rgba)
+{
+    uint32_t blocks_x    = (width + 3) / 4;
+    uint32_t blocks_y    = (height + 3) / 4;
+    uint32_t block_bytes = texture_codec_block_bytes(codec);
+
+    for (uint32_t by = 0; by < blocks_y; by++)
+    {
+        for (uint32_t bx = 0; bx < blocks_x; bx++)
+        {
+            const uint8_t* block = blocks + (size_t(by) * blocks_x + bx) * block_bytes;
+            uint8_t        texels[64];
+
+            if (codec == TEXTURE_CODEC_BC1)
+                decode_bc1_block(block, texels);
+            else if (codec == TEXTURE_CODEC_BC5)
+                decode_bc5_block(block, texels);
+            else
+                decode_bc7_block(block, texels);
+
+            for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+            {
+                for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++)
+                    memcpy(rgba + ((size_t(by) * 4 + y) * width + bx * 4 + x) * 4, texels + (y * 4 + x) * 4, 4);
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+double texture_psnr(const uint8_t* a, const uint8_t* b, uint32_t width, uint32_t height, uint32_t channels, bool opaque_only)
+{
+    double   squared_error = 0.0;
+    uint64_t count         = 0;
+
+    for (size_t i = 0; i < size_t(width) * height; i++)
+    {
+        if (opaque_only && a[i * 4 + 3] < 128)
+            continue;
+
+        for (uint32_t c = 0; c < channels; c++)
+        {
+            double d = double(a[i * 4 + c]) - double(b[i * 4 + c]);
+            squared_error += d * d;
+            count++;
+        }
+    }
+
+    if (squared_error == 0.0)
+        return INFINITY;
+
+    return 10.0 * log10(255.0 * 255.0 / (squared_error / double(count)));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+TextureCompressionStats compress_texture(const uint8_t* rgba, uint32_t width, uint32_t height, TextureCodec codec, uint32_t thread_count, CompressedTexture& texture)
+{
+    TextureCompressionStats stats;
+
+    if (thread_count == 0)
+        thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+    std::vector<std::vector<uint8_t>> levels;
+    generate_mips(rgba, width, height, levels);
+
+    texture.codec = codec;
+    texture.mips.resize(levels.size());
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t i = 0; i < levels.size(); i++)
+    {
+        CompressedMip& mip = texture.mips[i];
+
+        mip.width  = std::max(width >> i, 1u);
+        mip.height = std::max(height >> i, 1u);
+        mip.data.resize(size_t((mip.width + 3) / 4) * ((mip.height + 3) / 4) * texture_codec_block_bytes(codec));
+
+        compress_level(levels[i].data(), mip.width, mip.height, codec, thread_count, mip.data.data());
+
+        stats.texels += uint64_t(mip.width) * mip.height;
+        stats.source_bytes += uint64_t(mip.width) * mip.height * 4;
+        stats.encoded_bytes += mip.data.size();
+    }
+
+    stats.encode_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::vector<uint8_t> decoded(size_t(width) * height * 4);
+    decompress_level(texture.mips[0].data.data(), width, height, codec, decoded.data());
+
+    // Alpha tested decals discard transparent texels, so their color doesn't count.
+    if (codec == TEXTURE_CODEC_BC5)
+        stats.psnr = texture_psnr(rgba, decoded.data(), width, height, 2, false);
+    else
+        stats.psnr = texture_psnr(rgba, decoded.data(), width, height, 3, true);
+
+    return stats;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+enum TextureCodec
+{
+    TEXTURE_CODEC_BC1 = 0, // RGB with 1-bit alpha, 4 bpp.
+    TEXTURE_CODEC_BC5,     // Two independent channels, 8 bpp. Used for tangent space normals, z is rebuilt in the shader.
+    TEXTURE_CODEC_BC7,     // RGBA, 8 bpp. Only mode 6 is produced.
+    TEXTURE_CODEC_COUNT
+};
+
+extern const char* kTextureCodecNames[TEXTURE_CODEC_COUNT];
+
+// Numeric GL internal format of each codec. BC5 has no sRGB variant.
+uint32_t texture_codec_format(TextureCodec codec, bool srgb);
+uint32_t texture_codec_block_bytes(TextureCodec codec);
+
+// Block encoders take the 16 texels of a 4x4 block as row major RGBA8. Decoders write the same layout back.
+void encode_bc1_block(const uint8_t* rgba, uint8_t* block);
+void encode_bc4_block(const uint8_t* values, uint32_t stride, uint8_t* block);
+void encode_bc5_block(const uint8_t* rgba, uint8_t* block);
+void encode_bc7_block(const uint8_t* rgba, uint8_t* block);
+
+void decode_bc1_block(const uint8_t* block, uint8_t* rgba);
+void decode_bc4_block(const uint8_t* block, uint8_t* values, uint32_t stride);
+void decode_bc5_block(const uint8_t* block, uint8_t* rgba);
+void decode_bc7_block(const uint8_t* block, uint8_t* rgba);
+
+struct CompressedMip
+{
+    uint32_t             width;
+    uint32_t             height;
+    std::vector<uint8_t> data;
+};
+
+struct CompressedTexture
+{
+    TextureCodec               codec;
+    bool                       srgb = false;
+    std::vector<CompressedMip> mips;
+};
+
+struct TextureCompressionStats
+{
+    uint64_t texels        = 0;   // Across the whole mip chain.
+    double   encode_ms     = 0.0;
+    double   psnr          = 0.0; // Level 0, over opaque RGB, or RG for BC5.
+    uint64_t source_bytes  = 0;   // RGBA8 with mips, as the uncompressed path keeps it in VRAM.
+    uint64_t encoded_bytes = 0;
+};
+
+// Box filtered RGBA8 mip chain down to 1x1, level 0 included.
+void generate_mips(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<std::vector<uint8_t>>& levels);
+
+// Compresses every block of a level, splitting block rows over thread_count threads.
+void compress_level(const uint8_t* rgba, uint32_t width, uint32_t height, TextureCodec codec, uint32_t thread_count, uint8_t* blocks);
+void decompress_level(const uint8_t* blocks, uint32_t width, uint32_t height, TextureCodec codec, uint8_t* rgba);
+
+// Mips and compresses a whole texture. thread_count 0 uses every hardware thread.
+TextureCompressionStats compress_texture(const uint8_t* rgba, uint32_t width, uint32_t height, TextureCodec codec, uint32_t thread_count, CompressedTexture& texture);
+
+// PSNR of the first 'channels' channels of two RGBA8 images. opaque_only skips texels whose alpha in a is below one half.
+double texture_psnr(const uint8_t* a, const uint8_t* b, uint32_t width, uint32_t height, uint32_t channels, bool opaque_only);
@@ -0,0 +1,234 @@
+#include "texture_container.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint64_t align_offset(uint64_t offset)
+{
+    return (offset + TEXTURE_CONTAINER_ALIGNMENT - 1) & ~uint64_t(TEXTURE_CONTAINER_ALIGNMENT - 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool write_texture_container(const std::string& path, const CompressedTexture& texture)
+{
+    if (texture.mips.empty())
+        return false;
+
+    TextureContainerHeader header = {};
+
+    header.magic           = TEXTURE_CONTAINER_MAGIC;
+    header.version         = TEXTURE_CONTAINER_VERSION;
+    header.internal_format = texture_codec_format(texture.codec, texture.srgb);
+    header.width           = texture.mips[0].width;
+    header.height          = texture.mips[0].height;
+    header.mip_count       = uint32_t(texture.mips.size());
+
+    std::vector<TextureContainerMip> mips(texture.mips.size());
+    uint64_t                         offset = align_offset(sizeof(TextureContainerHeader) + mips.size() * sizeof(TextureContainerMip));
+
+    for (int i = 0; i < mips.size(); i++)
+    {
+        mips[i].width  = texture.mips[i].width;
+        mips[i].height = texture.mips[i].height;
+        mips[i].offset = offset;
+        mips[i].size   = texture.mips[i].data.size();
+
+        offset = align_offset(offset + mips[i].size);
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+
+    if (!file)
+        return false;
+
+    bool     ok       = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(mips.data(), sizeof(TextureContainerMip), mips.size(), file) == mips.size();
+    uint64_t position = sizeof(TextureContainerHeader) + mips.size() * sizeof(TextureContainerMip);
+
+    static const uint8_t kPadding[TEXTURE_CONTAINER_ALIGNMENT] = { 0 };
+
+    for (int i = 0; i < mips.size() && ok; i++)
+    {
+        ok &= fwrite(kPadding, 1, mips[i].offset - position, file) == mips[i].offset - position;
+        ok &= fwrite(texture.mips[i].data.data(), 1, mips[i].size, file) == mips[i].size;
+
+        position = mips[i].offset + mips[i].size;
+    }
+
+    fclose(file);
+
+    return ok;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+MappedTextureContainer::MappedTextureContainer()
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+MappedTextureContainer::~MappedTextureContainer()
+{
+    close();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool MappedTextureContainer::open(const std::string& path)
+{
+    close();
+
+#if defined(_WIN32)
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        m_file = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (m_mapping)
+        m_data = (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+
+    m_size = uint64_t(size.QuadPart);
+#else
+    m_file = ::open(path.c_str(), O_RDONLY);
+
+    if (m_file < 0)
+        return false;
+
+    struct stat info;
+
+    if (fstat(m_file, &info) != 0 || info.st_size == 0)
+    {
+        close();
+        return false;
+    }
+
+    void* data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, m_file, 0);
+
+    if (data != MAP_FAILED)
+        m_data = (const uint8_t*)data;
+
+    m_size = uint64_t(info.st_size);
+#endif
+
+    if (!m_data)
+    {
+        close();
+        return false;
+    }
+
+    // Reject anything truncated or from another version before handing out pointers into it.
+    if (m_size < sizeof(TextureContainerHeader) || header().magic != TEXTURE_CONTAINER_MAGIC || header().version != TEXTURE_CONTAINER_VERSION || header().mip_count == 0)
+    {
+        close();
+        return false;
+    }
+
+    if (m_size < sizeof(TextureContainerHeader) + uint64_t(header().mip_count) * sizeof(TextureContainerMip))
+    {
+        close();
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header().mip_count; i++)
+    {
+        if (mip(i).offset + mip(i).size > m_size)
+        {
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool MappedTextureContainer::matches(TextureCodec codec) const
+{
+    if (!m_data)
+        return false;
+
+    const TextureContainerHeader& h = header();
+
+    if (h.internal_format != texture_codec_format(codec, false) && h.internal_format != texture_codec_format(codec, true))
+        return false;
+
+    uint32_t max_mips = 1;
+
+    while ((std::max(h.width, h.height) >> max_mips) > 0)
+        max_mips++;
+
+    if (h.width == 0 || h.height == 0 || h.mip_count > max_mips)
+        return false;
+
+    for (uint32_t i = 0; i < h.mip_count; i++)
+    {
+        const TextureContainerMip& m = mip(i);
+
+        uint32_t width  = std::max(h.width >> i, 1u);
+        uint32_t height = std::max(h.height >> i, 1u);
+        uint64_t blocks = uint64_t((width + 3) / 4) * ((height + 3) / 4);
+
+        if (m.width != width || m.height != height || m.size != blocks * texture_codec_block_bytes(codec))
+            return false;
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void MappedTextureContainer::close()
+{
+#if defined(_WIN32)
+    if (m_data)
+        UnmapViewOfFile(m_data);
+
+    if (m_mapping)
+        CloseHandle(m_mapping);
+
+    if (m_file)
+        CloseHandle(m_file);
+
+    m_mapping = nullptr;
+    m_file    = nullptr;
+#else
+    if (m_data)
+        munmap((void*)m_data, size_t(m_size));
+
+    if (m_file >= 0)
+        ::close(m_file);
+
+    m_file = -1;
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
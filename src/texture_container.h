@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+#include "texture_compression.h"
+
+#define TEXTURE_CONTAINER_MAGIC 0x58544444 // "DDTX"
+#define TEXTURE_CONTAINER_VERSION 1
+#define TEXTURE_CONTAINER_ALIGNMENT 16
+
+// On disk layout: the header, mip_count TextureContainerMip entries, then the block data of every mip at the offsets they list.
+// Everything is little-endian and fixed size, so a mapped file is used in place without parsing or copying.
+struct TextureContainerHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t internal_format; // Numeric GL enum, passed straight to glCompressedTexSubImage2D().
+    uint32_t width;
+    uint32_t height;
+    uint32_t mip_count;
+    uint32_t reserved[2];
+};
+
+struct TextureContainerMip
+{
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset; // From the start of the file, aligned to TEXTURE_CONTAINER_ALIGNMENT.
+    uint64_t size;
+};
+
+bool write_texture_container(const std::string& path, const CompressedTexture& texture);
+
+// Read-only memory mapping of a container. open() validates the header and mip table against the file size.
+class MappedTextureContainer
+{
+public:
+    MappedTextureContainer();
+    ~MappedTextureContainer();
+
+    bool open(const std::string& path);
+    void close();
+
+    // Whether the container holds codec blocks in either color space, with every mip the size its dimensions call for. A stale
+    // cache, e.g. one written with another codec, fails this and would otherwise be uploaded as garbage.
+    bool matches(TextureCodec codec) const;
+
+    inline const TextureContainerHeader& header() const { return *(const TextureContainerHeader*)m_data; }
+    inline const TextureContainerMip&    mip(uint32_t i) const { return ((const TextureContainerMip*)(m_data + sizeof(TextureContainerHeader)))[i]; }
+    inline const uint8_t*                mip_data(uint32_t i) const { return m_data + mip(i).offset; }
+    inline uint64_t                      size() const { return m_size; }
+
+private:
+    const uint8_t* m_data = nullptr;
+    uint64_t       m_size = 0;
+#if defined(_WIN32)
+    void* m_file    = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+};
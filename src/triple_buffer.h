@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Lock-free single producer, single consumer triple buffer. The writer always has a buffer to fill and the reader always has a
+// complete one to read, neither ever waits on the other, and the reader only ever sees the most recently published value.
+// Buffers are recycled, so the writer must overwrite every field it publishes.
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Writer side.
+    inline T& write() { return m_buffers[m_write]; }
+
+    void publish()
+    {
+        uint32_t previous = m_shared.exchange(m_write | kDirty, std::memory_order_acq_rel);
+        m_write           = previous & kIndexMask;
+    }
+
+    // Reader side. Swaps in the newest published buffer and returns true if there was one since the last call.
+    bool update()
+    {
+        if ((m_shared.load(std::memory_order_acquire) & kDirty) == 0)
+            return false;
+
+        uint32_t previous = m_shared.exchange(m_read, std::memory_order_acq_rel);
+        m_read            = previous & kIndexMask;
+
+        return true;
+    }
+
+    inline const T& read() const { return m_buffers[m_read]; }
+
+private:
+    static const uint32_t kIndexMask = 3;
+    static const uint32_t kDirty     = 4;
+
+    T                     m_buffers[3];
+    std::atomic<uint32_t> m_shared{ 1 };
+    uint32_t              m_write = 0;
+    uint32_t              m_read  = 2;
+};
@@ -0,0 +1,117 @@
+#include "visibility_buffer.h"
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::uvec2 encode_visibility_id(uint32_t instance, uint32_t triangle)
+{
+    return glm::uvec2(instance + 1, triangle);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool decode_visibility_id(const glm::uvec2& id, uint32_t& instance, uint32_t& triangle)
+{
+    if (id.x == 0)
+        return false;
+
+    instance = id.x - 1;
+    triangle = id.y;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+VisibilityBarycentrics compute_barycentrics(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2, const glm::vec2& ndc, const glm::vec2& screen_size)
+{
+    glm::vec3 inv_w = glm::vec3(1.0f / clip0.w, 1.0f / clip1.w, 1.0f / clip2.w);
+
+    glm::vec2 ndc0 = glm::vec2(clip0) * inv_w.x;
+    glm::vec2 ndc1 = glm::vec2(clip1) * inv_w.y;
+    glm::vec2 ndc2 = glm::vec2(clip2) * inv_w.z;
+
+    // Screen space barycentrics are linear in NDC, their gradients divided by w are the gradients of the perspective correct ones' numerators.
+    float inv_det = 1.0f / ((ndc2.x - ndc1.x) * (ndc0.y - ndc1.y) - (ndc2.y - ndc1.y) * (ndc0.x - ndc1.x));
+
+    glm::vec3 ddx = glm::vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * inv_det * inv_w;
+    glm::vec3 ddy = glm::vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * inv_det * inv_w;
+
+    float ddx_sum = ddx.x + ddx.y + ddx.z;
+    float ddy_sum = ddy.x + ddy.y + ddy.z;
+
+    glm::vec2 delta        = ndc - ndc0;
+    float     interp_inv_w = inv_w.x + delta.x * ddx_sum + delta.y * ddy_sum;
+    float     interp_w     = 1.0f / interp_inv_w;
+
+    VisibilityBarycentrics result;
+
+    result.lambda = glm::vec3(interp_w * (inv_w.x + delta.x * ddx.x + delta.y * ddy.x),
+                              interp_w * (delta.x * ddx.y + delta.y * ddy.y),
+                              interp_w * (delta.x * ddx.z + delta.y * ddy.z));
+
+    // One pixel is 2 / size in NDC.
+    ddx *= 2.0f / screen_size.x;
+    ddy *= 2.0f / screen_size.y;
+    ddx_sum *= 2.0f / screen_size.x;
+    ddy_sum *= 2.0f / screen_size.y;
+
+    float interp_w_ddx = 1.0f / (interp_inv_w + ddx_sum);
+    float interp_w_ddy = 1.0f / (interp_inv_w + ddy_sum);
+
+    result.ddx = (result.lambda * interp_inv_w + ddx) * interp_w_ddx - result.lambda;
+    result.ddy = (result.lambda * interp_inv_w + ddy) * interp_w_ddy - result.lambda;
+
+    return result;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+static T interpolate(const T& a, const T& b, const T& c, const glm::vec3& weights)
+{
+    return a * weights.x + b * weights.y + c * weights.z;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool resolve_visibility(const VisibilityGeometry& geometry, const std::vector<glm::mat4>& transforms, const glm::mat4& view_proj, const glm::uvec2& id, const glm::vec2& ndc, const glm::vec2& screen_size, VisibilityAttributes& attributes)
+{
+    uint32_t instance = 0;
+    uint32_t triangle = 0;
+
+    if (!decode_visibility_id(id, instance, triangle))
+        return false;
+
+    if (instance >= transforms.size() || size_t(triangle) * 3 + 2 >= geometry.indices.size())
+        return false;
+
+    const glm::mat4&        model = transforms[instance];
+    const VisibilityVertex& v0    = geometry.vertices[geometry.indices[triangle * 3]];
+    const VisibilityVertex& v1    = geometry.vertices[geometry.indices[triangle * 3 + 1]];
+    const VisibilityVertex& v2    = geometry.vertices[geometry.indices[triangle * 3 + 2]];
+
+    glm::vec4 world0 = model * glm::vec4(v0.position, 1.0f);
+    glm::vec4 world1 = model * glm::vec4(v1.position, 1.0f);
+    glm::vec4 world2 = model * glm::vec4(v2.position, 1.0f);
+
+    VisibilityBarycentrics barycentrics = compute_barycentrics(view_proj * world0, view_proj * world1, view_proj * world2, ndc, screen_size);
+
+    glm::vec2 uv0 = glm::vec2(v0.u, v0.v);
+    glm::vec2 uv1 = glm::vec2(v1.u, v1.v);
+    glm::vec2 uv2 = glm::vec2(v2.u, v2.v);
+
+    // Same normal matrix as g_buffer_vs.glsl, which only supports uniform scale.
+    glm::mat3 normal_mat = glm::mat3(model);
+
+    attributes.position      = glm::vec3(interpolate(world0, world1, world2, barycentrics.lambda));
+    attributes.normal        = glm::normalize(normal_mat * interpolate(v0.normal, v1.normal, v2.normal, barycentrics.lambda));
+    attributes.tangent       = glm::normalize(normal_mat * interpolate(v0.tangent, v1.tangent, v2.tangent, barycentrics.lambda));
+    attributes.bitangent     = glm::normalize(normal_mat * interpolate(v0.bitangent, v1.bitangent, v2.bitangent, barycentrics.lambda));
+    attributes.tex_coord     = interpolate(uv0, uv1, uv2, barycentrics.lambda);
+    attributes.tex_coord_ddx = interpolate(uv0, uv1, uv2, barycentrics.ddx);
+    attributes.tex_coord_ddy = interpolate(uv0, uv1, uv2, barycentrics.ddy);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
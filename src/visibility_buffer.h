@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm.hpp>
+#include <vector>
+#include <stdint.h>
+
+// Must match visibility_fs.glsl and material_classify_fs.glsl. Draws are stored as depth (draw + 1) / VISIBILITY_MAX_DRAWS, which is
+// exact in a 32-bit float depth buffer for every draw index below it.
+#define VISIBILITY_MAX_DRAWS 65536
+
+// Vertex layout of the resolve pass, four RGBA32F texels per vertex when read through a buffer texture.
+struct VisibilityVertex
+{
+    glm::vec3 position;
+    float     u;
+    glm::vec3 normal;
+    float     v;
+    glm::vec3 tangent;
+    float     padding0;
+    glm::vec3 bitangent;
+    float     padding1;
+};
+
+// The whole scene as the resolve pass sees it. Triangles of every mesh are concatenated, so a triangle index alone locates its
+// vertices, and the submeshes of every mesh are numbered as one list of draws.
+struct VisibilityGeometry
+{
+    std::vector<VisibilityVertex> vertices;
+    std::vector<uint32_t>         indices;        // Three per triangle, into vertices.
+    std::vector<uint16_t>         triangle_draws; // Draw, i.e. material, each triangle is resolved with.
+    uint32_t                      draw_count = 0;
+};
+
+// Perspective correct barycentrics of a pixel and how they change one pixel to the right (ddx) and one pixel up (ddy).
+struct VisibilityBarycentrics
+{
+    glm::vec3 lambda;
+    glm::vec3 ddx;
+    glm::vec3 ddy;
+};
+
+// Attributes the G-buffer pass would have interpolated for the same pixel, in world space.
+struct VisibilityAttributes
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec3 tangent;
+    glm::vec3 bitangent;
+    glm::vec2 tex_coord;
+    glm::vec2 tex_coord_ddx;
+    glm::vec2 tex_coord_ddy;
+};
+
+// Texel of the RG32UI visibility target: x is the instance transform index plus one, so zero is background, y the triangle index.
+glm::uvec2 encode_visibility_id(uint32_t instance, uint32_t triangle);
+
+// Returns false for background.
+bool decode_visibility_id(const glm::uvec2& id, uint32_t& instance, uint32_t& triangle);
+
+// CPU counterpart of compute_barycentrics() in visibility_resolve_fs.glsl.
+VisibilityBarycentrics compute_barycentrics(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2, const glm::vec2& ndc, const glm::vec2& screen_size);
+
+// CPU counterpart of the resolve pass: rebuilds the attributes of the pixel at ndc from its visibility texel. transforms is laid out like
+// the instance buffer. Returns false for background or an id that is out of range.
+bool resolve_visibility(const VisibilityGeometry& geometry, const std::vector<glm::mat4>& transforms, const glm::mat4& view_proj, const glm::uvec2& id, const glm::vec2& ndc, const glm::vec2& screen_size, VisibilityAttributes& attributes);